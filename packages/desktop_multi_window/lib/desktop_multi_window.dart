@@ -1,3 +1,5 @@
 export 'src/window_controller.dart';
 export 'src/window_configuration.dart';
+export 'src/window_blob.dart';
 export 'src/window_channel.dart';
+export 'src/window_store.dart';
@@ -0,0 +1,10 @@
+import 'dart:ffi';
+
+/// The Linux plugin library, for its dart:ffi entry points.
+final DynamicLibrary pluginLibrary =
+    DynamicLibrary.open('libdesktop_multi_window_plugin.so');
+
+/// Drops a reference to a blob, or to a store value.
+final releasePtr =
+    pluginLibrary.lookup<NativeFunction<Void Function(Pointer<Void>)>>(
+        'desktop_multi_window_blob_release');
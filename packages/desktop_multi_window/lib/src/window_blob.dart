@@ -0,0 +1,108 @@
+import 'dart:ffi';
+import 'dart:io';
+import 'dart:typed_data';
+
+import 'native_library.dart';
+
+final _create =
+    pluginLibrary.lookupFunction<Int64 Function(Int64), int Function(int)>(
+        'desktop_multi_window_blob_create');
+
+final _size =
+    pluginLibrary.lookupFunction<Int64 Function(Int64), int Function(int)>(
+        'desktop_multi_window_blob_size');
+
+final _acquire = pluginLibrary.lookupFunction<Pointer<Uint8> Function(Int64),
+    Pointer<Uint8> Function(int)>('desktop_multi_window_blob_acquire');
+
+final _unpublish = pluginLibrary.lookupFunction<Void Function(Pointer<Void>),
+    void Function(Pointer<Void>)>('desktop_multi_window_blob_unpublish');
+
+final _unpublishPtr =
+    pluginLibrary.lookup<NativeFunction<Void Function(Pointer<Void>)>>(
+        'desktop_multi_window_blob_unpublish');
+
+final _unpublishFinalizer = NativeFinalizer(_unpublishPtr);
+
+/// Bytes shared by the engines of all windows, to pass large payloads such as
+/// images through a [WindowMethodChannel] without copying them.
+///
+/// The sender allocates a blob, writes its [bytes] and passes its [handle] as
+/// an argument. The receiver opens the handle and reads the same memory. A
+/// handle can be opened until the blob of the sender is disposed or garbage
+/// collected, so keep it until the call which passes the handle completes:
+///
+/// ```dart
+/// final blob = WindowBlob.allocate(image.length)..bytes.setAll(0, image);
+/// await channel.invokeMethod('showImage', blob.handle);
+/// blob.dispose();
+///
+/// // in the other window
+/// final image = WindowBlob.open(call.arguments as int).bytes;
+/// ```
+///
+/// Only supported on Linux.
+class WindowBlob implements Finalizable {
+  WindowBlob._(this.handle, this._data, this.bytes);
+
+  /// Allocates a zeroed blob of [length] bytes.
+  factory WindowBlob.allocate(int length) {
+    _checkPlatform();
+    final handle = _create(length);
+    if (handle == 0) {
+      throw ArgumentError.value(length, 'length', 'can not allocate a blob');
+    }
+    final blob = WindowBlob._open(handle);
+    // the handle can be opened while this blob is reachable.
+    _unpublishFinalizer.attach(blob, blob._data.cast(), detach: blob);
+    blob._published = true;
+    return blob;
+  }
+
+  /// Opens the blob which another window allocated, without copying it.
+  factory WindowBlob.open(int handle) {
+    _checkPlatform();
+    return WindowBlob._open(handle);
+  }
+
+  factory WindowBlob._open(int handle) {
+    final length = _size(handle);
+    final data = length < 0 ? nullptr : _acquire(handle);
+    if (data == nullptr) {
+      throw ArgumentError.value(handle, 'handle', 'unknown or disposed blob');
+    }
+    // the view keeps the memory alive, even after the blob is disposed.
+    return WindowBlob._(
+      handle,
+      data,
+      data.asTypedList(length, finalizer: releasePtr, token: data.cast()),
+    );
+  }
+
+  /// Passed to another window to open this blob.
+  final int handle;
+
+  /// The shared bytes.
+  final Uint8List bytes;
+
+  final Pointer<Uint8> _data;
+
+  bool _published = false;
+
+  /// Stops other windows from opening [handle]. Blobs already opened and
+  /// [bytes] stay valid.
+  void dispose() {
+    if (!_published) {
+      return;
+    }
+    _published = false;
+    _unpublishFinalizer.detach(this);
+    _unpublish(_data.cast());
+  }
+
+  static void _checkPlatform() {
+    if (!Platform.isLinux) {
+      throw UnsupportedError('WindowBlob is only supported on Linux');
+    }
+  }
+}
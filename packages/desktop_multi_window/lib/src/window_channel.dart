@@ -1,3 +1,5 @@
+import 'dart:async';
+
 import 'package:flutter/foundation.dart';
 import 'package:flutter/services.dart';
 
@@ -126,8 +128,74 @@ class WindowMethodChannel {
   }
 }
 
+/// A channel which fans values out to every window listening to it.
+///
+/// Any engine can [publish], each engine listening to [values] receives every
+/// value published after it subscribed. A value published with `retain` is
+/// kept by the platform and delivered first to later subscribers, so windows
+/// opened later start from the current state.
+///
+/// Only supported on Linux.
+class WindowBroadcastChannel {
+  final String name;
+
+  WindowBroadcastChannel(this.name);
+
+  /// Publishes [value] to all subscribers of this channel. The value is
+  /// encoded once and delivered to every window as it is.
+  ///
+  /// With [retain], [value] replaces the retained value of the channel, and
+  /// a `null` value clears it.
+  ///
+  /// Throws [WindowChannelException] if the channel is registered as a
+  /// [WindowMethodChannel].
+  Future<void> publish(dynamic value, {bool retain = false}) async {
+    _initializeChannelManager();
+    final id = await _channelId(name);
+    try {
+      await _methodChannel.invokeMethod('publish', {
+        if (id != null) 'channelId': id else 'channel': name,
+        'value': value,
+        'retain': retain,
+      });
+    } on PlatformException catch (e) {
+      throw WindowChannelException(
+        e.code,
+        e.message ?? 'Failed to publish on channel $name',
+        e.details,
+      );
+    }
+  }
+
+  /// Values published on this channel, starting with the retained value if
+  /// there is one. Listening subscribes this engine, cancelling the last
+  /// subscription unsubscribes it.
+  Stream<dynamic> get values {
+    _initializeChannelManager();
+    final controller = _broadcastControllers.putIfAbsent(name, () {
+      late final StreamController<dynamic> controller;
+      controller = StreamController<dynamic>.broadcast(
+        onListen: () => _subscribe(name, controller),
+        onCancel: () => _unsubscribe(name),
+      );
+      return controller;
+    });
+    return controller.stream;
+  }
+}
+
 final _registeredHandlers = <String, MethodCallHandler>{};
 
+final _broadcastControllers = <String, StreamController<dynamic>>{};
+
+/// Native ids of channel names, interned once by the platform so that calls
+/// are dispatched without looking up names. See [_channelId].
+final _channelIds = <String, int>{};
+final _channelNames = <int, String>{};
+
+/// Whether the platform interns channel ids, false until it answers.
+bool? _channelIdsSupported;
+
 const _methodChannel = MethodChannel('mixin.one/desktop_multi_window/channels');
 
 bool _initialized = false;
@@ -140,7 +208,9 @@ void _initializeChannelManager() {
   _methodChannel.setMethodCallHandler((call) async {
     if (call.method == 'methodCall') {
       final arguments = call.arguments as Map;
-      final channelName = arguments['channel'] as String;
+      // calls by id forward only the id of the channel
+      final channelName = arguments['channel'] as String? ??
+          _channelNames[arguments['channelId'] as int?];
       final method = arguments['method'] as String;
       final args = arguments['arguments'];
 
@@ -154,18 +224,54 @@ void _initializeChannelManager() {
 
       final methodCall = MethodCall(method, args);
       return await handler.call(methodCall);
+    } else if (call.method == 'onPublish') {
+      final arguments = call.arguments as Map;
+      final channelName = arguments['channel'] as String? ??
+          _channelNames[arguments['channelId'] as int?];
+      _broadcastControllers[channelName]?.add(arguments['value']);
     } else {
       throw MissingPluginException('No handler for method ${call.method}');
     }
   });
 }
 
+void _cacheChannelId(String name, int id) {
+  _channelIds[name] = id;
+  _channelNames[id] = name;
+  _channelIdsSupported = true;
+}
+
+/// The native id of the channel [name], resolved once and cached. Null if the
+/// platform does not intern channel ids, calls then pass the name.
+Future<int?> _channelId(String name) async {
+  final cached = _channelIds[name];
+  if (cached != null || _channelIdsSupported == false) {
+    return cached;
+  }
+  try {
+    final id = await _methodChannel.invokeMethod<int>('channelId', {
+      'channel': name,
+    });
+    if (id != null) {
+      _cacheChannelId(name, id);
+    }
+    return id;
+  } on MissingPluginException {
+    _channelIdsSupported = false;
+    return null;
+  }
+}
+
 Future<void> _registerMethodHandler(String name, ChannelMode mode) async {
   try {
-    await _methodChannel.invokeMethod('registerMethodHandler', {
+    // platforms which intern channel ids return the id of the channel
+    final id = await _methodChannel.invokeMethod<int>('registerMethodHandler', {
       'channel': name,
       'mode': mode.value,
     });
+    if (id != null) {
+      _cacheChannelId(name, id);
+    }
   } on PlatformException catch (e) {
     if (e.code == 'CHANNEL_LIMIT_REACHED') {
       throw WindowChannelException(
@@ -186,17 +292,53 @@ Future<void> _registerMethodHandler(String name, ChannelMode mode) async {
   }
 }
 
-Future<void> _unregisterMethodHandler(String name) async {
-  await _methodChannel.invokeMethod('unregisterMethodHandler', {
-    'channel': name,
+Future<void> _unregisterMethodHandler(String name,
+    {String method = 'unregisterMethodHandler'}) async {
+  final id = _channelIds[name];
+  await _methodChannel.invokeMethod(method, {
+    if (id != null) 'channelId': id else 'channel': name,
   });
 }
 
+Future<void> _subscribe(
+    String name, StreamController<dynamic> controller) async {
+  try {
+    final result = await _methodChannel.invokeMapMethod<String, dynamic>(
+        'subscribe', {'channel': name});
+    if (result == null) {
+      return;
+    }
+    _cacheChannelId(name, result['channelId'] as int);
+    if (result['retained'] == true) {
+      controller.add(result['value']);
+    }
+  } on PlatformException catch (e) {
+    controller.addError(WindowChannelException(
+      e.code,
+      e.code == 'CHANNEL_MODE_CONFLICT'
+          ? 'Cannot subscribe to channel "$name": already registered in a different mode'
+          : e.message ?? 'Failed to subscribe to channel $name',
+      e.details,
+    ));
+  }
+}
+
+Future<void> _unsubscribe(String name) async {
+  try {
+    await _unregisterMethodHandler(name, method: 'unsubscribe');
+  } on PlatformException catch (e) {
+    if (kDebugMode) {
+      print('Warning: Failed to unsubscribe from channel $name: ${e.message}');
+    }
+  }
+}
+
 Future<T?> _invokeMethodOnChannel<T>(
     String name, String method, dynamic arguments) async {
+  final id = await _channelId(name);
   try {
     return await _methodChannel.invokeMethod<T>('invokeMethod', {
-      'channel': name,
+      if (id != null) 'channelId': id else 'channel': name,
       'method': method,
       'arguments': arguments,
     });
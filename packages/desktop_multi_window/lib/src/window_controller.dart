@@ -8,14 +8,34 @@ import 'window_configuration.dart';
 
 final _windowEvent = _windowEventAsStream();
 
+/// Windows created and destroyed since the previous [onWindowsChanged] event.
+class WindowsChange {
+  const WindowsChange({required this.added, required this.removed});
+
+  final List<String> added;
+  final List<String> removed;
+
+  factory WindowsChange._fromArguments(dynamic arguments) {
+    final map = arguments is Map ? arguments : const {};
+    return WindowsChange(
+      added: (map['added'] as List?)?.cast<String>() ?? const [],
+      removed: (map['removed'] as List?)?.cast<String>() ?? const [],
+    );
+  }
+
+  @override
+  String toString() => 'WindowsChange(added: $added, removed: $removed)';
+}
+
 /// A listenable that notifies when the windows list changes.
 /// Listen to this to be notified when windows are created or destroyed.
-Stream<void> get onWindowsChanged => _windowEvent.map((call) {
-      if (call.method == 'onWindowsChanged') {
-        return call.method;
-      }
-      return null;
-    }).where((event) => event != null);
+///
+/// On Linux, changes within one main loop iteration arrive as one event with
+/// their ids, see [WindowController.resyncWindows] for a full snapshot.
+/// Elsewhere the ids are empty.
+Stream<WindowsChange> get onWindowsChanged => _windowEvent
+    .where((call) => call.method == 'onWindowsChanged')
+    .map((call) => WindowsChange._fromArguments(call.arguments));
 
 /// The [WindowController] instance that is used to control this window.
 class WindowController {
@@ -44,6 +64,26 @@ class WindowController {
     return WindowController._(windowId!, configuration.arguments);
   }
 
+  /// Keeps [count] hidden windows with started engines, so that [create] only
+  /// hands one out and the new window renders without starting an engine.
+  ///
+  /// The engines of prewarmed windows run `main` before they are handed out,
+  /// and wait in [fromCurrentEngine] until then. Windows must therefore get
+  /// their id and arguments from [fromCurrentEngine], not from the arguments
+  /// of `main`.
+  ///
+  /// Prewarmed windows do not keep the application running, it quits when
+  /// the last created window closes, as without them.
+  ///
+  /// Only supported on Linux, a no-op elsewhere.
+  static Future<void> setPrewarmedWindowCount(int count) async {
+    try {
+      await _channel.invokeMethod('setPrewarmedWindowCount', {'count': count});
+    } on MissingPluginException {
+      // not supported on this platform
+    }
+  }
+
   static Future<WindowController> fromCurrentEngine() async {
     final definition = await _channel
         .invokeMethod<Map<dynamic, dynamic>>('getWindowDefinition');
@@ -67,6 +107,27 @@ class WindowController {
     }).toList();
   }
 
+  /// All windows, like [getAll], after delivering pending [onWindowsChanged]
+  /// events, so that later events apply to the returned list.
+  ///
+  /// Only supported on Linux, elsewhere the same as [getAll].
+  static Future<List<WindowController>> resyncWindows() async {
+    final List<dynamic>? result;
+    try {
+      result = await _channel.invokeMethod<List<dynamic>>('resyncWindows');
+    } on MissingPluginException {
+      return getAll();
+    }
+    if (result == null) {
+      return [];
+    }
+    return result.cast<Map<dynamic, dynamic>>().map((e) {
+      final windowId = e['windowId'] as String;
+      final windowArgument = e['windowArgument'] as String;
+      return WindowController._(windowId, windowArgument);
+    }).toList();
+  }
+
   Future<void> _callWindowMethod(String method,
       [Map<String, dynamic>? arguments]) {
     assert(windowId.isNotEmpty, 'windowId is empty');
@@ -0,0 +1,107 @@
+import 'dart:ffi';
+import 'dart:io';
+import 'dart:typed_data';
+
+import 'package:ffi/ffi.dart';
+import 'package:flutter/services.dart';
+
+import 'native_library.dart';
+import 'window_channel.dart';
+
+final _version = pluginLibrary.lookupFunction<Int64 Function(Pointer<Utf8>),
+    int Function(Pointer<Utf8>)>('desktop_multi_window_store_version');
+
+final _acquire = pluginLibrary.lookupFunction<
+    Pointer<Uint8> Function(Pointer<Utf8>, Pointer<Int64>, Pointer<Int64>),
+    Pointer<Uint8> Function(Pointer<Utf8>, Pointer<Int64>,
+        Pointer<Int64>)>('desktop_multi_window_store_acquire');
+
+const _channel = MethodChannel('mixin.one/desktop_multi_window');
+
+const _codec = StandardMessageCodec();
+
+/// Small state shared by all windows, such as the current user, the theme or
+/// unread counts.
+///
+/// Values are kept natively, as encoded by [StandardMessageCodec] in the
+/// window which [set] them, and every window reads them synchronously with
+/// [get], without a call to another engine. Each write increments the
+/// version of the store, and [changes] notifies every window of the keys
+/// written.
+///
+/// ```dart
+/// await WindowStore.set('theme', 'dark');
+///
+/// // in any window
+/// final theme = WindowStore.get('theme') as String?;
+/// WindowStore.changes.where((key) => key == 'theme').listen((_) => reload());
+/// ```
+///
+/// Only supported on Linux.
+class WindowStore {
+  WindowStore._();
+
+  /// Decoded values of this window, by key, with their versions.
+  static final _values = <String, (int, Object?)>{};
+
+  static final _changes =
+      WindowBroadcastChannel('mixin.one/desktop_multi_window/store');
+
+  /// The value of [key], or null if it is not set. A value is decoded once
+  /// per version.
+  static Object? get(String key) {
+    _checkPlatform();
+    return using((arena) {
+      final nativeKey = key.toNativeUtf8(allocator: arena);
+      final version = _version(nativeKey);
+      final cached = _values[key];
+      if (cached != null && cached.$1 == version) {
+        return cached.$2;
+      }
+
+      final size = arena<Int64>();
+      final valueVersion = arena<Int64>();
+      final data = _acquire(nativeKey, size, valueVersion);
+      if (data == nullptr) {
+        _values.remove(key);
+        return null;
+      }
+      // typed data in the value views the native bytes, which stay alive
+      // with it.
+      final bytes = data.asTypedList(size.value,
+          finalizer: releasePtr, token: data.cast());
+      final value = _codec.decodeMessage(ByteData.sublistView(bytes));
+      _values[key] = (valueVersion.value, value);
+      return value;
+    });
+  }
+
+  /// The version of the value of [key], or 0 if it is not set.
+  static int version(String key) {
+    _checkPlatform();
+    return using((arena) => _version(key.toNativeUtf8(allocator: arena)));
+  }
+
+  /// Sets [key] to [value], or removes it if [value] is null, and returns the
+  /// new version of the store. [value] is encoded once, here.
+  static Future<int> set(String key, Object? value) async {
+    _checkPlatform();
+    final encoded = value == null ? null : _codec.encodeMessage(value);
+    final version = await _channel.invokeMethod<int>('storeSet', {
+      'key': key,
+      'value': encoded?.buffer
+          .asUint8List(encoded.offsetInBytes, encoded.lengthInBytes),
+    });
+    return version ?? 0;
+  }
+
+  /// Keys written by any window, after their value changed.
+  static Stream<String> get changes =>
+      _changes.values.map((change) => (change as Map)['key'] as String);
+
+  static void _checkPlatform() {
+    if (!Platform.isLinux) {
+      throw UnsupportedError('WindowStore is only supported on Linux');
+    }
+  }
+}
@@ -0,0 +1,138 @@
+#include "blob_store.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "multi_window_manager.h"
+
+namespace {
+
+struct BlobHeader {
+  std::atomic<int32_t> refs;
+  size_t size;
+  int64_t handle;
+};
+
+// the data follows the header, aligned for any typed data view.
+constexpr size_t kHeaderSize = (sizeof(BlobHeader) + 15) & ~size_t(15);
+
+BlobHeader* HeaderOf(const uint8_t* data) {
+  return reinterpret_cast<BlobHeader*>(const_cast<uint8_t*>(data) -
+                                       kHeaderSize);
+}
+
+uint8_t* DataOf(BlobHeader* header) {
+  return reinterpret_cast<uint8_t*>(header) + kHeaderSize;
+}
+
+}  // namespace
+
+BlobStore::~BlobStore() {
+  for (const auto& pair : blobs_) {
+    Release(pair.second);
+  }
+}
+
+int64_t BlobStore::Create(size_t size) {
+  auto* data = Allocate(size);
+  if (!data) {
+    return 0;
+  }
+  auto* header = HeaderOf(data);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  header->handle = next_handle_++;
+  blobs_[header->handle] = DataOf(header);
+  return header->handle;
+}
+
+uint8_t* BlobStore::Acquire(int64_t handle, size_t* size) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = blobs_.find(handle);
+  if (it == blobs_.end()) {
+    return nullptr;
+  }
+  auto* header = HeaderOf(it->second);
+  // the store holds a reference, the blob can not be freed meanwhile.
+  header->refs.fetch_add(1, std::memory_order_relaxed);
+  *size = header->size;
+  return it->second;
+}
+
+int64_t BlobStore::Size(int64_t handle) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = blobs_.find(handle);
+  if (it == blobs_.end()) {
+    return -1;
+  }
+  return static_cast<int64_t>(HeaderOf(it->second)->size);
+}
+
+void BlobStore::Unpublish(const uint8_t* data) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (blobs_.erase(HeaderOf(data)->handle) == 0) {
+      return;
+    }
+  }
+  Release(data);
+}
+
+// static
+void BlobStore::Release(const uint8_t* data) {
+  auto* header = HeaderOf(data);
+  if (header->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    header->~BlobHeader();
+    free(header);
+  }
+}
+
+// static
+uint8_t* BlobStore::Allocate(size_t size) {
+  // calloc maps large blobs as zero pages, they are not written twice.
+  void* memory = calloc(1, kHeaderSize + size);
+  if (!memory) {
+    return nullptr;
+  }
+  auto* header = new (memory) BlobHeader();
+  header->refs = 1;
+  header->size = size;
+  return DataOf(header);
+}
+
+// static
+void BlobStore::Retain(const uint8_t* data) {
+  HeaderOf(data)->refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+// static
+size_t BlobStore::SizeOf(const uint8_t* data) {
+  return HeaderOf(data)->size;
+}
+
+int64_t desktop_multi_window_blob_create(int64_t size) {
+  if (size < 0) {
+    return 0;
+  }
+  return MultiWindowManager::Instance()->Blobs().Create(
+      static_cast<size_t>(size));
+}
+
+int64_t desktop_multi_window_blob_size(int64_t handle) {
+  return MultiWindowManager::Instance()->Blobs().Size(handle);
+}
+
+uint8_t* desktop_multi_window_blob_acquire(int64_t handle) {
+  size_t size = 0;
+  return MultiWindowManager::Instance()->Blobs().Acquire(handle, &size);
+}
+
+void desktop_multi_window_blob_unpublish(void* data) {
+  MultiWindowManager::Instance()->Blobs().Unpublish(
+      static_cast<uint8_t*>(data));
+}
+
+void desktop_multi_window_blob_release(void* data) {
+  BlobStore::Release(static_cast<uint8_t*>(data));
+}
@@ -0,0 +1,74 @@
+#ifndef DESKTOP_MULTI_WINDOW_LINUX_BLOB_STORE_H_
+#define DESKTOP_MULTI_WINDOW_LINUX_BLOB_STORE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+
+#include "include/desktop_multi_window/desktop_multi_window_plugin.h"
+
+// Byte buffers shared by the engines of all windows. Every engine runs in this
+// process, so a blob is written by one engine and read by another through
+// dart:ffi as external typed data, only its handle crosses a window channel.
+//
+// A blob is referenced by the store while its handle can be opened, and by
+// every typed data viewing it. It is freed with the last reference.
+class BlobStore {
+ public:
+  BlobStore() = default;
+  ~BlobStore();
+
+  // A new zeroed blob of `size` bytes, only referenced by the store. Returns
+  // its handle, or 0 if it can not be allocated.
+  int64_t Create(size_t size);
+
+  // The data of the blob of `handle`, with a reference for the caller, or
+  // null if the handle is unknown or unpublished. Its size is written to
+  // `size`.
+  uint8_t* Acquire(int64_t handle, size_t* size);
+
+  // Size of the blob of `handle`, or -1 if the handle is unknown.
+  int64_t Size(int64_t handle);
+
+  // Drops the reference of the store to the blob viewed by `data`, its handle
+  // can not be opened anymore.
+  void Unpublish(const uint8_t* data);
+
+  // Drops a reference taken by Acquire. Thread safe, called by Dart
+  // finalizers.
+  static void Release(const uint8_t* data);
+
+  // A new zeroed buffer of `size` bytes with one reference and no handle, or
+  // null if it can not be allocated. Released like blobs.
+  static uint8_t* Allocate(size_t size);
+
+  // Takes another reference to `data`.
+  static void Retain(const uint8_t* data);
+
+  static size_t SizeOf(const uint8_t* data);
+
+ private:
+  std::mutex mutex_;
+  std::unordered_map<int64_t, uint8_t*> blobs_;
+  int64_t next_handle_ = 1;
+};
+
+G_BEGIN_DECLS
+
+// dart:ffi entry points of BlobStore, on the store of MultiWindowManager.
+
+FLUTTER_PLUGIN_EXPORT int64_t desktop_multi_window_blob_create(int64_t size);
+
+FLUTTER_PLUGIN_EXPORT int64_t desktop_multi_window_blob_size(int64_t handle);
+
+FLUTTER_PLUGIN_EXPORT uint8_t* desktop_multi_window_blob_acquire(
+    int64_t handle);
+
+FLUTTER_PLUGIN_EXPORT void desktop_multi_window_blob_unpublish(void* data);
+
+FLUTTER_PLUGIN_EXPORT void desktop_multi_window_blob_release(void* data);
+
+G_END_DECLS
+
+#endif  // DESKTOP_MULTI_WINDOW_LINUX_BLOB_STORE_H_
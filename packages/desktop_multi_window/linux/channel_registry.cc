@@ -0,0 +1,168 @@
+#include "channel_registry.h"
+
+#include <algorithm>
+
+ChannelRegistry& ChannelRegistry::GetInstance() {
+  static ChannelRegistry instance;
+  return instance;
+}
+
+ChannelRegistry::~ChannelRegistry() {
+  for (auto& channel : channels_) {
+    if (channel.retained) {
+      fl_value_unref(channel.retained);
+    }
+  }
+}
+
+int64_t ChannelRegistry::Intern(const std::string& channel) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto it = ids_.find(channel);
+  if (it != ids_.end()) {
+    return it->second;
+  }
+  channels_.emplace_back();
+  channels_.back().name = channel;
+  auto id = static_cast<int64_t>(channels_.size());
+  ids_.emplace(channel, id);
+  return id;
+}
+
+std::string ChannelRegistry::Name(int64_t id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto* channel = Find(id);
+  return channel ? channel->name : "#" + std::to_string(id);
+}
+
+RegistrationOutcome ChannelRegistry::Register(int64_t id,
+                                              WindowChannelPlugin* plugin,
+                                              ChannelMode mode) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto* found = Find(id);
+  if (!found) {
+    return RegistrationOutcome::kUnknownChannel;
+  }
+  auto& channel = *found;
+
+  if (channel.InUse() && channel.mode != mode) {
+    return RegistrationOutcome::kModeConflict;
+  }
+  if (channel.Contains(plugin)) {
+    return RegistrationOutcome::kAlreadyRegistered;
+  }
+  // one handler, or a pair
+  size_t limit = mode == ChannelMode::kUnidirectional ? 1 : 2;
+  if (channel.count >= limit) {
+    return RegistrationOutcome::kLimitReached;
+  }
+
+  channel.mode = mode;
+  channel.plugins[channel.count++] = plugin;
+  return RegistrationOutcome::kAdded;
+}
+
+void ChannelRegistry::Unregister(int64_t id, WindowChannelPlugin* plugin) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto* found = Find(id);
+  if (!found) {
+    return;
+  }
+  auto& channel = *found;
+
+  for (size_t i = 0; i < channel.count; i++) {
+    if (channel.plugins[i] == plugin) {
+      channel.plugins[i] = channel.plugins[--channel.count];
+      channel.plugins[channel.count] = nullptr;
+      return;
+    }
+  }
+  auto& subscribers = channel.subscribers;
+  subscribers.erase(
+      std::remove(subscribers.begin(), subscribers.end(), plugin),
+      subscribers.end());
+}
+
+RegistrationOutcome ChannelRegistry::Subscribe(int64_t id,
+                                               WindowChannelPlugin* plugin,
+                                               FlValue** retained) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto* found = Find(id);
+  if (!found) {
+    return RegistrationOutcome::kUnknownChannel;
+  }
+  auto& channel = *found;
+
+  if (channel.InUse() && channel.mode != ChannelMode::kPublishSubscribe) {
+    return RegistrationOutcome::kModeConflict;
+  }
+  channel.mode = ChannelMode::kPublishSubscribe;
+  *retained = channel.retained ? fl_value_ref(channel.retained) : nullptr;
+
+  auto& subscribers = channel.subscribers;
+  if (std::find(subscribers.begin(), subscribers.end(), plugin) !=
+      subscribers.end()) {
+    return RegistrationOutcome::kAlreadyRegistered;
+  }
+  subscribers.push_back(plugin);
+  return RegistrationOutcome::kAdded;
+}
+
+RegistrationOutcome ChannelRegistry::Publish(
+    int64_t id,
+    FlValue* value,
+    bool retain,
+    std::vector<WindowChannelPlugin*>* subscribers) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto* found = Find(id);
+  if (!found) {
+    return RegistrationOutcome::kUnknownChannel;
+  }
+  auto& channel = *found;
+
+  if (channel.InUse() && channel.mode != ChannelMode::kPublishSubscribe) {
+    return RegistrationOutcome::kModeConflict;
+  }
+  channel.mode = ChannelMode::kPublishSubscribe;
+  if (retain) {
+    if (channel.retained) {
+      fl_value_unref(channel.retained);
+    }
+    bool clear = fl_value_get_type(value) == FL_VALUE_TYPE_NULL;
+    channel.retained = clear ? nullptr : fl_value_ref(value);
+  }
+  *subscribers = channel.subscribers;
+  return RegistrationOutcome::kAdded;
+}
+
+TargetOutcome ChannelRegistry::GetTarget(int64_t id,
+                                         WindowChannelPlugin* from,
+                                         WindowChannelPlugin** target) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto* found = Find(id);
+  if (!found || found->count == 0) {
+    return TargetOutcome::kUnregistered;
+  }
+  const auto& channel = *found;
+
+  // Unidirectional - anyone can call
+  if (channel.mode == ChannelMode::kUnidirectional) {
+    *target = channel.plugins[0];
+    return TargetOutcome::kFound;
+  }
+
+  // Bidirectional - only the peer of a complete pair can call
+  if (channel.count == 2 && channel.Contains(from)) {
+    *target = channel.plugins[0] == from ? channel.plugins[1]
+                                         : channel.plugins[0];
+    return TargetOutcome::kFound;
+  }
+  return TargetOutcome::kNotAccessible;
+}
+
+ChannelRegistry::Channel* ChannelRegistry::Find(int64_t id) {
+  if (id <= 0 || id > static_cast<int64_t>(channels_.size())) {
+    return nullptr;
+  }
+  return &channels_[id - 1];
+}
@@ -0,0 +1,109 @@
+#ifndef DESKTOP_MULTI_WINDOW_LINUX_CHANNEL_REGISTRY_H_
+#define DESKTOP_MULTI_WINDOW_LINUX_CHANNEL_REGISTRY_H_
+
+#include <flutter_linux/flutter_linux.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "window_channel_plugin.h"
+
+enum class ChannelMode { kUnidirectional, kBidirectional, kPublishSubscribe };
+
+enum class RegistrationOutcome {
+  kAdded,
+  kAlreadyRegistered,
+  kLimitReached,
+  kModeConflict,
+  kUnknownChannel
+};
+
+enum class TargetOutcome {
+  kFound,
+  // registered, but not by the caller's pair, or the peer is missing
+  kNotAccessible,
+  // not registered, or an unknown id
+  kUnregistered
+};
+
+// Channel names are interned into ids, which index the channels directly, so
+// dispatching a call costs the same however many channels and windows exist.
+// A name keeps its id for the life of the registry, ids are never reused.
+//
+// The plugins of all engines share the registry of GetInstance().
+class ChannelRegistry {
+ public:
+  static ChannelRegistry& GetInstance();
+
+  ChannelRegistry() = default;
+  ~ChannelRegistry();
+
+  // The id of `channel`, interned on first use. Ids start at 1.
+  int64_t Intern(const std::string& channel);
+
+  // For error messages, the id itself if it is unknown.
+  std::string Name(int64_t id);
+
+  RegistrationOutcome Register(int64_t id,
+                               WindowChannelPlugin* plugin,
+                               ChannelMode mode);
+
+  // Removes `plugin` as a handler or a subscriber of the channel.
+  void Unregister(int64_t id, WindowChannelPlugin* plugin);
+
+  // Adds `plugin` to the subscribers of a publish/subscribe channel. The
+  // retained value, if any, is written to `retained` with a reference for the
+  // caller.
+  RegistrationOutcome Subscribe(int64_t id,
+                                WindowChannelPlugin* plugin,
+                                FlValue** retained);
+
+  // Copies the subscribers of a publish/subscribe channel to `subscribers`.
+  // If `retain`, `value` replaces the retained value, a null value clears it.
+  RegistrationOutcome Publish(int64_t id,
+                              FlValue* value,
+                              bool retain,
+                              std::vector<WindowChannelPlugin*>* subscribers);
+
+  // The handler of a unidirectional channel, or the peer of `from` in a
+  // bidirectional pair.
+  TargetOutcome GetTarget(int64_t id,
+                          WindowChannelPlugin* from,
+                          WindowChannelPlugin** target);
+
+ private:
+  struct Channel {
+    std::string name;
+    ChannelMode mode = ChannelMode::kBidirectional;
+    // the handler of a unidirectional channel, or the pair of a
+    // bidirectional one
+    WindowChannelPlugin* plugins[2] = {nullptr, nullptr};
+    size_t count = 0;
+    // of a publish/subscribe channel
+    std::vector<WindowChannelPlugin*> subscribers;
+    FlValue* retained = nullptr;
+
+    bool InUse() const {
+      return count > 0 || !subscribers.empty() || retained != nullptr;
+    }
+
+    bool Contains(WindowChannelPlugin* plugin) const {
+      return (count > 0 && plugins[0] == plugin) ||
+             (count > 1 && plugins[1] == plugin);
+    }
+  };
+
+  // mutex_ must be held
+  Channel* Find(int64_t id);
+
+  std::mutex mutex_;
+  std::unordered_map<std::string, int64_t> ids_;
+  // indexed by id - 1
+  std::vector<Channel> channels_;
+};
+
+#endif  // DESKTOP_MULTI_WINDOW_LINUX_CHANNEL_REGISTRY_H_
@@ -19,6 +19,9 @@ struct _DesktopMultiWindowPlugin {
   FlutterWindow* window;
 };
 
+// The broadcast channel of SharedStore changes.
+static constexpr char kStoreChannel[] = "mixin.one/desktop_multi_window/store";
+
 G_DEFINE_TYPE(DesktopMultiWindowPlugin,
               desktop_multi_window_plugin,
               g_object_get_type())
@@ -63,17 +66,54 @@ static void desktop_multi_window_plugin_handle_method_call(
     response = FL_METHOD_RESPONSE(
         fl_method_success_response_new(fl_value_new_string(window_id.c_str())));
   } else if (strcmp(method, "getWindowDefinition") == 0) {
-    auto window_id = self->window->GetWindowId();
-    auto window_argument = self->window->GetWindowArgument();
+    // a prewarmed window answers once it is handed out
+    self->window->RespondWindowDefinition(method_call);
+    return;
+  } else if (strcmp(method, "setPrewarmedWindowCount") == 0) {
+    auto* args = fl_method_call_get_args(method_call);
+    auto* count_value = fl_value_lookup_string(args, "count");
+    int64_t count = 0;
+    if (count_value && fl_value_get_type(count_value) == FL_VALUE_TYPE_INT) {
+      count = fl_value_get_int(count_value);
+    }
+    MultiWindowManager::Instance()->SetPrewarmedWindowCount(
+        count > 0 ? static_cast<size_t>(count) : 0);
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
+  } else if (strcmp(method, "storeSet") == 0) {
+    auto* args = fl_method_call_get_args(method_call);
+    auto* key_value = fl_value_lookup_string(args, "key");
+    auto* value = fl_value_lookup_string(args, "value");
+    if (key_value == nullptr ||
+        fl_value_get_type(key_value) != FL_VALUE_TYPE_STRING) {
+      g_autoptr(FlMethodResponse) error_response = FL_METHOD_RESPONSE(
+          fl_method_error_response_new("-1", "key is required", nullptr));
+      fl_method_call_respond(method_call, error_response, nullptr);
+      return;
+    }
+    const gchar* key = fl_value_get_string(key_value);
+
+    // the value arrives encoded by the writer, and is stored as it is
+    int64_t version;
+    if (value && fl_value_get_type(value) == FL_VALUE_TYPE_UINT8_LIST) {
+      version = MultiWindowManager::Instance()->Store().Set(
+          key, fl_value_get_uint8_list(value), fl_value_get_length(value));
+    } else {
+      version = MultiWindowManager::Instance()->Store().Set(key, nullptr, 0);
+    }
 
-    g_autoptr(FlValue) definition = fl_value_new_map();
-    fl_value_set_string_take(definition, "windowId",
-                             fl_value_new_string(window_id.c_str()));
-    fl_value_set_string_take(definition, "windowArgument",
-                             fl_value_new_string(window_argument.c_str()));
+    g_autoptr(FlValue) change = fl_value_new_map();
+    fl_value_set_string_take(change, "key", fl_value_new_string(key));
+    fl_value_set_string_take(change, "version", fl_value_new_int(version));
+    window_channel_plugin_publish(kStoreChannel, change, FALSE);
 
-    response = FL_METHOD_RESPONSE(fl_method_success_response_new(definition));
-  } else if (strcmp(method, "getAllWindows") == 0) {
+    response = FL_METHOD_RESPONSE(
+        fl_method_success_response_new(fl_value_new_int(version)));
+  } else if (strcmp(method, "getAllWindows") == 0 ||
+             strcmp(method, "resyncWindows") == 0) {
+    if (strcmp(method, "resyncWindows") == 0) {
+      // pending changes reach this engine before the snapshot
+      MultiWindowManager::Instance()->FlushWindowsChanged();
+    }
     auto windows = MultiWindowManager::Instance()->GetAllWindows();
     response = FL_METHOD_RESPONSE(fl_method_success_response_new(windows));
   } else {
@@ -7,7 +7,34 @@ FlutterWindow::FlutterWindow(const std::string& id,
                              GtkWidget* window)
     : id_(id), window_argument_(argument), window_(window) {}
 
-FlutterWindow::~FlutterWindow() = default;
+FlutterWindow::~FlutterWindow() {
+  g_clear_object(&pending_definition_);
+}
+
+void FlutterWindow::Bind(const std::string& id, const std::string& argument) {
+  id_ = id;
+  window_argument_ = argument;
+  if (pending_definition_) {
+    RespondWindowDefinition(pending_definition_);
+    g_clear_object(&pending_definition_);
+  }
+}
+
+void FlutterWindow::RespondWindowDefinition(FlMethodCall* method_call) {
+  if (!IsBound()) {
+    // the engine waits in fromCurrentEngine until the window is handed out
+    g_clear_object(&pending_definition_);
+    pending_definition_ = FL_METHOD_CALL(g_object_ref(method_call));
+    return;
+  }
+
+  g_autoptr(FlValue) definition = fl_value_new_map();
+  fl_value_set_string_take(definition, "windowId",
+                           fl_value_new_string(id_.c_str()));
+  fl_value_set_string_take(definition, "windowArgument",
+                           fl_value_new_string(window_argument_.c_str()));
+  fl_method_call_respond_success(method_call, definition, nullptr);
+}
 
 void FlutterWindow::SetChannel(FlMethodChannel* channel) {
   channel_ = channel;
@@ -22,6 +22,16 @@ class FlutterWindow {
 
   GtkWindow* GetWindow() { return GTK_WINDOW(window_); }
 
+  // False for a prewarmed window which has not been handed out yet.
+  bool IsBound() const { return !id_.empty(); }
+
+  // Hands a prewarmed window out as `id`, and answers its engine's pending
+  // window definition call.
+  void Bind(const std::string& id, const std::string& argument);
+
+  // Answers a getWindowDefinition call, once the window is bound.
+  void RespondWindowDefinition(FlMethodCall* method_call);
+
   void SetChannel(FlMethodChannel* channel);
 
   void NotifyWindowEvent(const gchar* event, FlValue* data);
@@ -39,6 +49,7 @@ class FlutterWindow {
   std::string window_argument_;
   GtkWidget* window_ = nullptr;
   FlMethodChannel* channel_ = nullptr;
+  FlMethodCall* pending_definition_ = nullptr;
 };
 
 #endif  // DESKTOP_MULTI_WINDOW_WINDOWS_FLUTTER_WINDOW_H_
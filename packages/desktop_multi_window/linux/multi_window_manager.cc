@@ -1,5 +1,6 @@
 #include "multi_window_manager.h"
 
+#include <algorithm>
 #include <iomanip>
 #include <random>
 #include <sstream>
@@ -52,10 +53,47 @@ std::string MultiWindowManager::Create(FlValue* args) {
   WindowConfiguration config = WindowConfiguration::FromFlValue(args);
   std::string window_id = GenerateWindowId();
 
-  // Create GTK window
-  GtkApplication* app = GTK_APPLICATION(g_application_get_default());
-  GtkWindow* window = GTK_WINDOW(gtk_application_window_new(app));
-  gtk_application_add_window(app, window);
+  std::unique_ptr<FlutterWindow> w;
+  if (!prewarmed_.empty()) {
+    w = std::move(prewarmed_.front());
+    prewarmed_.pop_front();
+    w->Bind(window_id, config.arguments);
+    gtk_application_add_window(GTK_APPLICATION(g_application_get_default()),
+                               w->GetWindow());
+    SchedulePrewarm();
+  } else {
+    w = BuildWindow(window_id, config.arguments);
+  }
+  GtkWindow* window = w->GetWindow();
+  windows_[window_id] = std::move(w);
+
+  if (!config.hidden_at_launch) {
+    gtk_widget_show(GTK_WIDGET(window));
+  }
+  ObserveWindowClose(window_id, window);
+
+  GtkWidget* fl_view = gtk_bin_get_child(GTK_BIN(window));
+  if (fl_view) {
+    gtk_widget_grab_focus(fl_view);
+  }
+
+  // Notify all windows about the change
+  NotifyWindowAdded(window_id);
+
+  return window_id;
+}
+
+std::unique_ptr<FlutterWindow> MultiWindowManager::BuildWindow(
+    const std::string& window_id,
+    const std::string& arguments) {
+  // Create GTK window. A prewarmed window joins the application when it is
+  // bound, the application would not quit while it holds a hidden window.
+  GtkWindow* window = GTK_WINDOW(
+      g_object_new(GTK_TYPE_APPLICATION_WINDOW, nullptr));
+  if (!window_id.empty()) {
+    gtk_application_add_window(GTK_APPLICATION(g_application_get_default()),
+                               window);
+  }
 
   gboolean use_header_bar = TRUE;
 #ifdef GDK_WINDOWING_X11
@@ -80,21 +118,18 @@ std::string MultiWindowManager::Create(FlValue* args) {
   gtk_window_set_default_size(window, 1280, 720);
 
   gtk_window_set_title(window, "");
-  if (config.hidden_at_launch) {
-    gtk_widget_realize(GTK_WIDGET(window));
-  } else {
-    gtk_widget_show(GTK_WIDGET(window));
-  }
+  // shown by Create unless hidden at launch
+  gtk_widget_realize(GTK_WIDGET(window));
 
   // Create FlutterWindow instance
-  auto w = std::make_unique<FlutterWindow>(window_id, config.arguments,
+  auto w = std::make_unique<FlutterWindow>(window_id, arguments,
                                            GTK_WIDGET(window));
-  windows_[window_id] = std::move(w);
 
-  // Setup Flutter project
+  // Setup Flutter project, a prewarmed engine gets its window id from
+  // getWindowDefinition once it is bound
   g_autoptr(FlDartProject) project = fl_dart_project_new();
   const char* entrypoint_args[] = {"multi_window", window_id.c_str(),
-                                   config.arguments.c_str(), nullptr};
+                                   arguments.c_str(), nullptr};
   fl_dart_project_set_dart_entrypoint_arguments(
       project, const_cast<char**>(entrypoint_args));
 
@@ -119,21 +154,45 @@ std::string MultiWindowManager::Create(FlValue* args) {
     _g_window_created_callback(FL_PLUGIN_REGISTRY(fl_view));
   }
 
-  ObserveWindowClose(window_id, window);
   // Register plugin
   g_autoptr(FlPluginRegistrar) desktop_multi_window_registrar =
       fl_plugin_registry_get_registrar_for_plugin(FL_PLUGIN_REGISTRY(fl_view),
                                                   "DesktopMultiWindowPlugin");
 
   desktop_multi_window_plugin_register_with_registrar_internal(
-      desktop_multi_window_registrar, windows_[window_id].get());
+      desktop_multi_window_registrar, w.get());
 
-  gtk_widget_grab_focus(GTK_WIDGET(fl_view));
+  return w;
+}
 
-  // Notify all windows about the change
-  NotifyWindowsChanged();
+void MultiWindowManager::SetPrewarmedWindowCount(size_t count) {
+  prewarmed_count_ = count;
+  while (prewarmed_.size() > prewarmed_count_) {
+    gtk_widget_destroy(GTK_WIDGET(prewarmed_.back()->GetWindow()));
+    prewarmed_.pop_back();
+  }
+  SchedulePrewarm();
+}
 
-  return window_id;
+void MultiWindowManager::SchedulePrewarm() {
+  if (prewarm_source_ == 0 && prewarmed_.size() < prewarmed_count_) {
+    prewarm_source_ =
+        g_idle_add_full(G_PRIORITY_LOW, PrewarmOnIdle, this, nullptr);
+  }
+}
+
+// static
+gboolean MultiWindowManager::PrewarmOnIdle(gpointer user_data) {
+  auto* self = static_cast<MultiWindowManager*>(user_data);
+  // one window per idle callback, so input and frames run in between
+  if (self->prewarmed_.size() < self->prewarmed_count_) {
+    self->prewarmed_.push_back(self->BuildWindow("", ""));
+  }
+  if (self->prewarmed_.size() < self->prewarmed_count_) {
+    return G_SOURCE_CONTINUE;
+  }
+  self->prewarm_source_ = 0;
+  return G_SOURCE_REMOVE;
 }
 
 void MultiWindowManager::AttachMainWindow(GtkWidget* window_widget,
@@ -155,7 +214,7 @@ void MultiWindowManager::AttachMainWindow(GtkWidget* window_widget,
       registrar, windows_[main_window_id].get());
 
   // Notify all windows about the change
-  NotifyWindowsChanged();
+  NotifyWindowAdded(main_window_id);
 }
 
 void MultiWindowManager::ObserveWindowClose(const std::string& window_id,
@@ -207,16 +266,60 @@ std::vector<std::string> MultiWindowManager::GetAllWindowIds() {
   return window_ids;
 }
 
-void MultiWindowManager::NotifyWindowsChanged() {
-  auto window_ids = GetAllWindowIds();
+void MultiWindowManager::NotifyWindowAdded(const std::string& window_id) {
+  added_window_ids_.push_back(window_id);
+  ScheduleWindowsChanged();
+}
 
-  g_autoptr(FlValue) window_ids_list = fl_value_new_list();
-  for (const auto& id : window_ids) {
-    fl_value_append_take(window_ids_list, fl_value_new_string(id.c_str()));
+void MultiWindowManager::NotifyWindowRemoved(const std::string& window_id) {
+  // a window which came and went within the batch is not reported at all
+  auto added = std::find(added_window_ids_.begin(), added_window_ids_.end(),
+                         window_id);
+  if (added != added_window_ids_.end()) {
+    added_window_ids_.erase(added);
+    return;
+  }
+  removed_window_ids_.push_back(window_id);
+  ScheduleWindowsChanged();
+}
+
+void MultiWindowManager::ScheduleWindowsChanged() {
+  if (windows_changed_source_ == 0) {
+    windows_changed_source_ = g_idle_add(WindowsChangedOnIdle, this);
+  }
+}
+
+// static
+gboolean MultiWindowManager::WindowsChangedOnIdle(gpointer user_data) {
+  auto* self = static_cast<MultiWindowManager*>(user_data);
+  self->windows_changed_source_ = 0;
+  self->FlushWindowsChanged();
+  return G_SOURCE_REMOVE;
+}
+
+void MultiWindowManager::FlushWindowsChanged() {
+  if (windows_changed_source_ != 0) {
+    g_source_remove(windows_changed_source_);
+    windows_changed_source_ = 0;
+  }
+  if (added_window_ids_.empty() && removed_window_ids_.empty()) {
+    return;
+  }
+
+  g_autoptr(FlValue) added = fl_value_new_list();
+  for (const auto& id : added_window_ids_) {
+    fl_value_append_take(added, fl_value_new_string(id.c_str()));
+  }
+  g_autoptr(FlValue) removed = fl_value_new_list();
+  for (const auto& id : removed_window_ids_) {
+    fl_value_append_take(removed, fl_value_new_string(id.c_str()));
   }
+  added_window_ids_.clear();
+  removed_window_ids_.clear();
 
   g_autoptr(FlValue) data = fl_value_new_map();
-  fl_value_set_string_take(data, "windowIds", fl_value_ref(window_ids_list));
+  fl_value_set_string(data, "added", added);
+  fl_value_set_string(data, "removed", removed);
 
   for (const auto& pair : windows_) {
     pair.second->NotifyWindowEvent("onWindowsChanged", data);
@@ -226,7 +329,7 @@ void MultiWindowManager::NotifyWindowsChanged() {
 void MultiWindowManager::RemoveWindow(const std::string& window_id) {
   g_warning("RemoveWindow: %s", window_id.c_str());
   windows_.erase(window_id);
-  NotifyWindowsChanged();
+  NotifyWindowRemoved(window_id);
 }
 
 void desktop_multi_window_plugin_set_window_created_callback(
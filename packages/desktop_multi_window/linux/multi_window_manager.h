@@ -3,6 +3,7 @@
 
 #include <cmath>
 #include <cstdint>
+#include <deque>
 #include <map>
 #include <string>
 #include <vector>
@@ -10,7 +11,9 @@
 #include <flutter_linux/flutter_linux.h>
 #include <gtk/gtk.h>
 
+#include "blob_store.h"
 #include "flutter_window.h"
+#include "shared_store.h"
 
 class MultiWindowManager
     : public std::enable_shared_from_this<MultiWindowManager> {
@@ -34,14 +37,58 @@ class MultiWindowManager
 
   void RemoveWindow(const std::string& window_id);
 
+  // Sends the pending onWindowsChanged notification now, so that a snapshot
+  // taken next is followed only by later changes.
+  void FlushWindowsChanged();
+
+  // Buffers shared by the engines of all windows.
+  BlobStore& Blobs() { return blobs_; }
+
+  // Values shared by the engines of all windows.
+  SharedStore& Store() { return store_; }
+
+  // Keeps `count` hidden windows with started engines, created while the main
+  // loop is idle, so that Create only binds one to the new window id. They
+  // are added to the application when bound, so they do not keep it running.
+  void SetPrewarmedWindowCount(size_t count);
+
  private:
 
+  // Builds a hidden window and starts its engine. An empty `window_id` builds
+  // a prewarmed window, bound later.
+  std::unique_ptr<FlutterWindow> BuildWindow(const std::string& window_id,
+                                             const std::string& arguments);
+
+  void SchedulePrewarm();
+
+  static gboolean PrewarmOnIdle(gpointer user_data);
+
   void ObserveWindowClose(const std::string& window_id,
                             GtkWindow* window);
 
-  void NotifyWindowsChanged();
+  // Batches window changes of one main loop iteration into a single
+  // onWindowsChanged notification of the added and removed ids.
+  void NotifyWindowAdded(const std::string& window_id);
+
+  void NotifyWindowRemoved(const std::string& window_id);
+
+  void ScheduleWindowsChanged();
+
+  static gboolean WindowsChangedOnIdle(gpointer user_data);
 
   std::map<std::string, std::unique_ptr<FlutterWindow>> windows_;
+
+  BlobStore blobs_;
+
+  SharedStore store_;
+
+  std::deque<std::unique_ptr<FlutterWindow>> prewarmed_;
+  size_t prewarmed_count_ = 0;
+  guint prewarm_source_ = 0;
+
+  std::vector<std::string> added_window_ids_;
+  std::vector<std::string> removed_window_ids_;
+  guint windows_changed_source_ = 0;
 };
 
 #endif  // DESKTOP_MULTI_WINDOW_WINDOWS_MULTI_WINDOW_MANAGER_H_
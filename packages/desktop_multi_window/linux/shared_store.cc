@@ -0,0 +1,82 @@
+#include "shared_store.h"
+
+#include <cstring>
+
+#include "blob_store.h"
+#include "multi_window_manager.h"
+
+SharedStore::~SharedStore() {
+  for (const auto& pair : entries_) {
+    BlobStore::Release(pair.second.data);
+  }
+}
+
+int64_t SharedStore::Set(const std::string& key,
+                         const uint8_t* data,
+                         size_t size) {
+  uint8_t* value = nullptr;
+  if (data) {
+    value = BlobStore::Allocate(size);
+    if (!value) {
+      return 0;
+    }
+    memcpy(value, data, size);
+  }
+
+  uint8_t* replaced = nullptr;
+  int64_t version;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    version = ++version_;
+    auto it = entries_.find(key);
+    if (it != entries_.end()) {
+      replaced = it->second.data;
+      if (value) {
+        it->second = {value, version};
+      } else {
+        entries_.erase(it);
+      }
+    } else if (value) {
+      entries_[key] = {value, version};
+    }
+  }
+  // readers holding the old value keep it alive.
+  if (replaced) {
+    BlobStore::Release(replaced);
+  }
+  return version;
+}
+
+uint8_t* SharedStore::Acquire(const std::string& key,
+                              size_t* size,
+                              int64_t* version) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(key);
+  if (it == entries_.end()) {
+    return nullptr;
+  }
+  BlobStore::Retain(it->second.data);
+  *size = BlobStore::SizeOf(it->second.data);
+  *version = it->second.version;
+  return it->second.data;
+}
+
+int64_t SharedStore::Version(const std::string& key) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(key);
+  return it == entries_.end() ? 0 : it->second.version;
+}
+
+int64_t desktop_multi_window_store_version(const char* key) {
+  return MultiWindowManager::Instance()->Store().Version(key);
+}
+
+uint8_t* desktop_multi_window_store_acquire(const char* key,
+                                            int64_t* size,
+                                            int64_t* version) {
+  size_t value_size = 0;
+  auto* data = MultiWindowManager::Instance()->Store().Acquire(
+      key, &value_size, version);
+  *size = static_cast<int64_t>(value_size);
+  return data;
+}
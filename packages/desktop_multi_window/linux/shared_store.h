@@ -0,0 +1,65 @@
+#ifndef DESKTOP_MULTI_WINDOW_LINUX_SHARED_STORE_H_
+#define DESKTOP_MULTI_WINDOW_LINUX_SHARED_STORE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "include/desktop_multi_window/desktop_multi_window_plugin.h"
+
+// Small values shared by the engines of all windows, such as the current user
+// or the theme. Values are kept as encoded by the StandardMessageCodec of the
+// writer, and read synchronously by every engine through dart:ffi, so a value
+// is encoded once however many windows read it.
+//
+// Each value is a BlobStore buffer, readers keep it alive after it is
+// replaced. Every write increments the version of the store, a value keeps the
+// version it was written at.
+class SharedStore {
+ public:
+  SharedStore() = default;
+  ~SharedStore();
+
+  // Replaces the value of `key` with a copy of `size` encoded bytes, or
+  // removes it if `data` is null. Returns the new version of the store, or 0
+  // if the value can not be allocated.
+  int64_t Set(const std::string& key, const uint8_t* data, size_t size);
+
+  // The encoded value of `key` with a reference for the caller, released by
+  // BlobStore::Release, or null if there is none. Its size and version are
+  // written to `size` and `version`.
+  uint8_t* Acquire(const std::string& key, size_t* size, int64_t* version);
+
+  // Version of the value of `key`, or 0 if there is none.
+  int64_t Version(const std::string& key);
+
+ private:
+  struct Entry {
+    uint8_t* data;
+    int64_t version;
+  };
+
+  std::mutex mutex_;
+  std::unordered_map<std::string, Entry> entries_;
+  int64_t version_ = 0;
+};
+
+G_BEGIN_DECLS
+
+// dart:ffi entry points of SharedStore, on the store of MultiWindowManager.
+// Writes go through the window channel, which notifies the other windows.
+
+FLUTTER_PLUGIN_EXPORT int64_t
+desktop_multi_window_store_version(const char* key);
+
+// Release the value with desktop_multi_window_blob_release.
+FLUTTER_PLUGIN_EXPORT uint8_t* desktop_multi_window_store_acquire(
+    const char* key,
+    int64_t* size,
+    int64_t* version);
+
+G_END_DECLS
+
+#endif  // DESKTOP_MULTI_WINDOW_LINUX_SHARED_STORE_H_
@@ -0,0 +1,300 @@
+#include <flutter_linux/flutter_linux.h>
+#include <gtest/gtest.h>
+
+#include <cstring>
+
+#include "blob_store.h"
+#include "channel_registry.h"
+#include "shared_store.h"
+#include "window_channel_plugin.h"
+
+namespace desktop_multi_window {
+namespace test {
+
+// Typed lists are padded from the start of the whole message, the published
+// value follows the method name in the same buffer.
+TEST(WindowChannelPlugin, EncodesPublishedFloat64List) {
+  const double values[] = {1.5, -2.25, 3.125};
+  g_autoptr(FlValue) event = fl_value_new_map();
+  fl_value_set_string_take(event, "channel", fl_value_new_string("state"));
+  fl_value_set_string_take(event, "channelId", fl_value_new_int(1));
+  fl_value_set_string_take(event, "value", fl_value_new_float_list(values, 3));
+
+  g_autoptr(GError) error = nullptr;
+  g_autoptr(GBytes) message =
+      window_channel_plugin_encode_method_call("onPublish", event, &error);
+  ASSERT_NE(message, nullptr) << error->message;
+
+  // read as the standard method codec of the receiving engine does
+  g_autoptr(FlStandardMessageCodec) codec = fl_standard_message_codec_new();
+  size_t offset = 0;
+  g_autoptr(FlValue) name =
+      fl_standard_message_codec_read_value(codec, message, &offset, &error);
+  ASSERT_NE(name, nullptr) << error->message;
+  EXPECT_STREQ(fl_value_get_string(name), "onPublish");
+
+  g_autoptr(FlValue) args =
+      fl_standard_message_codec_read_value(codec, message, &offset, &error);
+  ASSERT_NE(args, nullptr) << error->message;
+  EXPECT_EQ(offset, g_bytes_get_size(message));
+
+  FlValue* value = fl_value_lookup_string(args, "value");
+  ASSERT_NE(value, nullptr);
+  ASSERT_EQ(fl_value_get_type(value), FL_VALUE_TYPE_FLOAT_LIST);
+  ASSERT_EQ(fl_value_get_length(value), 3u);
+  const double* decoded = fl_value_get_float_list(value);
+  for (size_t i = 0; i < 3; i++) {
+    EXPECT_EQ(decoded[i], values[i]);
+  }
+}
+
+TEST(BlobStore, ViewsOutliveUnpublish) {
+  BlobStore store;
+  int64_t handle = store.Create(16);
+  ASSERT_GT(handle, 0);
+  EXPECT_EQ(store.Size(handle), 16);
+
+  size_t size = 0;
+  uint8_t* data = store.Acquire(handle, &size);
+  ASSERT_NE(data, nullptr);
+  EXPECT_EQ(size, 16u);
+  for (size_t i = 0; i < size; i++) {
+    EXPECT_EQ(data[i], 0);
+  }
+  data[0] = 42;
+
+  // the handle can not be opened anymore, the view keeps the data
+  store.Unpublish(data);
+  EXPECT_EQ(store.Acquire(handle, &size), nullptr);
+  EXPECT_EQ(store.Size(handle), -1);
+  EXPECT_EQ(data[0], 42);
+  // a second unpublish does not drop the reference of the view
+  store.Unpublish(data);
+  EXPECT_EQ(data[0], 42);
+  BlobStore::Release(data);
+}
+
+TEST(BlobStore, ReleasedViewsKeepTheBlobPublished) {
+  BlobStore store;
+  int64_t handle = store.Create(8);
+  size_t size = 0;
+  uint8_t* first = store.Acquire(handle, &size);
+  ASSERT_NE(first, nullptr);
+  first[7] = 7;
+  BlobStore::Release(first);
+
+  uint8_t* second = store.Acquire(handle, &size);
+  ASSERT_EQ(second, first);
+  EXPECT_EQ(second[7], 7);
+  store.Unpublish(second);
+  BlobStore::Release(second);
+
+  EXPECT_EQ(store.Acquire(handle + 1, &size), nullptr);
+  EXPECT_NE(store.Create(8), handle);
+}
+
+TEST(BlobStore, ViewsOutliveTheStore) {
+  uint8_t* data;
+  {
+    BlobStore store;
+    size_t size = 0;
+    data = store.Acquire(store.Create(4), &size);
+    ASSERT_NE(data, nullptr);
+  }
+  data[3] = 3;
+  EXPECT_EQ(BlobStore::SizeOf(data), 4u);
+  BlobStore::Release(data);
+}
+
+TEST(BlobStore, AllocateAndRetain) {
+  uint8_t* data = BlobStore::Allocate(32);
+  ASSERT_NE(data, nullptr);
+  EXPECT_EQ(BlobStore::SizeOf(data), 32u);
+  BlobStore::Retain(data);
+  BlobStore::Release(data);
+  data[31] = 1;
+  BlobStore::Release(data);
+}
+
+TEST(SharedStore, VersionsIncreaseOnEveryWrite) {
+  SharedStore store;
+  const uint8_t user[] = {1, 2, 3};
+  const uint8_t theme[] = {4};
+  int64_t first = store.Set("user", user, sizeof(user));
+  int64_t second = store.Set("theme", theme, sizeof(theme));
+  EXPECT_GT(first, 0);
+  EXPECT_GT(second, first);
+  EXPECT_EQ(store.Version("user"), first);
+  EXPECT_EQ(store.Version("theme"), second);
+  EXPECT_EQ(store.Version("unknown"), 0);
+
+  size_t size = 0;
+  int64_t version = 0;
+  uint8_t* data = store.Acquire("user", &size, &version);
+  ASSERT_NE(data, nullptr);
+  ASSERT_EQ(size, sizeof(user));
+  EXPECT_EQ(memcmp(data, user, size), 0);
+  EXPECT_EQ(version, first);
+  BlobStore::Release(data);
+
+  EXPECT_EQ(store.Acquire("unknown", &size, &version), nullptr);
+}
+
+TEST(SharedStore, ReadersKeepReplacedValues) {
+  SharedStore store;
+  const uint8_t light[] = {'l', 'i', 'g', 'h', 't'};
+  const uint8_t dark[] = {'d', 'a', 'r', 'k'};
+  store.Set("theme", light, sizeof(light));
+
+  size_t size = 0;
+  int64_t version = 0;
+  uint8_t* old_value = store.Acquire("theme", &size, &version);
+  ASSERT_NE(old_value, nullptr);
+  int64_t replaced = store.Set("theme", dark, sizeof(dark));
+  EXPECT_GT(replaced, version);
+  EXPECT_EQ(memcmp(old_value, light, sizeof(light)), 0);
+  EXPECT_EQ(BlobStore::SizeOf(old_value), sizeof(light));
+  BlobStore::Release(old_value);
+
+  int64_t new_version = 0;
+  uint8_t* new_value = store.Acquire("theme", &size, &new_version);
+  ASSERT_NE(new_value, nullptr);
+  ASSERT_EQ(size, sizeof(dark));
+  EXPECT_EQ(memcmp(new_value, dark, size), 0);
+  EXPECT_EQ(new_version, replaced);
+  BlobStore::Release(new_value);
+}
+
+TEST(SharedStore, NullRemovesTheValue) {
+  SharedStore store;
+  const uint8_t user[] = {7};
+  int64_t written = store.Set("user", user, sizeof(user));
+
+  size_t size = 0;
+  int64_t version = 0;
+  uint8_t* reader = store.Acquire("user", &size, &version);
+  ASSERT_NE(reader, nullptr);
+  int64_t removed = store.Set("user", nullptr, 0);
+  EXPECT_GT(removed, written);
+  EXPECT_EQ(store.Version("user"), 0);
+  EXPECT_EQ(store.Acquire("user", &size, &version), nullptr);
+  EXPECT_EQ(reader[0], 7);
+  BlobStore::Release(reader);
+
+  // removing a missing key is still a write
+  EXPECT_GT(store.Set("user", nullptr, 0), removed);
+}
+
+// The registry only compares plugins, any distinct pointers will do.
+static WindowChannelPlugin* FakePlugin(int* window) {
+  return reinterpret_cast<WindowChannelPlugin*>(window);
+}
+
+TEST(ChannelRegistry, InternsNamesOnce) {
+  ChannelRegistry registry;
+  int64_t first = registry.Intern("first");
+  int64_t second = registry.Intern("second");
+  EXPECT_GT(first, 0);
+  EXPECT_NE(first, second);
+  EXPECT_EQ(registry.Intern("first"), first);
+  EXPECT_EQ(registry.Name(second), "second");
+  EXPECT_EQ(registry.Name(42), "#42");
+}
+
+TEST(ChannelRegistry, UnidirectionalChannelsHaveOneHandler) {
+  ChannelRegistry registry;
+  int handler_window, caller_window;
+  auto* handler = FakePlugin(&handler_window);
+  auto* caller = FakePlugin(&caller_window);
+  int64_t id = registry.Intern("unidirectional");
+
+  WindowChannelPlugin* target = nullptr;
+  EXPECT_EQ(registry.GetTarget(id, caller, &target),
+            TargetOutcome::kUnregistered);
+  EXPECT_EQ(registry.Register(id, handler, ChannelMode::kUnidirectional),
+            RegistrationOutcome::kAdded);
+  EXPECT_EQ(registry.Register(id, handler, ChannelMode::kUnidirectional),
+            RegistrationOutcome::kAlreadyRegistered);
+  EXPECT_EQ(registry.Register(id, caller, ChannelMode::kUnidirectional),
+            RegistrationOutcome::kLimitReached);
+
+  // anyone can call the handler
+  ASSERT_EQ(registry.GetTarget(id, caller, &target), TargetOutcome::kFound);
+  EXPECT_EQ(target, handler);
+
+  registry.Unregister(id, handler);
+  EXPECT_EQ(registry.GetTarget(id, caller, &target),
+            TargetOutcome::kUnregistered);
+  EXPECT_EQ(registry.Register(id, caller, ChannelMode::kUnidirectional),
+            RegistrationOutcome::kAdded);
+}
+
+TEST(ChannelRegistry, BidirectionalChannelsConnectAPair) {
+  ChannelRegistry registry;
+  int first_window, second_window, third_window;
+  auto* first = FakePlugin(&first_window);
+  auto* second = FakePlugin(&second_window);
+  auto* third = FakePlugin(&third_window);
+  int64_t id = registry.Intern("bidirectional");
+
+  ASSERT_EQ(registry.Register(id, first, ChannelMode::kBidirectional),
+            RegistrationOutcome::kAdded);
+  WindowChannelPlugin* target = nullptr;
+  EXPECT_EQ(registry.GetTarget(id, first, &target),
+            TargetOutcome::kNotAccessible);
+
+  ASSERT_EQ(registry.Register(id, second, ChannelMode::kBidirectional),
+            RegistrationOutcome::kAdded);
+  EXPECT_EQ(registry.Register(id, third, ChannelMode::kBidirectional),
+            RegistrationOutcome::kLimitReached);
+
+  ASSERT_EQ(registry.GetTarget(id, first, &target), TargetOutcome::kFound);
+  EXPECT_EQ(target, second);
+  ASSERT_EQ(registry.GetTarget(id, second, &target), TargetOutcome::kFound);
+  EXPECT_EQ(target, first);
+  EXPECT_EQ(registry.GetTarget(id, third, &target),
+            TargetOutcome::kNotAccessible);
+
+  registry.Unregister(id, first);
+  EXPECT_EQ(registry.GetTarget(id, second, &target),
+            TargetOutcome::kNotAccessible);
+}
+
+TEST(ChannelRegistry, ModesConflict) {
+  ChannelRegistry registry;
+  int first_window, second_window;
+  auto* first = FakePlugin(&first_window);
+  auto* second = FakePlugin(&second_window);
+  int64_t id = registry.Intern("conflict");
+
+  ASSERT_EQ(registry.Register(id, first, ChannelMode::kUnidirectional),
+            RegistrationOutcome::kAdded);
+  EXPECT_EQ(registry.Register(id, second, ChannelMode::kBidirectional),
+            RegistrationOutcome::kModeConflict);
+  FlValue* retained = nullptr;
+  EXPECT_EQ(registry.Subscribe(id, second, &retained),
+            RegistrationOutcome::kModeConflict);
+
+  // an unused channel takes the mode of its next registration
+  registry.Unregister(id, first);
+  EXPECT_EQ(registry.Register(id, second, ChannelMode::kBidirectional),
+            RegistrationOutcome::kAdded);
+}
+
+TEST(ChannelRegistry, UnknownIds) {
+  ChannelRegistry registry;
+  int window;
+  auto* plugin = FakePlugin(&window);
+  int64_t id = registry.Intern("known");
+
+  WindowChannelPlugin* target = nullptr;
+  for (int64_t unknown : {int64_t{0}, int64_t{-1}, id + 1}) {
+    EXPECT_EQ(registry.Register(unknown, plugin, ChannelMode::kBidirectional),
+              RegistrationOutcome::kUnknownChannel);
+    EXPECT_EQ(registry.GetTarget(unknown, plugin, &target),
+              TargetOutcome::kUnregistered);
+  }
+}
+
+}  // namespace test
+}  // namespace desktop_multi_window
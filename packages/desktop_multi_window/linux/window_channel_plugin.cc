@@ -1,179 +1,53 @@
 #include "window_channel_plugin.h"
 
-#include <algorithm>
 #include <cstring>
-#include <map>
-#include <memory>
-#include <mutex>
-#include <set>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
-enum class ChannelMode { kUnidirectional, kBidirectional };
+#include "channel_registry.h"
 
-enum class RegistrationOutcome {
-  kAdded,
-  kAlreadyRegistered,
-  kLimitReached,
-  kModeConflict
-};
+static constexpr char kChannelName[] = "mixin.one/desktop_multi_window/channels";
 
 struct _WindowChannelPlugin {
   GObject parent_instance;
   FlMethodChannel* channel;
-  std::vector<std::string>* registered_channels;
+  // published values are sent to kChannelName of this messenger
+  FlBinaryMessenger* messenger;
+  // the view of the engine, weakly referenced, null once it is destroyed
+  FlView* view;
+  // ids of the channels this engine registered a handler for, or subscribed
+  std::unordered_set<int64_t>* registered_channels;
 };
 
 G_DEFINE_TYPE(WindowChannelPlugin, window_channel_plugin, G_TYPE_OBJECT)
 
-class ChannelRegistry {
- public:
-  static ChannelRegistry& GetInstance() {
-    static ChannelRegistry instance;
-    return instance;
-  }
-
-  RegistrationOutcome Register(const std::string& channel,
-                                WindowChannelPlugin* plugin,
-                                ChannelMode mode) {
-    std::lock_guard<std::mutex> lock(mutex_);
-
-    if (mode == ChannelMode::kUnidirectional) {
-      return RegisterUnidirectional(channel, plugin);
-    } else {
-      return RegisterBidirectional(channel, plugin);
-    }
-  }
+static void window_channel_plugin_view_destroyed(gpointer data,
+                                                  GObject* view);
 
- private:
-  RegistrationOutcome RegisterUnidirectional(const std::string& channel,
-                                              WindowChannelPlugin* plugin) {
-    // Check if already used in bidirectional mode
-    if (bidirectional_channels_.find(channel) !=
-        bidirectional_channels_.end()) {
-      return RegistrationOutcome::kModeConflict;
-    }
-
-    auto it = unidirectional_channels_.find(channel);
-    if (it != unidirectional_channels_.end()) {
-      if (it->second == plugin) {
-        return RegistrationOutcome::kAlreadyRegistered;
-      }
-      // Already registered by another plugin
-      return RegistrationOutcome::kLimitReached;
-    }
-
-    unidirectional_channels_[channel] = plugin;
-    return RegistrationOutcome::kAdded;
-  }
-
-  RegistrationOutcome RegisterBidirectional(const std::string& channel,
-                                             WindowChannelPlugin* plugin) {
-    // Check if already used in unidirectional mode
-    if (unidirectional_channels_.find(channel) !=
-        unidirectional_channels_.end()) {
-      return RegistrationOutcome::kModeConflict;
-    }
-
-    auto& plugins = bidirectional_channels_[channel];
-
-    // Check if already registered
-    if (plugins.find(plugin) != plugins.end()) {
-      return RegistrationOutcome::kAlreadyRegistered;
-    }
-
-    // Check limit
-    if (plugins.size() >= 2) {
-      return RegistrationOutcome::kLimitReached;
-    }
-
-    plugins.insert(plugin);
-    return RegistrationOutcome::kAdded;
-  }
-
- public:
-  void Unregister(const std::string& channel, WindowChannelPlugin* plugin) {
-    std::lock_guard<std::mutex> lock(mutex_);
-
-    // Try unidirectional
-    auto uni_it = unidirectional_channels_.find(channel);
-    if (uni_it != unidirectional_channels_.end() &&
-        uni_it->second == plugin) {
-      unidirectional_channels_.erase(uni_it);
-      return;
-    }
-
-    // Try bidirectional
-    auto bi_it = bidirectional_channels_.find(channel);
-    if (bi_it != bidirectional_channels_.end()) {
-      bi_it->second.erase(plugin);
-      if (bi_it->second.empty()) {
-        bidirectional_channels_.erase(bi_it);
-      }
-    }
+// Removes the plugin from every channel it registered or subscribed to.
+static void window_channel_plugin_unregister_all(WindowChannelPlugin* self) {
+  for (auto channel_id : *self->registered_channels) {
+    ChannelRegistry::GetInstance().Unregister(channel_id, self);
   }
-
-  WindowChannelPlugin* GetTarget(const std::string& channel,
-                                  WindowChannelPlugin* from) {
-    std::lock_guard<std::mutex> lock(mutex_);
-
-    // Check unidirectional - anyone can call
-    auto uni_it = unidirectional_channels_.find(channel);
-    if (uni_it != unidirectional_channels_.end()) {
-      return uni_it->second;
-    }
-
-    // Check bidirectional - only peer can call
-    auto bi_it = bidirectional_channels_.find(channel);
-    if (bi_it != bidirectional_channels_.end()) {
-      const auto& plugins = bi_it->second;
-
-      // Check if caller is in the pair
-      if (plugins.find(from) == plugins.end()) {
-        return nullptr;
-      }
-
-      // Return the peer
-      for (auto* plugin : plugins) {
-        if (plugin != from) {
-          return plugin;
-        }
-      }
-    }
-
-    return nullptr;
-  }
-
-  bool HasRegistrations(const std::string& channel) {
-    std::lock_guard<std::mutex> lock(mutex_);
-
-    if (unidirectional_channels_.find(channel) !=
-        unidirectional_channels_.end()) {
-      return true;
-    }
-
-    auto it = bidirectional_channels_.find(channel);
-    return it != bidirectional_channels_.end() && !it->second.empty();
-  }
-
- private:
-  ChannelRegistry() = default;
-  std::mutex mutex_;
-  std::map<std::string, WindowChannelPlugin*> unidirectional_channels_;
-  std::map<std::string, std::set<WindowChannelPlugin*>>
-      bidirectional_channels_;
-};
+  self->registered_channels->clear();
+}
 
 static void window_channel_plugin_dispose(GObject* object) {
   WindowChannelPlugin* self = (WindowChannelPlugin*)object;
 
+  if (self->view) {
+    g_object_weak_unref(G_OBJECT(self->view),
+                        window_channel_plugin_view_destroyed, self);
+    self->view = nullptr;
+  }
   if (self->registered_channels) {
-    for (const auto& channel : *self->registered_channels) {
-      ChannelRegistry::GetInstance().Unregister(channel, self);
-    }
+    window_channel_plugin_unregister_all(self);
     delete self->registered_channels;
     self->registered_channels = nullptr;
   }
+  g_clear_object(&self->channel);
+  g_clear_object(&self->messenger);
 
   G_OBJECT_CLASS(window_channel_plugin_parent_class)->dispose(object);
 }
@@ -183,19 +57,18 @@ static void window_channel_plugin_class_init(WindowChannelPluginClass* klass) {
 }
 
 static void window_channel_plugin_init(WindowChannelPlugin* self) {
-  self->registered_channels = new std::vector<std::string>();
+  self->registered_channels = new std::unordered_set<int64_t>();
 }
 
 void window_channel_plugin_invoke_method(WindowChannelPlugin* self,
-                                         const gchar* channel,
+                                         int64_t channel_id,
                                          FlValue* arguments,
                                          FlMethodCall* method_call) {
   // Check if this plugin has registered this channel
-  auto it = std::find(self->registered_channels->begin(),
-                      self->registered_channels->end(), std::string(channel));
-  if (it == self->registered_channels->end()) {
-    g_autofree gchar* error_msg =
-        g_strdup_printf("channel %s not found in this engine", channel);
+  if (self->registered_channels->count(channel_id) == 0) {
+    auto channel = ChannelRegistry::GetInstance().Name(channel_id);
+    g_autofree gchar* error_msg = g_strdup_printf(
+        "channel %s not found in this engine", channel.c_str());
     fl_method_call_respond_error(method_call, "CHANNEL_NOT_FOUND", error_msg,
                                  nullptr, nullptr);
     return;
@@ -224,6 +97,101 @@ void window_channel_plugin_invoke_method(WindowChannelPlugin* self,
                                   g_object_ref(method_call));
 }
 
+GBytes* window_channel_plugin_encode_method_call(const gchar* name,
+                                                FlValue* args,
+                                                GError** error) {
+  // one buffer, typed lists are padded from the start of the whole message
+  // as the decoder expects
+  g_autoptr(FlStandardMessageCodec) codec = fl_standard_message_codec_new();
+  g_autoptr(GByteArray) buffer = g_byte_array_new();
+  g_autoptr(FlValue) name_value = fl_value_new_string(name);
+  if (!fl_standard_message_codec_write_value(codec, buffer, name_value,
+                                             error) ||
+      !fl_standard_message_codec_write_value(codec, buffer, args, error)) {
+    return nullptr;
+  }
+  return g_byte_array_free_to_bytes(
+      static_cast<GByteArray*>(g_steal_pointer(&buffer)));
+}
+
+// Sends `value` published on `channel_id` to its subscribers.
+static bool send_to_subscribers(
+    int64_t channel_id,
+    const std::string& channel_name,
+    FlValue* value,
+    const std::vector<WindowChannelPlugin*>& subscribers,
+    GError** error) {
+  if (subscribers.empty()) {
+    return true;
+  }
+
+  g_autoptr(FlValue) event = fl_value_new_map();
+  fl_value_set_string_take(event, "channel",
+                           fl_value_new_string(channel_name.c_str()));
+  fl_value_set_string_take(event, "channelId", fl_value_new_int(channel_id));
+  fl_value_set_string(event, "value", value);
+
+  // encoded once, every engine decodes the same bytes
+  g_autoptr(GBytes) message =
+      window_channel_plugin_encode_method_call("onPublish", event, error);
+  if (message == nullptr) {
+    return false;
+  }
+  for (auto* subscriber : subscribers) {
+    fl_binary_messenger_send_on_channel(subscriber->messenger, kChannelName,
+                                        message, nullptr, nullptr, nullptr);
+  }
+  return true;
+}
+
+void window_channel_plugin_publish(const gchar* channel,
+                                   FlValue* value,
+                                   gboolean retain) {
+  auto& registry = ChannelRegistry::GetInstance();
+  int64_t channel_id = registry.Intern(channel);
+  std::vector<WindowChannelPlugin*> subscribers;
+  if (registry.Publish(channel_id, value, retain, &subscribers) !=
+      RegistrationOutcome::kAdded) {
+    g_warning("channel %s is already registered in a different mode",
+              channel);
+    return;
+  }
+  g_autoptr(GError) error = nullptr;
+  if (!send_to_subscribers(channel_id, channel, value, subscribers, &error)) {
+    g_warning("failed to publish on channel %s: %s", channel, error->message);
+  }
+}
+
+// Reads the channel of a call, either the interned "channelId" cached by the
+// Dart side, or the "channel" name, which is interned here. Unknown ids are
+// checked by the registry. Responds with an error and returns 0 if there is
+// neither, or if the id is not positive, since callers return on 0.
+static int64_t lookup_channel_id(FlValue* args, FlMethodCall* method_call) {
+  FlValue* id_value = fl_value_lookup_string(args, "channelId");
+  if (id_value != nullptr &&
+      fl_value_get_type(id_value) == FL_VALUE_TYPE_INT) {
+    int64_t channel_id = fl_value_get_int(id_value);
+    if (channel_id <= 0) {
+      g_autofree gchar* error_msg = g_strdup_printf(
+          "invalid channel id: %" G_GINT64_FORMAT, channel_id);
+      fl_method_call_respond_error(method_call, "INVALID_ARGUMENTS", error_msg,
+                                   nullptr, nullptr);
+      return 0;
+    }
+    return channel_id;
+  }
+
+  FlValue* channel_value = fl_value_lookup_string(args, "channel");
+  if (channel_value == nullptr ||
+      fl_value_get_type(channel_value) != FL_VALUE_TYPE_STRING) {
+    fl_method_call_respond_error(method_call, "INVALID_ARGUMENTS",
+                                 "channel is required", nullptr, nullptr);
+    return 0;
+  }
+  return ChannelRegistry::GetInstance().Intern(
+      fl_value_get_string(channel_value));
+}
+
 static void handle_method_call(FlMethodChannel* channel,
                                FlMethodCall* method_call,
                                gpointer user_data) {
@@ -232,7 +200,7 @@ static void handle_method_call(FlMethodChannel* channel,
   const gchar* method = fl_method_call_get_name(method_call);
   FlValue* args = fl_method_call_get_args(method_call);
 
-  if (strcmp(method, "registerMethodHandler") == 0) {
+  if (strcmp(method, "channelId") == 0) {
     FlValue* channel_value = fl_value_lookup_string(args, "channel");
     if (channel_value == nullptr ||
         fl_value_get_type(channel_value) != FL_VALUE_TYPE_STRING) {
@@ -240,8 +208,15 @@ static void handle_method_call(FlMethodChannel* channel,
                                    "channel is required", nullptr, nullptr);
       return;
     }
-
-    const gchar* channel_name = fl_value_get_string(channel_value);
+    int64_t channel_id = ChannelRegistry::GetInstance().Intern(
+        fl_value_get_string(channel_value));
+    g_autoptr(FlValue) result = fl_value_new_int(channel_id);
+    fl_method_call_respond_success(method_call, result, nullptr);
+  } else if (strcmp(method, "registerMethodHandler") == 0) {
+    int64_t channel_id = lookup_channel_id(args, method_call);
+    if (channel_id == 0) {
+      return;
+    }
 
     // Get mode (default to bidirectional)
     ChannelMode mode = ChannelMode::kBidirectional;
@@ -264,85 +239,150 @@ static void handle_method_call(FlMethodChannel* channel,
     }
 
     auto outcome =
-        ChannelRegistry::GetInstance().Register(channel_name, self, mode);
+        ChannelRegistry::GetInstance().Register(channel_id, self, mode);
 
     switch (outcome) {
       case RegistrationOutcome::kAdded:
-        self->registered_channels->push_back(channel_name);
-        fl_method_call_respond_success(method_call, nullptr, nullptr);
-        break;
-      case RegistrationOutcome::kAlreadyRegistered:
-        fl_method_call_respond_success(method_call, nullptr, nullptr);
+      case RegistrationOutcome::kAlreadyRegistered: {
+        self->registered_channels->insert(channel_id);
+        // the Dart side caches the id for its later calls
+        g_autoptr(FlValue) result = fl_value_new_int(channel_id);
+        fl_method_call_respond_success(method_call, result, nullptr);
         break;
+      }
       case RegistrationOutcome::kLimitReached: {
+        auto channel_name = ChannelRegistry::GetInstance().Name(channel_id);
         g_autofree gchar* error_msg;
         if (mode == ChannelMode::kUnidirectional) {
           error_msg = g_strdup_printf(
               "channel %s already registered in unidirectional mode",
-              channel_name);
+              channel_name.c_str());
         } else {
           error_msg = g_strdup_printf(
               "channel %s already has the maximum number of registrations (2)",
-              channel_name);
+              channel_name.c_str());
         }
         fl_method_call_respond_error(method_call, "CHANNEL_LIMIT_REACHED",
                                      error_msg, nullptr, nullptr);
         break;
       }
       case RegistrationOutcome::kModeConflict: {
+        auto channel_name = ChannelRegistry::GetInstance().Name(channel_id);
         g_autofree gchar* error_msg = g_strdup_printf(
             "channel %s is already registered in a different mode",
-            channel_name);
+            channel_name.c_str());
         fl_method_call_respond_error(method_call, "CHANNEL_MODE_CONFLICT",
                                      error_msg, nullptr, nullptr);
         break;
       }
+      case RegistrationOutcome::kUnknownChannel: {
+        g_autofree gchar* error_msg = g_strdup_printf(
+            "unknown channel id %" G_GINT64_FORMAT, channel_id);
+        fl_method_call_respond_error(method_call, "INVALID_ARGUMENTS",
+                                     error_msg, nullptr, nullptr);
+        break;
+      }
     }
-  } else if (strcmp(method, "unregisterMethodHandler") == 0) {
-    FlValue* channel_value = fl_value_lookup_string(args, "channel");
-    if (channel_value == nullptr ||
-        fl_value_get_type(channel_value) != FL_VALUE_TYPE_STRING) {
-      fl_method_call_respond_error(method_call, "INVALID_ARGUMENTS",
-                                   "channel is required", nullptr, nullptr);
+  } else if (strcmp(method, "subscribe") == 0) {
+    int64_t channel_id = lookup_channel_id(args, method_call);
+    if (channel_id == 0) {
+      return;
+    }
+
+    FlValue* retained = nullptr;
+    auto outcome =
+        ChannelRegistry::GetInstance().Subscribe(channel_id, self, &retained);
+    if (outcome == RegistrationOutcome::kAdded ||
+        outcome == RegistrationOutcome::kAlreadyRegistered) {
+      self->registered_channels->insert(channel_id);
+      // late subscribers get the current state with the subscription
+      g_autoptr(FlValue) result = fl_value_new_map();
+      fl_value_set_string_take(result, "channelId",
+                               fl_value_new_int(channel_id));
+      fl_value_set_string_take(result, "retained",
+                               fl_value_new_bool(retained != nullptr));
+      fl_value_set_string_take(
+          result, "value", retained ? retained : fl_value_new_null());
+      fl_method_call_respond_success(method_call, result, nullptr);
+    } else {
+      auto channel_name = ChannelRegistry::GetInstance().Name(channel_id);
+      g_autofree gchar* error_msg = g_strdup_printf(
+          "channel %s is already registered in a different mode",
+          channel_name.c_str());
+      fl_method_call_respond_error(method_call, "CHANNEL_MODE_CONFLICT",
+                                   error_msg, nullptr, nullptr);
+    }
+  } else if (strcmp(method, "publish") == 0) {
+    int64_t channel_id = lookup_channel_id(args, method_call);
+    if (channel_id == 0) {
       return;
     }
+    FlValue* value = fl_value_lookup_string(args, "value");
+    FlValue* retain_value = fl_value_lookup_string(args, "retain");
+    bool retain = retain_value != nullptr &&
+                  fl_value_get_type(retain_value) == FL_VALUE_TYPE_BOOL &&
+                  fl_value_get_bool(retain_value);
+    g_autoptr(FlValue) null_value = fl_value_new_null();
+    if (value == nullptr) {
+      value = null_value;
+    }
 
-    const gchar* channel_name = fl_value_get_string(channel_value);
-    ChannelRegistry::GetInstance().Unregister(channel_name, self);
+    std::vector<WindowChannelPlugin*> subscribers;
+    auto outcome = ChannelRegistry::GetInstance().Publish(
+        channel_id, value, retain, &subscribers);
+    auto channel_name = ChannelRegistry::GetInstance().Name(channel_id);
+    if (outcome != RegistrationOutcome::kAdded) {
+      g_autofree gchar* error_msg = g_strdup_printf(
+          "channel %s is already registered in a different mode",
+          channel_name.c_str());
+      fl_method_call_respond_error(method_call, "CHANNEL_MODE_CONFLICT",
+                                   error_msg, nullptr, nullptr);
+      return;
+    }
 
-    auto it = std::find(self->registered_channels->begin(),
-                        self->registered_channels->end(),
-                        std::string(channel_name));
-    if (it != self->registered_channels->end()) {
-      self->registered_channels->erase(it);
+    g_autoptr(GError) error = nullptr;
+    if (!send_to_subscribers(channel_id, channel_name, value, subscribers,
+                             &error)) {
+      fl_method_call_respond_error(method_call, "INVALID_ARGUMENTS",
+                                   error->message, nullptr, nullptr);
+      return;
     }
+    fl_method_call_respond_success(method_call, nullptr, nullptr);
+  } else if (strcmp(method, "unregisterMethodHandler") == 0 ||
+             strcmp(method, "unsubscribe") == 0) {
+    int64_t channel_id = lookup_channel_id(args, method_call);
+    if (channel_id == 0) {
+      return;
+    }
+
+    ChannelRegistry::GetInstance().Unregister(channel_id, self);
+    self->registered_channels->erase(channel_id);
 
     fl_method_call_respond_success(method_call, nullptr, nullptr);
   } else if (strcmp(method, "invokeMethod") == 0) {
-    FlValue* channel_value = fl_value_lookup_string(args, "channel");
-    if (channel_value == nullptr ||
-        fl_value_get_type(channel_value) != FL_VALUE_TYPE_STRING) {
-      fl_method_call_respond_error(method_call, "INVALID_ARGUMENTS",
-                                   "channel is required", nullptr, nullptr);
+    int64_t channel_id = lookup_channel_id(args, method_call);
+    if (channel_id == 0) {
       return;
     }
 
-    const gchar* channel_name = fl_value_get_string(channel_value);
-    auto* target = ChannelRegistry::GetInstance().GetTarget(channel_name, self);
+    WindowChannelPlugin* target = nullptr;
+    auto outcome =
+        ChannelRegistry::GetInstance().GetTarget(channel_id, self, &target);
 
-    if (target) {
-      window_channel_plugin_invoke_method(target, channel_name, args,
+    if (outcome == TargetOutcome::kFound) {
+      window_channel_plugin_invoke_method(target, channel_id, args,
                                          method_call);
     } else {
+      auto channel_name = ChannelRegistry::GetInstance().Name(channel_id);
       g_autofree gchar* error_msg;
-      if (ChannelRegistry::GetInstance().HasRegistrations(channel_name)) {
+      if (outcome == TargetOutcome::kNotAccessible) {
         error_msg = g_strdup_printf(
             "channel %s not accessible from this engine (may be bidirectional "
             "pair or not registered)",
-            channel_name);
+            channel_name.c_str());
       } else {
-        error_msg =
-            g_strdup_printf("unknown registered channel %s", channel_name);
+        error_msg = g_strdup_printf("unknown registered channel %s",
+                                    channel_name.c_str());
       }
       fl_method_call_respond_error(method_call, "CHANNEL_UNREGISTERED",
                                    error_msg, nullptr, nullptr);
@@ -352,19 +392,43 @@ static void handle_method_call(FlMethodChannel* channel,
   }
 }
 
+// The view is destroyed with the window of the engine. Its plugin leaves the
+// registry, so that nothing is sent to the engine anymore, and is freed with
+// the method call handler, which holds the only reference.
+static void window_channel_plugin_view_destroyed(gpointer data,
+                                                  GObject* view) {
+  WindowChannelPlugin* self = (WindowChannelPlugin*)data;
+  self->view = nullptr;
+  window_channel_plugin_unregister_all(self);
+
+  // the channel outlives the handler, which may release the last reference
+  // of the plugin, and the channel with it
+  FlMethodChannel* channel = FL_METHOD_CHANNEL(g_object_ref(self->channel));
+  fl_method_channel_set_method_call_handler(channel, nullptr, nullptr,
+                                            nullptr);
+  g_object_unref(channel);
+}
+
 void window_channel_plugin_register_with_registrar(
     FlPluginRegistrar* registrar) {
   WindowChannelPlugin* plugin = (WindowChannelPlugin*)g_object_new(
       window_channel_plugin_get_type(), nullptr);
 
+  plugin->messenger =
+      FL_BINARY_MESSENGER(g_object_ref(fl_plugin_registrar_get_messenger(registrar)));
+
   g_autoptr(FlStandardMethodCodec) codec = fl_standard_method_codec_new();
-  plugin->channel = fl_method_channel_new(
-      fl_plugin_registrar_get_messenger(registrar),
-      "mixin.one/desktop_multi_window/channels", FL_METHOD_CODEC(codec));
+  plugin->channel = fl_method_channel_new(plugin->messenger, kChannelName,
+                                          FL_METHOD_CODEC(codec));
 
+  // the handler owns the plugin
   fl_method_channel_set_method_call_handler(plugin->channel, handle_method_call,
                                             plugin, g_object_unref);
 
-  // Keep plugin alive - it will be cleaned up when the registrar is destroyed
-  g_object_ref(plugin);
+  // engines without a view, if any, keep their plugin
+  plugin->view = fl_plugin_registrar_get_view(registrar);
+  if (plugin->view) {
+    g_object_weak_ref(G_OBJECT(plugin->view),
+                      window_channel_plugin_view_destroyed, plugin);
+  }
 }
@@ -13,6 +13,18 @@ G_DECLARE_FINAL_TYPE(WindowChannelPlugin,
 
 void window_channel_plugin_register_with_registrar(FlPluginRegistrar* registrar);
 
+// Encodes a method call the way FlStandardMethodCodec does, the name followed
+// by the arguments, so that it can be sent to many engines as it is.
+GBytes* window_channel_plugin_encode_method_call(const gchar* name,
+                                                FlValue* args,
+                                                GError** error);
+
+// Publishes `value` on the publish/subscribe channel `channel`, like
+// WindowBroadcastChannel.publish.
+void window_channel_plugin_publish(const gchar* channel,
+                                   FlValue* value,
+                                   gboolean retain);
+
 G_END_DECLS
 
 #endif  // DESKTOP_MULTI_WINDOW_LINUX_WINDOW_CHANNEL_PLUGIN_H_
@@ -1,108 +1,59 @@
 #include <jni.h>
 #include <stdio.h>
-#include <opus.h>
-#include <opusenc.h>
 #include <stdlib.h>
 #include <string.h>
 #include "utils.h"
+#include "ogg_opus_stream_encoder.h"
 
-OggOpusEnc *enc;
-OggOpusComments *comments;
-int error;
+#define WAVEFORM_BUCKETS 100
 
-static inline void set_bits(uint8_t *bytes, int32_t bitOffset, int32_t value) {
-    bytes += bitOffset / 8;
-    bitOffset %= 8;
-    *((int32_t *) bytes) |= (value << bitOffset);
-}
+// Every recorder owns its encoder, the handle returned by startRecord is
+// passed back to the other functions.
 
-JNIEXPORT jint JNICALL Java_one_mixin_oggOpusPlayer_OpusAudioRecorder_startRecord(JNIEnv *env, jclass clazz, jstring path) {
+JNIEXPORT jlong JNICALL Java_one_mixin_oggOpusPlayer_OpusAudioRecorder_startRecord(JNIEnv *env, jclass clazz, jstring path, jint sampleRate) {
     const char *pathStr = (*env)->GetStringUTFChars(env, path, 0);
     if (!pathStr) {
         LOGE("Error path");
         return 0;
     }
-    comments = ope_comments_create();
-    enc = ope_encoder_create_file(pathStr, comments, 16000, 1, 0, &error);
-    if (error != OPE_OK) {
-        LOGE("Create OggOpusEnc failed");
-        return error;
-    }
-    error = ope_encoder_ctl(enc, OPUS_SET_BITRATE_REQUEST, 16 * 1024);
-    if (error != OPE_OK) {
-        return error;
+    int32_t error = 0;
+    void *encoder = ogg_opus_stream_encoder_create(pathStr, sampleRate, 1, 16 * 1024, &error);
+    (*env)->ReleaseStringUTFChars(env, path, pathStr);
+    if (!encoder) {
+        LOGE("Create encoder failed %d", error);
+        return 0;
     }
-
-    return OPE_OK;
+    return (jlong) (intptr_t) encoder;
 }
 
-JNIEXPORT jint JNICALL Java_one_mixin_oggOpusPlayer_OpusAudioRecorder_writeFrame(JNIEnv *env, jclass clazz, jshortArray frame, jint len) {
-    jshort *sampleBuffer = (*env) -> GetShortArrayElements(env, frame, 0);
-    int result = ope_encoder_write(enc, sampleBuffer, len);
-    (*env)->ReleaseShortArrayElements(env, frame, sampleBuffer, 0);
-    return result;
+// `buffer` is a direct ByteBuffer of native order pcm, read without any copy.
+JNIEXPORT jint JNICALL Java_one_mixin_oggOpusPlayer_OpusAudioRecorder_writeFrame(JNIEnv *env, jclass clazz, jlong handle, jobject buffer, jint len) {
+    const int16_t *samples = (*env)->GetDirectBufferAddress(env, buffer);
+    if (!samples || len < 0 || (*env)->GetDirectBufferCapacity(env, buffer) < (jlong) len * 2) {
+        return OGG_OPUS_STREAM_ENCODER_ERROR_ARGUMENT;
+    }
+    return ogg_opus_stream_encoder_write((void *) (intptr_t) handle, samples, len);
 }
 
-JNIEXPORT void JNICALL Java_one_mixin_oggOpusPlayer_OpusAudioRecorder_stopRecord(JNIEnv *env, jclass clazz) {
-    ope_encoder_drain(enc);
-    ope_encoder_destroy(enc);
-    ope_comments_destroy(comments);
-    LOGI("ope encoder destroy");
+JNIEXPORT jint JNICALL Java_one_mixin_oggOpusPlayer_OpusAudioRecorder_stopRecord(JNIEnv *env, jclass clazz, jlong handle) {
+    int32_t result = ogg_opus_stream_encoder_finish((void *) (intptr_t) handle);
+    LOGI("ope encoder finished %d", result);
+    return result;
 }
 
-JNIEXPORT jbyteArray JNICALL Java_one_mixin_oggOpusPlayer_OpusAudioRecorder_getWaveform2(JNIEnv *env, jclass clazz, jshortArray array, jint length) {
-    jshort *sampleBuffer = (*env)->GetShortArrayElements(env, array, 0);
-    const int32_t resultSamples = 100;
-    uint16_t *samples = malloc(100 * 2);
-    uint64_t sampleIndex = 0;
-    uint16_t peakSample = 0;
-    int32_t sampleRate = (int32_t) max(1, length / resultSamples);
-    int32_t index = 0;
-
-    for (int32_t i = 0; i < length; i++) {
-        uint16_t sample = (uint16_t) abs(sampleBuffer[i]);
-        if (sample > peakSample) {
-            peakSample = sample;
-        }
-        if (sampleIndex++ % sampleRate == 0) {
-            if (index < resultSamples) {
-                samples[index++] = peakSample;
-            }
-            peakSample = 0;
-        }
-    }
-
-    int64_t sumSamples = 0;
-    for (int32_t i = 0; i < resultSamples; i++) {
-        sumSamples += samples[i];
+JNIEXPORT jbyteArray JNICALL Java_one_mixin_oggOpusPlayer_OpusAudioRecorder_getWaveform(JNIEnv *env, jclass clazz, jlong handle) {
+    uint8_t bytes[WAVEFORM_BUCKETS];
+    int32_t length = ogg_opus_stream_encoder_waveform((void *) (intptr_t) handle, WAVEFORM_BUCKETS, bytes);
+    if (length < 0) {
+        return NULL;
     }
-    uint16_t peak = (uint16_t) (sumSamples * 1.8f / resultSamples);
-    if (peak < 2500) {
-        peak = 2500;
-    }
-
-    for (int32_t i = 0; i < resultSamples; i++) {
-        uint16_t sample = (uint16_t) ((int64_t) samples[i]);
-        if (sample > peak) {
-            samples[i] = peak;
-        }
-    }
-
-    (*env)->ReleaseShortArrayElements(env, array, sampleBuffer, 0);
-
-    uint32_t bitStreamLength = resultSamples * 5 / 8 + 1;
-    jbyteArray result = (*env)->NewByteArray(env, bitStreamLength);
+    jbyteArray result = (*env)->NewByteArray(env, length);
     if (result) {
-        uint8_t *bytes = malloc(bitStreamLength + 4);
-        memset(bytes, 0, bitStreamLength + 4);
-        for (int32_t i = 0; i < resultSamples; i++) {
-            int32_t value = min(31, abs((int32_t) samples[i]) * 31 / peak);
-            set_bits(bytes, i * 5, value & 31);
-        }
-        (*env)->SetByteArrayRegion(env, result, 0, bitStreamLength, (jbyte *) bytes);
+        (*env)->SetByteArrayRegion(env, result, 0, length, (jbyte *) bytes);
     }
-
-    free(samples);
-
     return result;
-}
\ No newline at end of file
+}
+
+JNIEXPORT void JNICALL Java_one_mixin_oggOpusPlayer_OpusAudioRecorder_destroyRecord(JNIEnv *env, jclass clazz, jlong handle) {
+    ogg_opus_stream_encoder_destroy((void *) (intptr_t) handle);
+}
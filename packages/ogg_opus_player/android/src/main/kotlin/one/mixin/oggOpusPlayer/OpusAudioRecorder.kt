@@ -9,7 +9,10 @@ import android.os.Handler
 import android.os.Looper
 import android.telephony.PhoneStateListener
 import android.telephony.TelephonyManager
+import android.util.Log
 import java.io.File
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
 
 class OpusAudioRecorder constructor(
     ctx: Context,
@@ -17,6 +20,8 @@ class OpusAudioRecorder constructor(
     private val callback: Callback? = null
 ) {
     companion object {
+        private const val TAG = "OpusAudioRecorder"
+
         private const val SAMPLE_RATE = 16000
         private const val BUFFER_SIZE_FACTOR = 2
 
@@ -46,8 +51,14 @@ class OpusAudioRecorder constructor(
         AudioFormat.ENCODING_PCM_16BIT
     )
 
-    private val recordSamples = ShortArray(1024)
-    private var samplesCount = 0L
+    // pcm is read into this direct buffer, which the native encoder copies
+    // without going through a java array.
+    private val recordBuffer: ByteBuffer by lazy {
+        ByteBuffer.allocateDirect(recordBufferSize * 2).order(ByteOrder.nativeOrder())
+    }
+
+    // the native encoder of the current recording, 0 if there is none.
+    private var nativeHandle = 0L
     private var recordTimeCount = 0L
     private var sendAfterDone = false
     private var callStop = false
@@ -84,54 +95,23 @@ class OpusAudioRecorder constructor(
     private val recordRunnable: Runnable by lazy {
         Runnable recordRunnable@{
             audioRecord?.let { audioRecord ->
-                val shortArray = ShortArray(recordBufferSize)
-                val len = audioRecord.read(shortArray, 0, shortArray.size)
+                recordBuffer.clear()
+                val len = audioRecord.read(recordBuffer, recordBuffer.capacity()) / 2
                 if (len > 0 && !callStop) {
-                    var sum = 0
-                    try {
-                        val newSamplesCount = samplesCount + len / 2
-                        val currPart =
-                            (samplesCount / newSamplesCount.toDouble() * recordSamples.size).toInt()
-                        val newPart = recordSamples.size - currPart
-                        var sampleStep: Float
-                        if (currPart != 0) {
-                            sampleStep = recordSamples.size / currPart.toFloat()
-                            var currNum = 0f
-                            for (i in 0 until currPart) {
-                                recordSamples[i] = recordSamples[currNum.toInt()]
-                                currNum += sampleStep
-                            }
-                        }
-                        var currNum = currPart
-                        var nextNum = 0f
-                        sampleStep = len / 2f / newPart
-                        for (i in 0 until len) {
-                            val peak = shortArray[i]
-                            if (peak > 2500) {
-                                sum += peak * peak
-                            }
-                            if (i == nextNum.toInt() && currNum < recordSamples.size) {
-                                recordSamples[currNum] = peak
-                                nextNum += sampleStep
-                                currNum++
-                            }
-                        }
-                        samplesCount = newSamplesCount
-                    } catch (e: Exception) {
+                    // encoded on the native worker thread, the buffer can be
+                    // reused right away.
+                    val written = writeFrame(nativeHandle, recordBuffer, len)
+                    if (written < 0) {
+                        Log.e(TAG, "writeFrame failed: $written")
+                    } else if (written < len) {
+                        // the encoder fell more than 4 seconds behind.
+                        Log.w(TAG, "encoder overrun, dropped ${len - written} frames")
                     }
+                    recordTimeCount += len / (SAMPLE_RATE / 1000)
 
-                    fileEncodingQueue.postRunnable(
-                        Runnable encodingRunnable@{
-                            if (callStop) return@encodingRunnable
-
-                            writeFrame(shortArray, len)
-                            recordTimeCount += len / 16
-
-                            if (recordTimeCount >= MAX_RECORD_DURATION) {
-                                stopRecording(AudioEndStatus.SEND)
-                            }
-                        }
-                    )
+                    if (recordTimeCount >= MAX_RECORD_DURATION) {
+                        stopRecording(AudioEndStatus.SEND)
+                    }
                     recordQueue.postRunnable(recordRunnable)
                 } else {
                     stopRecordingInternal(
@@ -157,7 +137,8 @@ class OpusAudioRecorder constructor(
         }
         recordingAudioFile.createNewFile()
         try {
-            if (startRecord(recordingAudioFile.absolutePath) != 0) {
+            nativeHandle = startRecord(recordingAudioFile.absolutePath, SAMPLE_RATE)
+            if (nativeHandle == 0L) {
                 return@Runnable
             }
 
@@ -170,23 +151,24 @@ class OpusAudioRecorder constructor(
             )
 
             if (audioRecord == null || audioRecord!!.state != AudioRecord.STATE_INITIALIZED) {
+                destroyNativeRecorder()
                 return@Runnable
             }
             callStop = false
-            samplesCount = 0
             recordTimeCount = 0
             audioRecord?.startRecording()
 
             if (audioRecord != null && audioRecord!!.recordingState != AudioRecord.RECORDSTATE_RECORDING) {
                 audioRecord?.release()
                 audioRecord = null
+                destroyNativeRecorder()
                 return@Runnable
             }
             state = STATE_RECORDING
         } catch (e: Exception) {
             recordingAudioFile.delete()
             try {
-                stopRecord()
+                destroyNativeRecorder()
                 state = STATE_IDLE
                 audioRecord?.release()
                 audioRecord = null
@@ -227,28 +209,34 @@ class OpusAudioRecorder constructor(
 
     private fun stopRecordingInternal(endStatus: AudioEndStatus) {
         callStop = true
-        // if not send no need to stopping record after all encoding runnable run completed.
-        if (endStatus != AudioEndStatus.CANCEL) {
+        val handle = nativeHandle
+        nativeHandle = 0L
+        // every frame has been handed to the encoder on this thread, it only
+        // has to drain them.
+        if (handle != 0L) {
+            val duration = recordTimeCount
             fileEncodingQueue.postRunnable(
                 {
-                    stopRecord()
-                    val duration = recordTimeCount
-                    val waveForm = getWaveform2(recordSamples, recordSamples.size)
-                    Handler(Looper.getMainLooper()).post {
-                        if (endStatus == AudioEndStatus.SEND) {
-                            callback?.sendAudio(
-                                recordingAudioFile,
-                                duration,
-                                waveForm
-                            )
-                        } else if (endStatus == AudioEndStatus.PREVIEW) {
-                            callback?.sendAudio(
-                                recordingAudioFile,
-                                duration,
-                                waveForm
-                            )
+                    stopRecord(handle)
+                    if (endStatus != AudioEndStatus.CANCEL) {
+                        val waveForm = getWaveform(handle)
+                        Handler(Looper.getMainLooper()).post {
+                            if (endStatus == AudioEndStatus.SEND) {
+                                callback?.sendAudio(
+                                    recordingAudioFile,
+                                    duration,
+                                    waveForm
+                                )
+                            } else if (endStatus == AudioEndStatus.PREVIEW) {
+                                callback?.sendAudio(
+                                    recordingAudioFile,
+                                    duration,
+                                    waveForm
+                                )
+                            }
                         }
                     }
+                    destroyRecord(handle)
                 }
             )
         }
@@ -260,10 +248,18 @@ class OpusAudioRecorder constructor(
         }
     }
 
-    private external fun startRecord(path: String): Int
-    private external fun writeFrame(frame: ShortArray, len: Int): Int
-    private external fun stopRecord()
-    private external fun getWaveform2(arr: ShortArray, len: Int): ByteArray
+    private fun destroyNativeRecorder() {
+        if (nativeHandle != 0L) {
+            destroyRecord(nativeHandle)
+            nativeHandle = 0L
+        }
+    }
+
+    private external fun startRecord(path: String, sampleRate: Int): Long
+    private external fun writeFrame(handle: Long, buffer: ByteBuffer, len: Int): Int
+    private external fun stopRecord(handle: Long): Int
+    private external fun getWaveform(handle: Long): ByteArray
+    private external fun destroyRecord(handle: Long)
 
     interface Callback {
         fun onCancel()
@@ -1,2 +1,3 @@
+export 'src/metadata.dart';
 export 'src/player.dart';
 export 'src/player_state.dart';
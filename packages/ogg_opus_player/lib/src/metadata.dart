@@ -0,0 +1,31 @@
+class OggOpusMetadata {
+  OggOpusMetadata({
+    required this.duration,
+    required this.channels,
+    required this.inputSampleRate,
+    required this.outputGain,
+    required this.bitrate,
+    required this.tags,
+  });
+
+  final Duration duration;
+
+  final int channels;
+
+  /// The sample rate of the audio before it was encoded.
+  final int inputSampleRate;
+
+  /// The gain applied to the decoded output, in dB.
+  final double outputGain;
+
+  /// Average bitrate, in bits per second.
+  final int bitrate;
+
+  /// The vendor string followed by the user comments of the file.
+  final List<String> tags;
+
+  @override
+  String toString() => 'OggOpusMetadata(duration: $duration, '
+      'channels: $channels, inputSampleRate: $inputSampleRate, '
+      'outputGain: $outputGain, bitrate: $bitrate, tags: $tags)';
+}
@@ -7,7 +7,8 @@
 // Generated by `package:ffigen`.
 import 'dart:ffi' as ffi;
 
-/// Bindings for `src/ogg_opus_player.h`, `src/ogg_opus_recorder.h`.
+/// Bindings for `src/ogg_opus_player.h`, `src/ogg_opus_recorder.h`,
+/// `src/ogg_opus_waveform.h`, `src/ogg_opus_probe.h`.
 ///
 /// Regenerate bindings with `dart run ffigen --config ffigen.yaml`.
 ///
@@ -26,6 +27,9 @@ class OggOpusBindings {
           lookup)
       : _lookup = lookup;
 
+  /// Create a player of `file_path`. It posts its state changes to `send_port`,
+  /// playing starts in buffering until the first audio reaches the device. A
+  /// player which can not open the file or the device posts the error state.
   ffi.Pointer<ffi.Void> ogg_opus_player_create(
     ffi.Pointer<ffi.Char> file_path,
     int send_port,
@@ -43,6 +47,27 @@ class OggOpusBindings {
   late final _ogg_opus_player_create = _ogg_opus_player_createPtr
       .asFunction<ffi.Pointer<ffi.Void> Function(ffi.Pointer<ffi.Char>, int)>();
 
+  /// ogg_opus_player_create with one of OGG_OPUS_PLAYER_PROFILE_*.
+  ffi.Pointer<ffi.Void> ogg_opus_player_create_with_profile(
+    ffi.Pointer<ffi.Char> file_path,
+    int send_port,
+    int profile,
+  ) {
+    return _ogg_opus_player_create_with_profile(
+      file_path,
+      send_port,
+      profile,
+    );
+  }
+
+  late final _ogg_opus_player_create_with_profilePtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Pointer<ffi.Void> Function(ffi.Pointer<ffi.Char>, ffi.Int64,
+              ffi.Int32)>>('ogg_opus_player_create_with_profile');
+  late final _ogg_opus_player_create_with_profile =
+      _ogg_opus_player_create_with_profilePtr.asFunction<
+          ffi.Pointer<ffi.Void> Function(ffi.Pointer<ffi.Char>, int, int)>();
+
   void ogg_opus_player_pause(
     ffi.Pointer<ffi.Void> player,
   ) {
@@ -118,6 +143,90 @@ class OggOpusBindings {
       _ogg_opus_player_set_playback_ratePtr
           .asFunction<void Function(ffi.Pointer<ffi.Void>, double)>();
 
+  /// Post the playing position to the send_port of ogg_opus_player_create every
+  /// `interval_ms` milliseconds of played audio, from the audio thread, as a list
+  /// of [1, position in seconds]. The position is also posted when paused or
+  /// ended. 0 (the default) disables it.
+  void ogg_opus_player_set_position_interval(
+    ffi.Pointer<ffi.Void> player,
+    int interval_ms,
+  ) {
+    return _ogg_opus_player_set_position_interval(
+      player,
+      interval_ms,
+    );
+  }
+
+  late final _ogg_opus_player_set_position_intervalPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Void Function(ffi.Pointer<ffi.Void>,
+              ffi.Int32)>>('ogg_opus_player_set_position_interval');
+  late final _ogg_opus_player_set_position_interval =
+      _ogg_opus_player_set_position_intervalPtr
+          .asFunction<void Function(ffi.Pointer<ffi.Void>, int)>();
+
+  /// Seconds from the time audio is handed to the device until it is heard, as
+  /// measured while playing, or one device period before that. Positions are
+  /// reported as heard, behind the decoded audio by this latency.
+  double ogg_opus_player_get_output_latency(
+    ffi.Pointer<ffi.Void> player,
+  ) {
+    return _ogg_opus_player_get_output_latency(
+      player,
+    );
+  }
+
+  late final _ogg_opus_player_get_output_latencyPtr =
+      _lookup<ffi.NativeFunction<ffi.Double Function(ffi.Pointer<ffi.Void>)>>(
+          'ogg_opus_player_get_output_latency');
+  late final _ogg_opus_player_get_output_latency =
+      _ogg_opus_player_get_output_latencyPtr
+          .asFunction<double Function(ffi.Pointer<ffi.Void>)>();
+
+  /// Analyze the played audio on a thread of its own, and post it to the
+  /// send_port of ogg_opus_player_create every `interval_ms` milliseconds while
+  /// it is heard, as a list of [2, Float32List of the rms level, the peak level
+  /// and `bands` spectrum levels], all from 0.0 to 1.0. Up to 64 logarithmic
+  /// bands from 100Hz to 16kHz, 0 for levels only. Zero levels are posted once
+  /// after playback pauses or ends. An `interval_ms` of 0 (the default) disables
+  /// it, the audio thread then does no work for it.
+  void ogg_opus_player_set_analysis(
+    ffi.Pointer<ffi.Void> player,
+    int interval_ms,
+    int bands,
+  ) {
+    return _ogg_opus_player_set_analysis(
+      player,
+      interval_ms,
+      bands,
+    );
+  }
+
+  late final _ogg_opus_player_set_analysisPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Void Function(ffi.Pointer<ffi.Void>, ffi.Int32,
+              ffi.Int32)>>('ogg_opus_player_set_analysis');
+  late final _ogg_opus_player_set_analysis = _ogg_opus_player_set_analysisPtr
+      .asFunction<void Function(ffi.Pointer<ffi.Void>, int, int)>();
+
+  /// Limit the memory of decoded pcm kept for replaying files shorter than 60
+  /// seconds without decoding them again, 32MB by default. Least recently played
+  /// files are dropped first, 0 disables the cache.
+  void ogg_opus_player_set_pcm_cache_budget(
+    int bytes,
+  ) {
+    return _ogg_opus_player_set_pcm_cache_budget(
+      bytes,
+    );
+  }
+
+  late final _ogg_opus_player_set_pcm_cache_budgetPtr =
+      _lookup<ffi.NativeFunction<ffi.Void Function(ffi.Int64)>>(
+          'ogg_opus_player_set_pcm_cache_budget');
+  late final _ogg_opus_player_set_pcm_cache_budget =
+      _ogg_opus_player_set_pcm_cache_budgetPtr
+          .asFunction<void Function(int)>();
+
   void ogg_opus_player_initialize_dart(
     ffi.Pointer<ffi.Void> native_port,
   ) {
@@ -215,6 +324,7 @@ class OggOpusBindings {
           void Function(ffi.Pointer<ffi.Void>,
               ffi.Pointer<ffi.Pointer<ffi.Uint8>>, ffi.Pointer<ffi.Int64>)>();
 
+  /// The recorded duration in seconds, including silence which is not encoded.
   double ogg_opus_recorder_get_duration(
     ffi.Pointer<ffi.Void> recoder,
   ) {
@@ -229,4 +339,454 @@ class OggOpusBindings {
   late final _ogg_opus_recorder_get_duration =
       _ogg_opus_recorder_get_durationPtr
           .asFunction<double Function(ffi.Pointer<ffi.Void>)>();
+
+  /// The duration of the encoded audio in seconds, which is the duration of the
+  /// file.
+  double ogg_opus_recorder_get_encoded_duration(
+    ffi.Pointer<ffi.Void> recoder,
+  ) {
+    return _ogg_opus_recorder_get_encoded_duration(
+      recoder,
+    );
+  }
+
+  late final _ogg_opus_recorder_get_encoded_durationPtr =
+      _lookup<ffi.NativeFunction<ffi.Double Function(ffi.Pointer<ffi.Void>)>>(
+          'ogg_opus_recorder_get_encoded_duration');
+  late final _ogg_opus_recorder_get_encoded_duration =
+      _ogg_opus_recorder_get_encoded_durationPtr
+          .asFunction<double Function(ffi.Pointer<ffi.Void>)>();
+
+  /// Post recording progress to the send_port of ogg_opus_recorder_create every
+  /// `interval_ms` milliseconds of recorded audio. 0 (the default) disables it.
+  ///
+  /// Each progress is a list of [0, recorded duration in seconds, rms level, peak
+  /// level, Int16List of the waveform samples encoded since the previous
+  /// progress, encoded duration in seconds], levels are in the range of 0.0 to
+  /// 1.0. Progress is posted while silence is held back too.
+  void ogg_opus_recorder_set_progress_interval(
+    ffi.Pointer<ffi.Void> recoder,
+    int interval_ms,
+  ) {
+    return _ogg_opus_recorder_set_progress_interval(
+      recoder,
+      interval_ms,
+    );
+  }
+
+  late final _ogg_opus_recorder_set_progress_intervalPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Void Function(ffi.Pointer<ffi.Void>,
+              ffi.Int32)>>('ogg_opus_recorder_set_progress_interval');
+  late final _ogg_opus_recorder_set_progress_interval =
+      _ogg_opus_recorder_set_progress_intervalPtr
+          .asFunction<void Function(ffi.Pointer<ffi.Void>, int)>();
+
+  /// Stats of the buffer between the capture callback and the encoder thread.
+  /// high_water_mark: the max number of samples waiting to be encoded.
+  /// overrun_count: the number of capture callbacks which dropped samples because
+  /// the buffer was full.
+  void ogg_opus_recorder_get_buffer_stats(
+    ffi.Pointer<ffi.Void> recoder,
+    ffi.Pointer<ffi.Int64> high_water_mark,
+    ffi.Pointer<ffi.Int64> overrun_count,
+  ) {
+    return _ogg_opus_recorder_get_buffer_stats(
+      recoder,
+      high_water_mark,
+      overrun_count,
+    );
+  }
+
+  late final _ogg_opus_recorder_get_buffer_statsPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Void Function(ffi.Pointer<ffi.Void>, ffi.Pointer<ffi.Int64>,
+              ffi.Pointer<ffi.Int64>)>>('ogg_opus_recorder_get_buffer_stats');
+  late final _ogg_opus_recorder_get_buffer_stats =
+      _ogg_opus_recorder_get_buffer_statsPtr.asFunction<
+          void Function(ffi.Pointer<ffi.Void>, ffi.Pointer<ffi.Int64>,
+              ffi.Pointer<ffi.Int64>)>();
+
+  /// Measure the EBU R128 integrated loudness while recording, and when stopped
+  /// set the OpusHead output gain of the file to bring it to `target_lufs`, e.g.
+  /// -23. Decoders apply the gain, the audio itself is not changed. Must be
+  /// called before ogg_opus_recorder_start.
+  void ogg_opus_recorder_set_loudness_target(
+    ffi.Pointer<ffi.Void> recoder,
+    double target_lufs,
+  ) {
+    return _ogg_opus_recorder_set_loudness_target(
+      recoder,
+      target_lufs,
+    );
+  }
+
+  late final _ogg_opus_recorder_set_loudness_targetPtr = _lookup<
+          ffi.NativeFunction<ffi.Void Function(ffi.Pointer<ffi.Void>, ffi.Double)>>(
+      'ogg_opus_recorder_set_loudness_target');
+  late final _ogg_opus_recorder_set_loudness_target =
+      _ogg_opus_recorder_set_loudness_targetPtr
+          .asFunction<void Function(ffi.Pointer<ffi.Void>, double)>();
+
+  /// The integrated loudness of the recording in LUFS, after it is stopped. -inf
+  /// if it was not measured, or the recording is too short or silent.
+  double ogg_opus_recorder_get_loudness(
+    ffi.Pointer<ffi.Void> recoder,
+  ) {
+    return _ogg_opus_recorder_get_loudness(
+      recoder,
+    );
+  }
+
+  late final _ogg_opus_recorder_get_loudnessPtr =
+      _lookup<ffi.NativeFunction<ffi.Double Function(ffi.Pointer<ffi.Void>)>>(
+          'ogg_opus_recorder_get_loudness');
+  late final _ogg_opus_recorder_get_loudness = _ogg_opus_recorder_get_loudnessPtr
+      .asFunction<double Function(ffi.Pointer<ffi.Void>)>();
+
+  /// Post every ogg page to the send_port of ogg_opus_recorder_create as soon as
+  /// it is complete, as a list of [1, Uint8List page], and [2] after the last
+  /// page. A page is completed at least every `max_page_delay_ms` of audio. The
+  /// pages are also written to the file, if any. Must be called before
+  /// ogg_opus_recorder_start.
+  ///
+  /// The first page is posted before the loudness gain is known. If it is
+  /// measured, see ogg_opus_recorder_set_loudness_target, the first page with the
+  /// gain is posted as [3, Uint8List page] before [2], and consumers must replace
+  /// the first page they received with it to match the file.
+  void ogg_opus_recorder_enable_page_stream(
+    ffi.Pointer<ffi.Void> recoder,
+    int max_page_delay_ms,
+  ) {
+    return _ogg_opus_recorder_enable_page_stream(
+      recoder,
+      max_page_delay_ms,
+    );
+  }
+
+  late final _ogg_opus_recorder_enable_page_streamPtr = _lookup<
+          ffi.NativeFunction<ffi.Void Function(ffi.Pointer<ffi.Void>, ffi.Int32)>>(
+      'ogg_opus_recorder_enable_page_stream');
+  late final _ogg_opus_recorder_enable_page_stream =
+      _ogg_opus_recorder_enable_page_streamPtr
+          .asFunction<void Function(ffi.Pointer<ffi.Void>, int)>();
+
+  /// Detect speech while recording: silence before the first and after the last
+  /// speech is not encoded, and pauses longer than `max_pause_ms` are shortened
+  /// to it, unless it is 0. The silence which is kept is encoded with Opus DTX.
+  /// The duration, waveform and progress only cover the encoded audio. Must be
+  /// called before ogg_opus_recorder_start.
+  void ogg_opus_recorder_enable_voice_activity_detection(
+    ffi.Pointer<ffi.Void> recoder,
+    int max_pause_ms,
+  ) {
+    return _ogg_opus_recorder_enable_voice_activity_detection(
+      recoder,
+      max_pause_ms,
+    );
+  }
+
+  late final _ogg_opus_recorder_enable_voice_activity_detectionPtr = _lookup<
+          ffi.NativeFunction<ffi.Void Function(ffi.Pointer<ffi.Void>, ffi.Int32)>>(
+      'ogg_opus_recorder_enable_voice_activity_detection');
+  late final _ogg_opus_recorder_enable_voice_activity_detection =
+      _ogg_opus_recorder_enable_voice_activity_detectionPtr
+          .asFunction<void Function(ffi.Pointer<ffi.Void>, int)>();
+
+  /// Size in bytes of one packed waveform with `buckets` 5-bit values.
+  int ogg_opus_waveform_packed_size(
+    int buckets,
+  ) {
+    return _ogg_opus_waveform_packed_size(
+      buckets,
+    );
+  }
+
+  late final _ogg_opus_waveform_packed_sizePtr =
+      _lookup<ffi.NativeFunction<ffi.Int32 Function(ffi.Int32)>>(
+          'ogg_opus_waveform_packed_size');
+  late final _ogg_opus_waveform_packed_size =
+      _ogg_opus_waveform_packed_sizePtr.asFunction<int Function(int)>();
+
+  /// Decode `count` ogg opus files in parallel and write their waveforms to `out`.
+  ///
+  /// Each waveform is `buckets` peak values packed as 5 bits each, the same
+  /// format produced by getWaveform2 on Android. Waveform `i` is written at
+  /// `out + i * ogg_opus_waveform_packed_size(buckets)`, so `out` must hold
+  /// `count` of them. The waveform of a file that can not be decoded is all zeros.
+  ///
+  /// Returns the number of files decoded successfully.
+  int ogg_opus_waveform_batch(
+    ffi.Pointer<ffi.Pointer<ffi.Char>> paths,
+    int count,
+    int buckets,
+    ffi.Pointer<ffi.Uint8> out,
+  ) {
+    return _ogg_opus_waveform_batch(
+      paths,
+      count,
+      buckets,
+      out,
+    );
+  }
+
+  late final _ogg_opus_waveform_batchPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int32 Function(ffi.Pointer<ffi.Pointer<ffi.Char>>, ffi.Int32,
+              ffi.Int32, ffi.Pointer<ffi.Uint8>)>>('ogg_opus_waveform_batch');
+  late final _ogg_opus_waveform_batch = _ogg_opus_waveform_batchPtr.asFunction<
+      int Function(
+          ffi.Pointer<ffi.Pointer<ffi.Char>>, int, int, ffi.Pointer<ffi.Uint8>)>();
+
+  /// Read the metadata of the ogg opus file at `path` from its headers, without
+  /// decoding any audio. Returns 0 on success, a negative value on failure.
+  int ogg_opus_probe(
+    ffi.Pointer<ffi.Char> path,
+    ffi.Pointer<OggOpusProbeInfo> info,
+  ) {
+    return _ogg_opus_probe(
+      path,
+      info,
+    );
+  }
+
+  late final _ogg_opus_probePtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int32 Function(ffi.Pointer<ffi.Char>,
+              ffi.Pointer<OggOpusProbeInfo>)>>('ogg_opus_probe');
+  late final _ogg_opus_probe = _ogg_opus_probePtr.asFunction<
+      int Function(ffi.Pointer<ffi.Char>, ffi.Pointer<OggOpusProbeInfo>)>();
+
+  /// Probe `count` files in parallel. `results[i]` receives the return value of
+  /// ogg_opus_probe for `paths[i]` and `infos[i]` its metadata.
+  ///
+  /// If `cache_path` is not null, metadata is cached in memory and in that file,
+  /// keyed by path, modification time and size. Files which hit the cache are only
+  /// stat-ed. Returns the number of files probed successfully.
+  int ogg_opus_probe_batch(
+    ffi.Pointer<ffi.Pointer<ffi.Char>> paths,
+    int count,
+    ffi.Pointer<ffi.Char> cache_path,
+    ffi.Pointer<OggOpusProbeInfo> infos,
+    ffi.Pointer<ffi.Int32> results,
+  ) {
+    return _ogg_opus_probe_batch(
+      paths,
+      count,
+      cache_path,
+      infos,
+      results,
+    );
+  }
+
+  late final _ogg_opus_probe_batchPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int32 Function(
+              ffi.Pointer<ffi.Pointer<ffi.Char>>,
+              ffi.Int32,
+              ffi.Pointer<ffi.Char>,
+              ffi.Pointer<OggOpusProbeInfo>,
+              ffi.Pointer<ffi.Int32>)>>('ogg_opus_probe_batch');
+  late final _ogg_opus_probe_batch = _ogg_opus_probe_batchPtr.asFunction<
+      int Function(ffi.Pointer<ffi.Pointer<ffi.Char>>, int, ffi.Pointer<ffi.Char>,
+          ffi.Pointer<OggOpusProbeInfo>, ffi.Pointer<ffi.Int32>)>();
+
+  /// Decode the ogg opus file at `in_path`, change its speed and pitch and write
+  /// the result to `out_path` in `format`, as fast as possible and without any
+  /// audio device. `speed` and `pitch` are factors, 1.0 keeps the original.
+  ///
+  /// Blocks until the file is written. Returns 0 on success, or one of the
+  /// OGG_OPUS_RENDER_ERROR_* values.
+  int ogg_opus_render(
+    ffi.Pointer<ffi.Char> in_path,
+    ffi.Pointer<ffi.Char> out_path,
+    double speed,
+    double pitch,
+    int format,
+  ) {
+    return _ogg_opus_render(
+      in_path,
+      out_path,
+      speed,
+      pitch,
+      format,
+    );
+  }
+
+  late final _ogg_opus_renderPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int32 Function(ffi.Pointer<ffi.Char>, ffi.Pointer<ffi.Char>,
+              ffi.Double, ffi.Double, ffi.Int32)>>('ogg_opus_render');
+  late final _ogg_opus_render = _ogg_opus_renderPtr.asFunction<
+      int Function(
+          ffi.Pointer<ffi.Char>, ffi.Pointer<ffi.Char>, double, double, int)>();
+
+  /// Copy the audio of `in_path` between `start` and `end` to `out_path`, both in
+  /// 48kHz samples from the beginning of the audio. `end` < 0 keeps everything
+  /// after `start`.
+  ///
+  /// The opus packets are copied as they are, nothing is decoded or re-encoded.
+  /// The cut is still sample accurate: whole packets are kept around the range,
+  /// plus 80ms before `start` for the decoder to converge, and the extra audio is
+  /// hidden by the pre-skip and the granule position of the last page.
+  ///
+  /// Returns 0 on success, or one of the OGG_OPUS_EDIT_ERROR_* values.
+  int ogg_opus_trim(
+    ffi.Pointer<ffi.Char> in_path,
+    ffi.Pointer<ffi.Char> out_path,
+    int start,
+    int end,
+  ) {
+    return _ogg_opus_trim(
+      in_path,
+      out_path,
+      start,
+      end,
+    );
+  }
+
+  late final _ogg_opus_trimPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int32 Function(ffi.Pointer<ffi.Char>, ffi.Pointer<ffi.Char>,
+              ffi.Int64, ffi.Int64)>>('ogg_opus_trim');
+  late final _ogg_opus_trim = _ogg_opus_trimPtr.asFunction<
+      int Function(ffi.Pointer<ffi.Char>, ffi.Pointer<ffi.Char>, int, int)>();
+
+  /// Join the `count` files at `in_paths` into one ogg opus stream at `out_path`,
+  /// without decoding. The files must have the same channel count, channel
+  /// mapping and output gain. The headers and tags of the first file are kept.
+  ///
+  /// The pre-skip of every file but the first and the end trimming of every file
+  /// but the last can not be expressed in the middle of a stream, so a few
+  /// milliseconds of encoder padding stay audible at each joint.
+  ///
+  /// Returns 0 on success, or one of the OGG_OPUS_EDIT_ERROR_* values.
+  int ogg_opus_concat(
+    ffi.Pointer<ffi.Pointer<ffi.Char>> in_paths,
+    int count,
+    ffi.Pointer<ffi.Char> out_path,
+  ) {
+    return _ogg_opus_concat(
+      in_paths,
+      count,
+      out_path,
+    );
+  }
+
+  late final _ogg_opus_concatPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int32 Function(ffi.Pointer<ffi.Pointer<ffi.Char>>, ffi.Int32,
+              ffi.Pointer<ffi.Char>)>>('ogg_opus_concat');
+  late final _ogg_opus_concat = _ogg_opus_concatPtr.asFunction<
+      int Function(
+          ffi.Pointer<ffi.Pointer<ffi.Char>>, int, ffi.Pointer<ffi.Char>)>();
+
+  /// Measure the EBU R128 integrated loudness of `count` ogg opus files in
+  /// parallel, and set the OpusHead output gain of each to bring it to
+  /// `target_lufs`, e.g. -23. Only the first page of a file is rewritten, the
+  /// audio is left untouched and decoders apply the gain.
+  ///
+  /// The loudness is measured without the gain already in the header.
+  /// `loudness[i]` receives the loudness of `paths[i]` in LUFS, -inf if it is too
+  /// short or silent, in which case the gain is not changed. `results[i]` is 0 on
+  /// success, negative on failure. Returns the number of files processed
+  /// successfully.
+  int ogg_opus_normalize_loudness(
+    ffi.Pointer<ffi.Pointer<ffi.Char>> paths,
+    int count,
+    double target_lufs,
+    ffi.Pointer<ffi.Double> loudness,
+    ffi.Pointer<ffi.Int32> results,
+  ) {
+    return _ogg_opus_normalize_loudness(
+      paths,
+      count,
+      target_lufs,
+      loudness,
+      results,
+    );
+  }
+
+  late final _ogg_opus_normalize_loudnessPtr = _lookup<
+      ffi.NativeFunction<
+          ffi.Int32 Function(
+              ffi.Pointer<ffi.Pointer<ffi.Char>>,
+              ffi.Int32,
+              ffi.Double,
+              ffi.Pointer<ffi.Double>,
+              ffi.Pointer<ffi.Int32>)>>('ogg_opus_normalize_loudness');
+  late final _ogg_opus_normalize_loudness =
+      _ogg_opus_normalize_loudnessPtr.asFunction<
+          int Function(ffi.Pointer<ffi.Pointer<ffi.Char>>, int, double,
+              ffi.Pointer<ffi.Double>, ffi.Pointer<ffi.Int32>)>();
 }
+
+class OggOpusProbeInfo extends ffi.Struct {
+  /// duration in 48kHz samples.
+  @ffi.Int64()
+  external int duration;
+
+  @ffi.Int32()
+  external int channels;
+
+  /// the sample rate of the audio before it was encoded.
+  @ffi.Int32()
+  external int input_sample_rate;
+
+  /// the gain to apply to the decoded output, in Q7.8 dB.
+  @ffi.Int32()
+  external int output_gain;
+
+  /// average bitrate, in bits per second.
+  @ffi.Int32()
+  external int bitrate;
+
+  /// the vendor string and user comments of the OpusTags, one per line.
+  /// truncated if it does not fit.
+  @ffi.Array.multi([512])
+  external ffi.Array<ffi.Char> tags;
+}
+
+const int OGG_OPUS_PLAYER_STATE_BUFFERING = 0;
+
+const int OGG_OPUS_PLAYER_STATE_PLAYING = 1;
+
+const int OGG_OPUS_PLAYER_STATE_PAUSED = 2;
+
+const int OGG_OPUS_PLAYER_STATE_ENDED = 3;
+
+const int OGG_OPUS_PLAYER_STATE_ERROR = 4;
+
+const int OGG_OPUS_PLAYER_PROFILE_DEFAULT = 0;
+
+const int OGG_OPUS_PLAYER_PROFILE_LOW_LATENCY = 1;
+
+const int OGG_OPUS_PLAYER_PROFILE_POWER_SAVING = 2;
+
+const int OGG_OPUS_PROBE_TAGS_SIZE = 512;
+
+const int OGG_OPUS_RENDER_FORMAT_WAV = 0;
+
+const int OGG_OPUS_RENDER_FORMAT_OPUS = 1;
+
+const int OGG_OPUS_RENDER_PIPELINED = 256;
+
+const int OGG_OPUS_RENDER_ERROR_ARGUMENT = -1;
+
+const int OGG_OPUS_RENDER_ERROR_OPEN_INPUT = -2;
+
+const int OGG_OPUS_RENDER_ERROR_OPEN_OUTPUT = -3;
+
+const int OGG_OPUS_RENDER_ERROR_WRITE = -4;
+
+const int OGG_OPUS_EDIT_ERROR_ARGUMENT = -1;
+
+const int OGG_OPUS_EDIT_ERROR_OPEN_INPUT = -2;
+
+const int OGG_OPUS_EDIT_ERROR_OPEN_OUTPUT = -3;
+
+const int OGG_OPUS_EDIT_ERROR_WRITE = -4;
+
+const int OGG_OPUS_EDIT_ERROR_FORMAT = -5;
+
+const int OGG_OPUS_EDIT_ERROR_MISMATCH = -6;
@@ -2,18 +2,36 @@ import 'dart:io';
 
 import 'package:flutter/foundation.dart';
 
+import 'metadata.dart';
 import 'player_ffi_impl.dart';
 import 'player_plugin_impl.dart';
 import 'player_state.dart';
 
+/// How a player trades output latency for cpu wakeups.
+///
+/// Only used on Linux/Windows.
+enum PlayerOutputProfile {
+  /// 21ms device periods.
+  normal,
+
+  /// 5ms device periods, decoded before play starts. For short ui sounds.
+  lowLatency,
+
+  /// 170ms device periods filled from big decode bursts, for long messages.
+  powerSaving,
+}
+
 abstract class OggOpusPlayer {
   OggOpusPlayer.create();
 
-  factory OggOpusPlayer(String path) {
+  factory OggOpusPlayer(
+    String path, {
+    PlayerOutputProfile profile = PlayerOutputProfile.normal,
+  }) {
     if (Platform.isIOS || Platform.isMacOS || Platform.isAndroid) {
       return OggOpusPlayerPluginImpl(path);
     } else if (Platform.isLinux || Platform.isWindows) {
-      return OggOpusPlayerFfiImpl(path);
+      return OggOpusPlayerFfiImpl(path, profile: profile);
     }
     throw UnsupportedError('Platform not supported');
   }
@@ -32,6 +50,34 @@ abstract class OggOpusPlayer {
   /// Set playback rate, in the range 0.5 through 2.0.
   /// 1.0 is normal speed (default).
   void setPlaybackRate(double speed);
+
+  /// The playing position in seconds, pushed by the audio thread every
+  /// [setPositionInterval] while playing, and once more when paused or ended.
+  /// Cheaper than polling [currentPosition] for many players.
+  ///
+  /// Only supported on Linux/Windows, it never emits on other platforms.
+  Stream<double> get position => const Stream.empty();
+
+  /// How often [position] emits while playing, 50ms by default.
+  void setPositionInterval(Duration interval) {}
+
+  /// Time from decoding audio until it is heard. [currentPosition] and
+  /// [position] already report the heard position.
+  ///
+  /// Only supported on Linux/Windows, it is zero on other platforms.
+  Duration get outputLatency => Duration.zero;
+
+  /// Levels and a coarse spectrum of the audio as it is heard, emitted about
+  /// 30 times a second while playing, and once with zero levels after it
+  /// pauses or ends. The audio is only analyzed while this is listened to, on
+  /// a native thread of its own.
+  ///
+  /// Only supported on Linux/Windows, it never emits on other platforms.
+  Stream<PlayerAnalysis> get analysis => const Stream.empty();
+
+  /// The number of [PlayerAnalysis.spectrum] bands, from 0 to measure only the
+  /// levels, up to 64. 16 by default.
+  void setAnalysisBands(int bands) {}
 }
 
 abstract class OggOpusRecorder {
@@ -52,11 +98,236 @@ abstract class OggOpusRecorder {
 
   void dispose();
 
-  /// get the recorded audio waveform data.
+  /// get the recorded audio waveform data, 100 peaks packed into 5 bits each.
   /// must be called after [stop] is called.
   Future<List<int>> getWaveformData();
 
   /// get the recorded audio duration.
   /// must be called after [stop] is called.
   Future<double> duration();
+
+  /// Progress of the recording, emitted at a fixed rate while recording.
+  ///
+  /// Only supported on Linux and Windows, it never emits on other platforms.
+  Stream<RecorderProgress> get progress => const Stream.empty();
+
+  /// The encoded file as ogg pages, emitted as soon as each page is complete
+  /// so it can be uploaded while recording. Closes after the last page.
+  ///
+  /// Listen before [start] to receive the header pages too. Only supported on
+  /// Linux and Windows, it never emits on other platforms.
+  Stream<Uint8List> get pages => const Stream.empty();
+
+  /// The first page of [pages] with the gain of [setLoudnessTarget], once
+  /// [pages] closes. The first page is emitted before the loudness is known,
+  /// uploads of [pages] must replace it with this one to match the file.
+  ///
+  /// Null if the gain was not measured, or on other platforms than Linux and
+  /// Windows.
+  Future<Uint8List?> get headerPage => Future.value(null);
+
+  /// Skip the silence before the first and after the last speech, and
+  /// shorten pauses longer than [maxPause] to it, if given. The silence which
+  /// is kept is encoded in almost no bytes. [duration] and the waveform only
+  /// cover the recorded audio which is kept, [progress] keeps being emitted
+  /// during silence.
+  ///
+  /// Must be called before [start]. Only supported on Linux and Windows, it
+  /// does nothing on other platforms.
+  void enableVoiceActivityDetection({Duration? maxPause}) {}
+
+  /// Measure the EBU R128 loudness while recording, and on [stop] store the
+  /// gain which brings it to [targetLufs] in the file header. Players apply
+  /// the gain while decoding, the audio itself is not changed.
+  ///
+  /// Must be called before [start]. Only supported on Linux and Windows, it
+  /// does nothing on other platforms.
+  void setLoudnessTarget(double targetLufs) {}
+
+  /// The integrated loudness of the recording in LUFS, after [stop] when
+  /// [setLoudnessTarget] was called. Null if it was not measured, or the
+  /// recording is too short or silent.
+  Future<double?> loudness() => Future.value(null);
+}
+
+class RecorderProgress {
+  RecorderProgress({
+    required this.duration,
+    required this.rmsLevel,
+    required this.peakLevel,
+    required this.waveform,
+    required this.encodedDuration,
+  });
+
+  /// Recorded duration, in seconds, including silence which is not encoded.
+  final double duration;
+
+  /// Duration of the encoded audio, in seconds. Less than [duration] when
+  /// [OggOpusRecorder.enableVoiceActivityDetection] drops silence.
+  final double encodedDuration;
+
+  /// RMS level of the audio since the previous progress, from 0.0 to 1.0.
+  final double rmsLevel;
+
+  /// Peak level of the audio since the previous progress, from 0.0 to 1.0.
+  final double peakLevel;
+
+  /// The waveform samples encoded since the previous progress.
+  final Int16List waveform;
+}
+
+class PlayerAnalysis {
+  PlayerAnalysis({
+    required this.rmsLevel,
+    required this.peakLevel,
+    required this.spectrum,
+  });
+
+  /// RMS level of the audio since the previous analysis, from 0.0 to 1.0.
+  final double rmsLevel;
+
+  /// Peak level of the audio since the previous analysis, from 0.0 to 1.0.
+  final double peakLevel;
+
+  /// Levels of logarithmic bands from 100Hz to 16kHz, from 0.0 to 1.0 where
+  /// 1.0 is a full scale sine.
+  final Float32List spectrum;
+}
+
+/// Limit the memory of the decoded audio kept by players, in bytes.
+///
+/// Files shorter than 60 seconds are decoded once and replayed from memory
+/// until the file changes. The least recently played files are dropped when
+/// the cache exceeds [bytes], 32MB by default. 0 disables the cache.
+///
+/// Only has an effect on Linux and Windows.
+void setPlayerCacheBudget(int bytes) {
+  if (Platform.isLinux || Platform.isWindows) {
+    setPlayerCacheBudgetFfi(bytes);
+  }
+}
+
+/// Load the waveforms of the ogg opus files at [paths].
+///
+/// Files are decoded in parallel by native worker threads. Each waveform is
+/// [buckets] peak values packed as 5 bits each, the same format recorded on
+/// Android. The waveform of a file which can not be decoded is all zeros.
+///
+/// The native call runs in a background isolate with [compute], the calling
+/// isolate is not blocked while the files are decoded.
+///
+/// Only supported on Linux and Windows.
+Future<List<Uint8List>> loadWaveforms(
+  List<String> paths, {
+  int buckets = 100,
+}) {
+  if (Platform.isLinux || Platform.isWindows) {
+    return loadWaveformsFfi(paths, buckets);
+  }
+  throw UnsupportedError('Platform not supported');
+}
+
+/// Read the metadata of the ogg opus files at [paths] from their headers,
+/// without decoding any audio. Returns null for files which can not be read.
+///
+/// If [cachePath] is given, metadata is cached in that file keyed by path,
+/// modification time and size, so probing a known file only costs a stat.
+///
+/// Like [loadWaveforms], the native call runs in a background isolate with
+/// [compute].
+///
+/// Only supported on Linux and Windows.
+Future<List<OggOpusMetadata?>> probeMetadata(
+  List<String> paths, {
+  String? cachePath,
+}) {
+  if (Platform.isLinux || Platform.isWindows) {
+    return probeMetadataFfi(paths, cachePath);
+  }
+  throw UnsupportedError('Platform not supported');
+}
+
+enum OggOpusRenderFormat {
+  /// 16 bit pcm wav, 48kHz.
+  wav,
+
+  /// ogg opus, re-encoded at the bitrate of the input.
+  opus,
+}
+
+/// Render the ogg opus file at [inputPath] at another [speed] and [pitch] to
+/// [outputPath], without playing it. Runs as fast as the cpu allows, in a
+/// background isolate with [compute], and completes once the file is written.
+///
+/// If [pipelined] is true, decoding, time stretching and encoding run on
+/// separate native threads.
+///
+/// Only supported on Linux and Windows.
+Future<void> renderOggOpus(
+  String inputPath,
+  String outputPath, {
+  double speed = 1.0,
+  double pitch = 1.0,
+  OggOpusRenderFormat format = OggOpusRenderFormat.opus,
+  bool pipelined = false,
+}) {
+  if (Platform.isLinux || Platform.isWindows) {
+    return renderOggOpusFfi(
+        inputPath, outputPath, speed, pitch, format, pipelined);
+  }
+  throw UnsupportedError('Platform not supported');
+}
+
+/// Copy the audio of [inputPath] from [start] to [end] to [outputPath],
+/// without decoding or re-encoding it. If [end] is null, everything after
+/// [start] is kept.
+///
+/// The files are read and written in a background isolate with [compute].
+///
+/// Only supported on Linux and Windows.
+Future<void> trimOggOpus(
+  String inputPath,
+  String outputPath, {
+  Duration start = Duration.zero,
+  Duration? end,
+}) {
+  if (Platform.isLinux || Platform.isWindows) {
+    return trimOggOpusFfi(inputPath, outputPath, start, end);
+  }
+  throw UnsupportedError('Platform not supported');
+}
+
+/// Join the ogg opus files at [inputPaths] into [outputPath], without
+/// decoding or re-encoding them. The files must have the same channel count,
+/// e.g. voice messages from the same recorder.
+///
+/// Like [trimOggOpus], the files are read and written in a background isolate.
+///
+/// Only supported on Linux and Windows.
+Future<void> concatOggOpus(List<String> inputPaths, String outputPath) {
+  if (Platform.isLinux || Platform.isWindows) {
+    return concatOggOpusFfi(inputPaths, outputPath);
+  }
+  throw UnsupportedError('Platform not supported');
+}
+
+/// Normalize the loudness of the ogg opus files at [paths] to [targetLufs],
+/// by measuring their EBU R128 loudness and storing the gain in their
+/// headers. Only the first page of each file is rewritten.
+///
+/// Returns the measured loudness of each file in LUFS, null for files which
+/// could not be read, or are too short or silent to be measured.
+///
+/// The native call runs in a background isolate with [compute], the calling
+/// isolate is not blocked while the files are measured.
+///
+/// Only supported on Linux and Windows.
+Future<List<double?>> normalizeLoudness(
+  List<String> paths, {
+  double targetLufs = -23,
+}) {
+  if (Platform.isLinux || Platform.isWindows) {
+    return normalizeLoudnessFfi(paths, targetLufs);
+  }
+  throw UnsupportedError('Platform not supported');
 }
@@ -1,4 +1,5 @@
 import 'dart:async';
+import 'dart:convert';
 import 'dart:ffi';
 import 'dart:io';
 import 'dart:isolate';
@@ -7,9 +8,42 @@ import 'package:ffi/ffi.dart';
 import 'package:flutter/foundation.dart';
 import 'package:ogg_opus_player/src/player.dart';
 
+import 'metadata.dart';
 import 'ogg_opus_bindings_generated.dart';
 import 'player_state.dart';
 
+/// The default rate at which [OggOpusPlayerFfiImpl.position] is emitted.
+const _playerPositionInterval = Duration(milliseconds: 50);
+
+/// The rate at which [OggOpusPlayerFfiImpl.analysis] is emitted.
+const _playerAnalysisInterval = Duration(milliseconds: 33);
+
+PlayerState _convertFromNativeState(int state) {
+  switch (state) {
+    case OGG_OPUS_PLAYER_STATE_BUFFERING:
+      return PlayerState.buffering;
+    case OGG_OPUS_PLAYER_STATE_PLAYING:
+      return PlayerState.playing;
+    case OGG_OPUS_PLAYER_STATE_PAUSED:
+      return PlayerState.paused;
+    case OGG_OPUS_PLAYER_STATE_ENDED:
+      return PlayerState.ended;
+    default:
+      return PlayerState.error;
+  }
+}
+
+int _convertToNativeProfile(PlayerOutputProfile profile) {
+  switch (profile) {
+    case PlayerOutputProfile.normal:
+      return OGG_OPUS_PLAYER_PROFILE_DEFAULT;
+    case PlayerOutputProfile.lowLatency:
+      return OGG_OPUS_PLAYER_PROFILE_LOW_LATENCY;
+    case PlayerOutputProfile.powerSaving:
+      return OGG_OPUS_PLAYER_PROFILE_POWER_SAVING;
+  }
+}
+
 class OggOpusPlayerFfiImpl extends OggOpusPlayer {
   final String _path;
 
@@ -21,6 +55,27 @@ class OggOpusPlayerFfiImpl extends OggOpusPlayer {
 
   final _state = ValueNotifier(PlayerState.idle);
 
+  Duration _positionInterval = _playerPositionInterval;
+
+  // the last position pushed by native, while [position] has listeners.
+  double? _position;
+
+  late final StreamController<double> _positions = StreamController.broadcast(
+    onListen: () => _updatePositionInterval(),
+    onCancel: () {
+      _position = null;
+      _updatePositionInterval();
+    },
+  );
+
+  int _analysisBands = 16;
+
+  late final StreamController<PlayerAnalysis> _analysis =
+      StreamController.broadcast(
+    onListen: () => _updateAnalysis(),
+    onCancel: () => _updateAnalysis(),
+  );
+
   @override
   ValueListenable<PlayerState> get state => _state;
 
@@ -29,30 +84,76 @@ class OggOpusPlayerFfiImpl extends OggOpusPlayer {
     if (_playerHandle == nullptr) {
       return 0;
     }
+    final position = _position;
+    if (position != null && _state.value != PlayerState.playing) {
+      return position;
+    }
     return _bindings.ogg_opus_player_get_current_time(_playerHandle);
   }
 
-  OggOpusPlayerFfiImpl(this._path)
-      : _port = ReceivePort('OggOpusPlayer: #$_path'),
+  @override
+  Stream<double> get position => _positions.stream;
+
+  OggOpusPlayerFfiImpl(
+    this._path, {
+    PlayerOutputProfile profile = PlayerOutputProfile.normal,
+  })  : _port = ReceivePort('OggOpusPlayer: #$_path'),
         super.create() {
     _initializeDartApi();
-    _playerHandle = _bindings.ogg_opus_player_create(
-        _path.toNativeUtf8().cast(), _port.sendPort.nativePort);
+    // the player keeps its own copy of the path.
+    final nativePath = _path.toNativeUtf8();
+    _playerHandle = _bindings.ogg_opus_player_create_with_profile(
+      nativePath.cast(),
+      _port.sendPort.nativePort,
+      _convertToNativeProfile(profile),
+    );
+    malloc.free(nativePath);
     _portSubscription = _port.listen((message) {
-      if (message is int) {
-        // 0: play finished
-        if (message == 0) {
+      if (message is! List || message.length < 2) {
+        return;
+      }
+      if (message[0] == 0) {
+        // 0: state changed
+        final state = _convertFromNativeState(message[1] as int);
+        if (state == PlayerState.ended) {
           _bindings.ogg_opus_player_pause(_playerHandle);
-          _state.value = PlayerState.ended;
         }
+        _state.value = state;
+      } else if (message[0] == 1) {
+        // 1: position
+        _position = message[1] as double;
+        _positions.add(_position!);
+      } else if (message[0] == 2) {
+        // 2: analysis of the heard audio
+        final levels = message[1] as Float32List;
+        _analysis.add(PlayerAnalysis(
+          rmsLevel: levels[0],
+          peakLevel: levels[1],
+          spectrum: Float32List.sublistView(levels, 2),
+        ));
       }
     });
   }
 
+  void _updatePositionInterval() {
+    if (_playerHandle != nullptr) {
+      _bindings.ogg_opus_player_set_position_interval(
+        _playerHandle,
+        _positions.hasListener ? _positionInterval.inMilliseconds : 0,
+      );
+    }
+  }
+
+  @override
+  void setPositionInterval(Duration interval) {
+    assert(interval > Duration.zero);
+    _positionInterval = interval;
+    _updatePositionInterval();
+  }
+
   @override
   void play() {
     if (_playerHandle != nullptr) {
-      _state.value = PlayerState.playing;
       _bindings.ogg_opus_player_play(_playerHandle);
     }
   }
@@ -60,11 +161,41 @@ class OggOpusPlayerFfiImpl extends OggOpusPlayer {
   @override
   void pause() {
     if (_playerHandle != nullptr) {
-      _state.value = PlayerState.paused;
       _bindings.ogg_opus_player_pause(_playerHandle);
     }
   }
 
+  void _updateAnalysis() {
+    if (_playerHandle != nullptr) {
+      _bindings.ogg_opus_player_set_analysis(
+        _playerHandle,
+        _analysis.hasListener ? _playerAnalysisInterval.inMilliseconds : 0,
+        _analysisBands,
+      );
+    }
+  }
+
+  @override
+  Stream<PlayerAnalysis> get analysis => _analysis.stream;
+
+  @override
+  void setAnalysisBands(int bands) {
+    assert(bands >= 0 && bands <= 64);
+    _analysisBands = bands;
+    if (_analysis.hasListener) {
+      _updateAnalysis();
+    }
+  }
+
+  @override
+  Duration get outputLatency {
+    if (_playerHandle == nullptr) {
+      return Duration.zero;
+    }
+    final seconds = _bindings.ogg_opus_player_get_output_latency(_playerHandle);
+    return Duration(microseconds: (seconds * 1000000).round());
+  }
+
   @override
   void setPlaybackRate(double speed) {
     if (_playerHandle != nullptr) {
@@ -76,6 +207,8 @@ class OggOpusPlayerFfiImpl extends OggOpusPlayer {
   @override
   void dispose() {
     _portSubscription?.cancel();
+    _positions.close();
+    _analysis.close();
     if (_playerHandle != nullptr) {
       _bindings.ogg_opus_player_dispose(_playerHandle);
       _playerHandle = nullptr;
@@ -113,20 +246,345 @@ final DynamicLibrary _dylib = () {
 /// The bindings to the native functions in [_dylib].
 final _bindings = OggOpusBindings(_dylib);
 
+void setPlayerCacheBudgetFfi(int bytes) {
+  _bindings.ogg_opus_player_set_pcm_cache_budget(bytes);
+}
+
+Future<List<Uint8List>> loadWaveformsFfi(List<String> paths, int buckets) {
+  if (paths.isEmpty) {
+    return Future.value(const []);
+  }
+  // the native call blocks until every file is decoded.
+  return compute(_loadWaveforms, _WaveformBatch(paths, buckets));
+}
+
+class _WaveformBatch {
+  _WaveformBatch(this.paths, this.buckets);
+
+  final List<String> paths;
+  final int buckets;
+}
+
+List<Uint8List> _loadWaveforms(_WaveformBatch batch) {
+  final paths = batch.paths;
+  final buckets = batch.buckets;
+  final packedSize = _bindings.ogg_opus_waveform_packed_size(buckets);
+  final nativePaths = malloc<Pointer<Char>>(paths.length);
+  for (var i = 0; i < paths.length; i++) {
+    nativePaths[i] = paths[i].toNativeUtf8().cast();
+  }
+  final out = malloc<Uint8>(packedSize * paths.length);
+  _bindings.ogg_opus_waveform_batch(nativePaths, paths.length, buckets, out);
+  final bytes = out.asTypedList(packedSize * paths.length);
+  final waveforms = List.generate(
+    paths.length,
+    (i) => Uint8List.fromList(
+      bytes.sublist(i * packedSize, (i + 1) * packedSize),
+    ),
+  );
+  for (var i = 0; i < paths.length; i++) {
+    malloc.free(nativePaths[i]);
+  }
+  malloc.free(nativePaths);
+  malloc.free(out);
+  return waveforms;
+}
+
+Future<List<OggOpusMetadata?>> probeMetadataFfi(
+    List<String> paths, String? cachePath) {
+  if (paths.isEmpty) {
+    return Future.value(const []);
+  }
+  // files missing from the cache are read, which blocks on the disk.
+  return compute(_probeMetadata, _ProbeBatch(paths, cachePath));
+}
+
+class _ProbeBatch {
+  _ProbeBatch(this.paths, this.cachePath);
+
+  final List<String> paths;
+  final String? cachePath;
+}
+
+List<OggOpusMetadata?> _probeMetadata(_ProbeBatch batch) {
+  final paths = batch.paths;
+  final cachePath = batch.cachePath;
+  final nativePaths = malloc<Pointer<Char>>(paths.length);
+  for (var i = 0; i < paths.length; i++) {
+    nativePaths[i] = paths[i].toNativeUtf8().cast();
+  }
+  final nativeCachePath =
+      cachePath == null ? nullptr : cachePath.toNativeUtf8().cast<Char>();
+  final infos = malloc<OggOpusProbeInfo>(paths.length);
+  final results = malloc<Int32>(paths.length);
+  _bindings.ogg_opus_probe_batch(
+      nativePaths, paths.length, nativeCachePath, infos, results);
+
+  final metadata = List<OggOpusMetadata?>.generate(paths.length, (i) {
+    if (results[i] != 0) {
+      return null;
+    }
+    final info = infos[i];
+    final tagBytes = <int>[];
+    for (var j = 0; j < OGG_OPUS_PROBE_TAGS_SIZE && info.tags[j] != 0; j++) {
+      tagBytes.add(info.tags[j] & 0xff);
+    }
+    final tags = utf8.decode(tagBytes, allowMalformed: true);
+    return OggOpusMetadata(
+      duration: Duration(microseconds: info.duration * 1000 ~/ 48),
+      channels: info.channels,
+      inputSampleRate: info.input_sample_rate,
+      outputGain: info.output_gain / 256.0,
+      bitrate: info.bitrate,
+      tags: tags.isEmpty ? const [] : tags.split('\n'),
+    );
+  });
+
+  for (var i = 0; i < paths.length; i++) {
+    malloc.free(nativePaths[i]);
+  }
+  malloc.free(nativePaths);
+  if (nativeCachePath != nullptr) {
+    malloc.free(nativeCachePath);
+  }
+  malloc.free(infos);
+  malloc.free(results);
+  return metadata;
+}
+
+Future<void> renderOggOpusFfi(
+  String inputPath,
+  String outputPath,
+  double speed,
+  double pitch,
+  OggOpusRenderFormat format,
+  bool pipelined,
+) {
+  // the whole file is decoded and encoded again before the call returns.
+  return compute(
+    _renderOggOpus,
+    _RenderJob(inputPath, outputPath, speed, pitch, format, pipelined),
+  );
+}
+
+class _RenderJob {
+  _RenderJob(this.inputPath, this.outputPath, this.speed, this.pitch,
+      this.format, this.pipelined);
+
+  final String inputPath;
+  final String outputPath;
+  final double speed;
+  final double pitch;
+  final OggOpusRenderFormat format;
+  final bool pipelined;
+}
+
+void _renderOggOpus(_RenderJob job) {
+  final inputPath = job.inputPath;
+  final outputPath = job.outputPath;
+  final format = job.format;
+  final nativeInput = inputPath.toNativeUtf8();
+  final nativeOutput = outputPath.toNativeUtf8();
+  var nativeFormat = format == OggOpusRenderFormat.wav
+      ? OGG_OPUS_RENDER_FORMAT_WAV
+      : OGG_OPUS_RENDER_FORMAT_OPUS;
+  if (job.pipelined) {
+    nativeFormat |= OGG_OPUS_RENDER_PIPELINED;
+  }
+  final result = _bindings.ogg_opus_render(nativeInput.cast(),
+      nativeOutput.cast(), job.speed, job.pitch, nativeFormat);
+  malloc.free(nativeInput);
+  malloc.free(nativeOutput);
+  if (result != 0) {
+    throw Exception('render $inputPath failed: $result');
+  }
+}
+
+Future<void> trimOggOpusFfi(
+  String inputPath,
+  String outputPath,
+  Duration start,
+  Duration? end,
+) {
+  // the whole input is read and the output written before the call returns.
+  return compute(_trimOggOpus, _TrimJob(inputPath, outputPath, start, end));
+}
+
+class _TrimJob {
+  _TrimJob(this.inputPath, this.outputPath, this.start, this.end);
+
+  final String inputPath;
+  final String outputPath;
+  final Duration start;
+  final Duration? end;
+}
+
+void _trimOggOpus(_TrimJob job) {
+  final inputPath = job.inputPath;
+  final end = job.end;
+  final nativeInput = inputPath.toNativeUtf8();
+  final nativeOutput = job.outputPath.toNativeUtf8();
+  final result = _bindings.ogg_opus_trim(
+    nativeInput.cast(),
+    nativeOutput.cast(),
+    job.start.inMicroseconds * 48 ~/ 1000,
+    end == null ? -1 : end.inMicroseconds * 48 ~/ 1000,
+  );
+  malloc.free(nativeInput);
+  malloc.free(nativeOutput);
+  if (result != 0) {
+    throw Exception('trim $inputPath failed: $result');
+  }
+}
+
+Future<void> concatOggOpusFfi(List<String> inputPaths, String outputPath) {
+  return compute(_concatOggOpus, _ConcatJob(inputPaths, outputPath));
+}
+
+class _ConcatJob {
+  _ConcatJob(this.inputPaths, this.outputPath);
+
+  final List<String> inputPaths;
+  final String outputPath;
+}
+
+void _concatOggOpus(_ConcatJob job) {
+  final inputPaths = job.inputPaths;
+  final outputPath = job.outputPath;
+  final nativePaths = malloc<Pointer<Char>>(inputPaths.length);
+  for (var i = 0; i < inputPaths.length; i++) {
+    nativePaths[i] = inputPaths[i].toNativeUtf8().cast();
+  }
+  final nativeOutput = outputPath.toNativeUtf8();
+  final result = _bindings.ogg_opus_concat(
+      nativePaths, inputPaths.length, nativeOutput.cast());
+  for (var i = 0; i < inputPaths.length; i++) {
+    malloc.free(nativePaths[i]);
+  }
+  malloc.free(nativePaths);
+  malloc.free(nativeOutput);
+  if (result != 0) {
+    throw Exception('concat to $outputPath failed: $result');
+  }
+}
+
+Future<List<double?>> normalizeLoudnessFfi(
+    List<String> paths, double targetLufs) {
+  if (paths.isEmpty) {
+    return Future.value(const []);
+  }
+  // the native call blocks until every file is measured and rewritten.
+  return compute(_normalizeLoudness, _LoudnessBatch(paths, targetLufs));
+}
+
+class _LoudnessBatch {
+  _LoudnessBatch(this.paths, this.targetLufs);
+
+  final List<String> paths;
+  final double targetLufs;
+}
+
+List<double?> _normalizeLoudness(_LoudnessBatch batch) {
+  final paths = batch.paths;
+  final targetLufs = batch.targetLufs;
+  final nativePaths = malloc<Pointer<Char>>(paths.length);
+  for (var i = 0; i < paths.length; i++) {
+    nativePaths[i] = paths[i].toNativeUtf8().cast();
+  }
+  final loudness = malloc<Double>(paths.length);
+  final results = malloc<Int32>(paths.length);
+  _bindings.ogg_opus_normalize_loudness(
+      nativePaths, paths.length, targetLufs, loudness, results);
+  final values = List<double?>.generate(paths.length, (i) {
+    final value = loudness[i];
+    return results[i] == 0 && value.isFinite ? value : null;
+  });
+  for (var i = 0; i < paths.length; i++) {
+    malloc.free(nativePaths[i]);
+  }
+  malloc.free(nativePaths);
+  malloc.free(loudness);
+  malloc.free(results);
+  return values;
+}
+
+/// The rate at which [OggOpusRecorderFfiImpl.progress] is emitted.
+const _recorderProgressInterval = Duration(milliseconds: 33);
+
+/// The most audio in one page of [OggOpusRecorderFfiImpl.pages].
+const _recorderMaxPageDelay = Duration(milliseconds: 250);
+
 class OggOpusRecorderFfiImpl extends OggOpusRecorder {
   final String _path;
 
   Pointer<Void> _recorderHandle = nullptr;
   final ReceivePort _port;
 
+  late final StreamController<RecorderProgress> _progress =
+      StreamController.broadcast(
+    onListen: () => _setProgressInterval(_recorderProgressInterval),
+    onCancel: () => _setProgressInterval(Duration.zero),
+  );
+
+  late final StreamController<Uint8List> _pages = StreamController.broadcast(
+    onListen: () {
+      if (_recorderHandle != nullptr) {
+        _bindings.ogg_opus_recorder_enable_page_stream(
+            _recorderHandle, _recorderMaxPageDelay.inMilliseconds);
+      }
+    },
+  );
+
+  final _headerPage = Completer<Uint8List?>();
+
   OggOpusRecorderFfiImpl(this._path)
       : _port = ReceivePort('OggOpusRecorderFfiImpl: $_path'),
         super.create() {
     _initializeDartApi();
     _recorderHandle = _bindings.ogg_opus_recorder_create(
         _path.toNativeUtf8().cast(), _port.sendPort.nativePort);
+    _port.listen((message) {
+      if (message is List && message.isNotEmpty && message[0] == 0) {
+        // 0: recording progress
+        _progress.add(RecorderProgress(
+          duration: message[1] as double,
+          rmsLevel: message[2] as double,
+          peakLevel: message[3] as double,
+          waveform: message[4] as Int16List,
+          encodedDuration: message[5] as double,
+        ));
+      } else if (message is List && message.isNotEmpty && message[0] == 1) {
+        // 1: an encoded ogg page
+        _pages.add(message[1] as Uint8List);
+      } else if (message is List && message.isNotEmpty && message[0] == 2) {
+        // 2: the last page was posted
+        _pages.close();
+        if (!_headerPage.isCompleted) {
+          _headerPage.complete(null);
+        }
+      } else if (message is List && message.isNotEmpty && message[0] == 3) {
+        // 3: the first page with the loudness gain, before the last page
+        _headerPage.complete(message[1] as Uint8List);
+      }
+    });
+  }
+
+  void _setProgressInterval(Duration interval) {
+    if (_recorderHandle != nullptr) {
+      _bindings.ogg_opus_recorder_set_progress_interval(
+          _recorderHandle, interval.inMilliseconds);
+    }
   }
 
+  @override
+  Stream<RecorderProgress> get progress => _progress.stream;
+
+  @override
+  Stream<Uint8List> get pages => _pages.stream;
+
+  @override
+  Future<Uint8List?> get headerPage => _headerPage.future;
+
   @override
   void start() {
     if (_recorderHandle != nullptr) {
@@ -148,6 +606,12 @@ class OggOpusRecorderFfiImpl extends OggOpusRecorder {
       _bindings.ogg_opus_recorder_destroy(_recorderHandle);
       _recorderHandle = nullptr;
     }
+    _port.close();
+    _progress.close();
+    _pages.close();
+    if (!_headerPage.isCompleted) {
+      _headerPage.complete(null);
+    }
   }
 
   @override
@@ -155,7 +619,33 @@ class OggOpusRecorderFfiImpl extends OggOpusRecorder {
     if (_recorderHandle == nullptr) {
       return 0;
     }
-    return _bindings.ogg_opus_recorder_get_duration(_recorderHandle);
+    // the duration of the file, without the silence which was dropped.
+    return _bindings.ogg_opus_recorder_get_encoded_duration(_recorderHandle);
+  }
+
+  @override
+  void enableVoiceActivityDetection({Duration? maxPause}) {
+    if (_recorderHandle != nullptr) {
+      _bindings.ogg_opus_recorder_enable_voice_activity_detection(
+          _recorderHandle, maxPause?.inMilliseconds ?? 0);
+    }
+  }
+
+  @override
+  void setLoudnessTarget(double targetLufs) {
+    if (_recorderHandle != nullptr) {
+      _bindings.ogg_opus_recorder_set_loudness_target(
+          _recorderHandle, targetLufs);
+    }
+  }
+
+  @override
+  Future<double?> loudness() async {
+    if (_recorderHandle == nullptr) {
+      return null;
+    }
+    final value = _bindings.ogg_opus_recorder_get_loudness(_recorderHandle);
+    return value.isFinite ? value : null;
   }
 
   @override
@@ -4,4 +4,7 @@ enum PlayerState {
   playing,
   paused,
   ended,
+
+  /// play was requested, the audio has not reached the device yet.
+  buffering,
 }
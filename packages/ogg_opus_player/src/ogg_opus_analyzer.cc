@@ -0,0 +1,136 @@
+#include "ogg_opus_analyzer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace {
+
+const int kFftSize = 1024;
+const int kFftHop = kFftSize / 2;
+
+const double kLowestBandHz = 100;
+const double kHighestBandHz = 16000;
+
+// M_PI is not defined by msvc without _USE_MATH_DEFINES.
+const double kPi = 3.14159265358979323846;
+
+}
+
+PlaybackAnalyzer::PlaybackAnalyzer(int sample_rate, int channels, int bands)
+    : channels_(std::max(1, channels)), window_(kFftSize) {
+  bands = std::max(0, std::min(kMaxBands, bands));
+  band_levels_.resize(bands);
+  last_band_levels_.resize(bands);
+  if (bands == 0) {
+    return;
+  }
+
+  hann_.resize(kFftSize);
+  for (int i = 0; i < kFftSize; ++i) {
+    hann_[i] = float(0.5 - 0.5 * std::cos(2 * kPi * i / kFftSize));
+  }
+  twiddles_.resize(kFftSize / 2);
+  for (int i = 0; i < kFftSize / 2; ++i) {
+    twiddles_[i] = std::polar(1.0f, float(-2 * kPi * i / kFftSize));
+  }
+  int bits = 0;
+  while ((1 << bits) < kFftSize) {
+    bits++;
+  }
+  bit_reverse_.resize(kFftSize);
+  for (int i = 0; i < kFftSize; ++i) {
+    int reversed = 0;
+    for (int b = 0; b < bits; ++b) {
+      reversed |= ((i >> b) & 1) << (bits - 1 - b);
+    }
+    bit_reverse_[i] = reversed;
+  }
+  fft_.resize(kFftSize);
+
+  // logarithmic bands, at least one bin wide each.
+  auto highest = std::min(kHighestBandHz, sample_rate / 2.0);
+  auto lowest = std::min(kLowestBandHz, highest / 2);
+  band_edges_.resize(bands + 1);
+  for (int i = 0; i <= bands; ++i) {
+    auto frequency = lowest * std::pow(highest / lowest, double(i) / bands);
+    band_edges_[i] = int(std::lround(frequency * kFftSize / sample_rate));
+  }
+  band_edges_[0] = std::max(1, band_edges_[0]);
+  for (int i = 1; i <= bands; ++i) {
+    band_edges_[i] = std::max(band_edges_[i], band_edges_[i - 1] + 1);
+  }
+  // only the widest bands of tiny sample rates could be pushed past nyquist.
+  for (int i = bands; i >= 0; --i) {
+    band_edges_[i] = std::min(band_edges_[i], kFftSize / 2 + 1 - (bands - i));
+  }
+}
+
+void PlaybackAnalyzer::Process(const int16_t *samples, int frames) {
+  for (int i = 0; i < frames * channels_; ++i) {
+    int32_t sample = samples[i];
+    square_sum_ += double(sample * sample);
+    peak_ = std::max(peak_, std::abs(sample));
+  }
+  pending_frames_ += frames;
+  if (band_levels_.empty()) {
+    return;
+  }
+
+  for (int i = 0; i < frames; ++i) {
+    int32_t sum = 0;
+    for (int c = 0; c < channels_; ++c) {
+      sum += samples[i * channels_ + c];
+    }
+    window_[window_length_++] = float(sum) / float(channels_ * 32768);
+    if (window_length_ == kFftSize) {
+      Transform();
+      // keep the second half, windows overlap by a hop.
+      std::copy(window_.begin() + kFftHop, window_.end(), window_.begin());
+      window_length_ = kFftSize - kFftHop;
+    }
+  }
+}
+
+void PlaybackAnalyzer::Transform() {
+  for (int i = 0; i < kFftSize; ++i) {
+    fft_[bit_reverse_[i]] = window_[i] * hann_[i];
+  }
+  for (int size = 2; size <= kFftSize; size <<= 1) {
+    auto half = size / 2;
+    auto step = kFftSize / size;
+    for (int start = 0; start < kFftSize; start += size) {
+      for (int k = 0; k < half; ++k) {
+        auto odd = fft_[start + k + half] * twiddles_[k * step];
+        fft_[start + k + half] = fft_[start + k] - odd;
+        fft_[start + k] += odd;
+      }
+    }
+  }
+  // the hann window halves the amplitude, a full scale sine peaks at
+  // kFftSize / 4.
+  auto scale = 4.0f / kFftSize;
+  for (size_t band = 0; band < band_levels_.size(); ++band) {
+    float level = 0;
+    for (int bin = band_edges_[band]; bin < band_edges_[band + 1]; ++bin) {
+      level = std::max(level, std::abs(fft_[bin]) * scale);
+    }
+    band_levels_[band] = std::max(band_levels_[band], std::min(1.0f, level));
+  }
+  band_count_++;
+}
+
+void PlaybackAnalyzer::Take(float *out) {
+  out[0] = pending_frames_ > 0
+           ? float(std::sqrt(square_sum_ / double(pending_frames_ * channels_)) / 32768.0) : 0;
+  out[1] = float(peak_ / 32768.0);
+  if (band_count_ > 0) {
+    last_band_levels_ = band_levels_;
+    std::fill(band_levels_.begin(), band_levels_.end(), 0.0f);
+    band_count_ = 0;
+  }
+  std::copy(last_band_levels_.begin(), last_band_levels_.end(), out + 2);
+  pending_frames_ = 0;
+  square_sum_ = 0;
+  peak_ = 0;
+}
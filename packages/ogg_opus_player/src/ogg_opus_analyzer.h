@@ -0,0 +1,60 @@
+#ifndef OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_ANALYZER_H_
+#define OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_ANALYZER_H_
+
+#include <complex>
+#include <cstdint>
+#include <vector>
+
+// Levels and a coarse spectrum of played audio, for animating playback.
+//
+// The spectrum is the channel average through a 1024 point hann windowed fft,
+// every 512 frames. Bands are spaced logarithmically from 100Hz to 16kHz, or
+// the nyquist frequency of lower rates.
+class PlaybackAnalyzer {
+
+ public:
+  // `bands` from 0, for levels only, to kMaxBands.
+  PlaybackAnalyzer(int sample_rate, int channels, int bands);
+
+  static constexpr int kMaxBands = 64;
+
+  int Bands() const { return int(band_levels_.size()); }
+
+  // Add `frames` frames of interleaved pcm.
+  void Process(const int16_t *samples, int frames);
+
+  // Frames processed since the last Take.
+  int64_t PendingFrames() const { return pending_frames_; }
+
+  // Write the rms level, the peak level and Bands() band levels of the frames
+  // processed since the last call into `out`, all from 0.0 to 1.0, and start
+  // over. A band is the loudest bin in it, 1.0 for a full scale sine. Bands
+  // repeat the last spectrum if no fft completed since.
+  void Take(float *out);
+
+ private:
+  int channels_;
+
+  int64_t pending_frames_ = 0;
+  double square_sum_ = 0;
+  int32_t peak_ = 0;
+
+  // the last kFftSize mono samples, filled from the front.
+  std::vector<float> window_;
+  int window_length_ = 0;
+  std::vector<float> hann_;
+  std::vector<std::complex<float>> twiddles_;
+  std::vector<int> bit_reverse_;
+  std::vector<std::complex<float>> fft_;
+
+  // bins of band i are [band_edges_[i], band_edges_[i + 1]).
+  std::vector<int> band_edges_;
+  std::vector<float> band_levels_;
+  int band_count_ = 0;
+  std::vector<float> last_band_levels_;
+
+  void Transform();
+
+};
+
+#endif //OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_ANALYZER_H_
@@ -0,0 +1,54 @@
+#ifndef OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_CALLBACK_TIMER_H_
+#define OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_CALLBACK_TIMER_H_
+
+#include <cstdint>
+
+#ifdef OGG_OPUS_PLAYER_CALLBACK_HOOK
+
+#include <chrono>
+
+// Defined by the pipeline benchmark. Called after every sdl audio callback,
+// which took `elapsed_ns` to handle `frames` frames at `sample_rate`. `missing`
+// frames could not be handled: silence played before the end of the file, or
+// capture dropped because the ring was full.
+void ogg_opus_callback_hook(bool capture, int64_t elapsed_ns, int frames, int missing, int sample_rate);
+
+// Times the scope of an sdl audio callback for ogg_opus_callback_hook.
+class AudioCallbackTimer {
+
+ public:
+  AudioCallbackTimer(bool capture, int frames, int sample_rate)
+      : capture_(capture), frames_(frames), sample_rate_(sample_rate), start_(std::chrono::steady_clock::now()) {}
+
+  void SetMissing(int frames) { missing_ = frames; }
+
+  ~AudioCallbackTimer() {
+    auto elapsed = std::chrono::steady_clock::now() - start_;
+    ogg_opus_callback_hook(capture_, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(),
+                           frames_, missing_, sample_rate_);
+  }
+
+ private:
+  bool capture_;
+  int frames_;
+  int sample_rate_;
+  int missing_ = 0;
+  std::chrono::steady_clock::time_point start_;
+
+};
+
+#else
+
+// Compiled out unless OGG_OPUS_PLAYER_CALLBACK_HOOK is defined.
+class AudioCallbackTimer {
+
+ public:
+  AudioCallbackTimer(bool, int, int) {}
+
+  void SetMissing(int) {}
+
+};
+
+#endif
+
+#endif //OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_CALLBACK_TIMER_H_
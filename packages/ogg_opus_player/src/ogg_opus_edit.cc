@@ -0,0 +1,415 @@
+#include "ogg_opus_edit.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "ogg/ogg.hh"
+
+#include "ogg_opus_utils.h"
+
+namespace {
+
+// RFC 7845 recommends decoding at least 80ms before a seek target.
+const int64_t kPreRollSamples = 3840;
+
+// end a page after about this much audio, like libopusenc does, so seeking in
+// the output stays cheap.
+const int64_t kMaxPageSamples = 48000;
+
+const size_t kOpusHeadMinSize = 19;
+
+struct OpusPacket {
+  std::vector<unsigned char> data;
+  int samples;
+};
+
+// The first opus stream of an ogg file, as packets.
+struct OpusStream {
+  int serial = 0;
+  std::vector<unsigned char> head;
+  std::vector<unsigned char> tags;
+  std::vector<OpusPacket> packets;
+  // granule position at the start of the first packet.
+  int64_t start_granule = 0;
+  // granule position of the last valid sample.
+  int64_t end_granule = 0;
+
+  int PreSkip() const { return head[10] | (head[11] << 8); }
+
+  int Channels() const { return head[9]; }
+};
+
+// Number of 48kHz samples in an opus packet, read from its TOC byte as in
+// section 3.1 of RFC 6716. Returns -1 for malformed packets.
+int PacketSamples(const unsigned char *data, long size) {
+  if (size < 1) {
+    return -1;
+  }
+  auto config = data[0] >> 3;
+  int frame_size;
+  if (config < 12) {
+    // SILK: 10, 20, 40, 60ms.
+    static const int kSilkSizes[] = {480, 960, 1920, 2880};
+    frame_size = kSilkSizes[config & 3];
+  } else if (config < 16) {
+    // hybrid: 10, 20ms.
+    frame_size = (config & 1) ? 960 : 480;
+  } else {
+    // CELT: 2.5, 5, 10, 20ms.
+    frame_size = 120 << (config & 3);
+  }
+  int frames;
+  switch (data[0] & 3) {
+    case 0:frames = 1;
+      break;
+    case 1:
+    case 2:frames = 2;
+      break;
+    default:
+      if (size < 2) {
+        return -1;
+      }
+      frames = data[1] & 0x3f;
+      break;
+  }
+  auto samples = frames * frame_size;
+  // a packet is at most 120ms.
+  return samples > 5760 ? -1 : samples;
+}
+
+int ReadOpusStream(const char *path, OpusStream *stream) {
+  auto *file = open_file(path, "rb");
+  if (!file) {
+    return OGG_OPUS_EDIT_ERROR_OPEN_INPUT;
+  }
+
+  ogg_sync_state sync;
+  ogg_sync_init(&sync);
+  ogg_stream_state ogg_stream;
+  bool stream_found = false;
+  bool ended = false;
+  int64_t total_samples = 0;
+  int64_t last_granule = -1;
+  bool start_known = false;
+  int result = 0;
+
+  ogg_page page;
+  ogg_packet packet;
+  while (!ended && result == 0) {
+    auto state = ogg_sync_pageout(&sync, &page);
+    if (state < 0) {
+      // skipped some garbage.
+      continue;
+    }
+    if (state == 0) {
+      auto *buffer = ogg_sync_buffer(&sync, 4096);
+      auto bytes = fread(buffer, 1, 4096, file);
+      if (bytes == 0) {
+        break;
+      }
+      ogg_sync_wrote(&sync, long(bytes));
+      continue;
+    }
+
+    if (!stream_found) {
+      if (!ogg_page_bos(&page)) {
+        continue;
+      }
+      ogg_stream_init(&ogg_stream, ogg_page_serialno(&page));
+      ogg_stream_pagein(&ogg_stream, &page);
+      if (ogg_stream_packetout(&ogg_stream, &packet) != 1
+          || size_t(packet.bytes) < kOpusHeadMinSize
+          || memcmp(packet.packet, "OpusHead", 8) != 0) {
+        // another codec multiplexed in the file.
+        ogg_stream_clear(&ogg_stream);
+        continue;
+      }
+      stream_found = true;
+      stream->serial = ogg_page_serialno(&page);
+      stream->head.assign(packet.packet, packet.packet + packet.bytes);
+      continue;
+    }
+    if (ogg_page_serialno(&page) != stream->serial) {
+      continue;
+    }
+    if (ogg_page_granulepos(&page) >= 0) {
+      last_granule = ogg_page_granulepos(&page);
+    }
+    ended = ogg_page_eos(&page) != 0;
+    ogg_stream_pagein(&ogg_stream, &page);
+
+    while (ogg_stream_packetout(&ogg_stream, &packet) == 1) {
+      if (stream->tags.empty()) {
+        stream->tags.assign(packet.packet, packet.packet + packet.bytes);
+        continue;
+      }
+      auto samples = PacketSamples(packet.packet, packet.bytes);
+      if (samples < 0) {
+        result = OGG_OPUS_EDIT_ERROR_FORMAT;
+        break;
+      }
+      total_samples += samples;
+      stream->packets.push_back({std::vector<unsigned char>(packet.packet, packet.packet + packet.bytes), samples});
+      // the first granule position tells where the stream starts, unless it is
+      // on the last page, where it may be trimmed instead.
+      if (!start_known && packet.granulepos >= 0) {
+        start_known = true;
+        if (!ended && packet.granulepos > total_samples) {
+          stream->start_granule = packet.granulepos - total_samples;
+        }
+      }
+    }
+  }
+
+  if (stream_found) {
+    ogg_stream_clear(&ogg_stream);
+  }
+  ogg_sync_clear(&sync);
+  fclose(file);
+
+  if (result != 0) {
+    return result;
+  }
+  if (!stream_found || stream->tags.empty() || stream->packets.empty()) {
+    return OGG_OPUS_EDIT_ERROR_FORMAT;
+  }
+  stream->end_granule = stream->start_granule + total_samples;
+  if (last_granule >= 0 && last_granule < stream->end_granule) {
+    stream->end_granule = last_granule;
+  }
+  return 0;
+}
+
+class OpusStreamWriter {
+
+ public:
+  OpusStreamWriter() = default;
+
+  ~OpusStreamWriter();
+
+  int Open(const char *path, int serial);
+
+  int WriteHeaders(const std::vector<unsigned char> &head, const std::vector<unsigned char> &tags);
+
+  // `granule` is the granule position at the end of the packet.
+  int WritePacket(const OpusPacket &packet, int64_t granule, bool last);
+
+  int Close();
+
+ private:
+  FILE *file_ = nullptr;
+  bool stream_initialized_ = false;
+  ogg_stream_state stream_{};
+  int64_t packet_no_ = 0;
+  int64_t page_samples_ = 0;
+
+  bool WritePages(bool flush);
+
+};
+
+OpusStreamWriter::~OpusStreamWriter() {
+  if (stream_initialized_) {
+    ogg_stream_clear(&stream_);
+  }
+  if (file_) {
+    fclose(file_);
+  }
+}
+
+int OpusStreamWriter::Open(const char *path, int serial) {
+  file_ = open_file(path, "wb");
+  if (!file_) {
+    return OGG_OPUS_EDIT_ERROR_OPEN_OUTPUT;
+  }
+  ogg_stream_init(&stream_, serial);
+  stream_initialized_ = true;
+  return 0;
+}
+
+bool OpusStreamWriter::WritePages(bool flush) {
+  ogg_page page;
+  while (flush ? ogg_stream_flush(&stream_, &page) : ogg_stream_pageout(&stream_, &page)) {
+    if (fwrite(page.header, 1, page.header_len, file_) != size_t(page.header_len)
+        || fwrite(page.body, 1, page.body_len, file_) != size_t(page.body_len)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int OpusStreamWriter::WriteHeaders(const std::vector<unsigned char> &head, const std::vector<unsigned char> &tags) {
+  // both headers end their own page, as RFC 7845 requires.
+  ogg_packet packet{};
+  packet.packet = const_cast<unsigned char *>(head.data());
+  packet.bytes = long(head.size());
+  packet.b_o_s = 1;
+  packet.packetno = packet_no_++;
+  ogg_stream_packetin(&stream_, &packet);
+  if (!WritePages(true)) {
+    return OGG_OPUS_EDIT_ERROR_WRITE;
+  }
+  packet.packet = const_cast<unsigned char *>(tags.data());
+  packet.bytes = long(tags.size());
+  packet.b_o_s = 0;
+  packet.packetno = packet_no_++;
+  ogg_stream_packetin(&stream_, &packet);
+  return WritePages(true) ? 0 : OGG_OPUS_EDIT_ERROR_WRITE;
+}
+
+int OpusStreamWriter::WritePacket(const OpusPacket &opus_packet, int64_t granule, bool last) {
+  ogg_packet packet{};
+  packet.packet = const_cast<unsigned char *>(opus_packet.data.data());
+  packet.bytes = long(opus_packet.data.size());
+  packet.e_o_s = last ? 1 : 0;
+  packet.granulepos = granule;
+  packet.packetno = packet_no_++;
+  ogg_stream_packetin(&stream_, &packet);
+  page_samples_ += opus_packet.samples;
+  auto flush = last || page_samples_ >= kMaxPageSamples;
+  if (flush) {
+    page_samples_ = 0;
+  }
+  return WritePages(flush) ? 0 : OGG_OPUS_EDIT_ERROR_WRITE;
+}
+
+int OpusStreamWriter::Close() {
+  if (!file_) {
+    return OGG_OPUS_EDIT_ERROR_OPEN_OUTPUT;
+  }
+  auto ok = WritePages(true);
+  ok = fclose(file_) == 0 && ok;
+  file_ = nullptr;
+  return ok ? 0 : OGG_OPUS_EDIT_ERROR_WRITE;
+}
+
+// Whether the decoder set up by `a` can decode the packets of `b`.
+bool HeadsMatch(const std::vector<unsigned char> &a, const std::vector<unsigned char> &b) {
+  // channel count, then output gain, mapping family and mapping table.
+  return a.size() == b.size() && a[9] == b[9]
+      && memcmp(a.data() + 16, b.data() + 16, a.size() - 16) == 0;
+}
+
+}
+
+int32_t ogg_opus_trim(const char *in_path, const char *out_path, int64_t start, int64_t end) {
+  if (!in_path || !out_path || start < 0) {
+    return OGG_OPUS_EDIT_ERROR_ARGUMENT;
+  }
+  OpusStream stream;
+  auto result = ReadOpusStream(in_path, &stream);
+  if (result != 0) {
+    return result;
+  }
+
+  auto pcm_start = stream.start_granule + stream.PreSkip();
+  auto total = stream.end_granule - pcm_start;
+  if (end < 0 || end > total) {
+    end = total;
+  }
+  if (start >= end) {
+    return OGG_OPUS_EDIT_ERROR_ARGUMENT;
+  }
+  auto start_granule = pcm_start + start;
+  auto end_granule = pcm_start + end;
+
+  // the granule position at the start of every packet.
+  std::vector<int64_t> positions(stream.packets.size() + 1);
+  positions[0] = stream.start_granule;
+  for (size_t i = 0; i < stream.packets.size(); ++i) {
+    positions[i + 1] = positions[i] + stream.packets[i].samples;
+  }
+
+  // the packet holding the first sample, then back by the pre-roll.
+  size_t first = 0;
+  while (first + 1 < stream.packets.size() && positions[first + 1] <= start_granule) {
+    first++;
+  }
+  auto start_packet = first;
+  while (first > 0 && positions[start_packet] - positions[first] < kPreRollSamples) {
+    first--;
+  }
+  // the packet holding the last sample.
+  auto last = start_packet;
+  while (last + 1 < stream.packets.size() && positions[last + 1] < end_granule) {
+    last++;
+  }
+
+  // the output starts at granule position 0 with the first kept packet.
+  auto offset = positions[first];
+  auto pre_skip = start_granule - offset;
+  if (pre_skip > 0xffff) {
+    return OGG_OPUS_EDIT_ERROR_FORMAT;
+  }
+  auto head = stream.head;
+  head[10] = uint8_t(pre_skip);
+  head[11] = uint8_t(pre_skip >> 8);
+
+  OpusStreamWriter writer;
+  result = writer.Open(out_path, stream.serial);
+  if (result == 0) {
+    result = writer.WriteHeaders(head, stream.tags);
+  }
+  for (auto i = first; result == 0 && i <= last; ++i) {
+    // the last page ends at the last sample, which trims the end.
+    auto granule = i == last ? end_granule - offset : positions[i + 1] - offset;
+    result = writer.WritePacket(stream.packets[i], granule, i == last);
+  }
+  auto close_result = writer.Close();
+  if (result == 0) {
+    result = close_result;
+  }
+  if (result != 0) {
+    std::cerr << "ogg_opus_trim failed: " << result << std::endl;
+  }
+  return result;
+}
+
+int32_t ogg_opus_concat(const char **in_paths, int32_t count, const char *out_path) {
+  if (!in_paths || count <= 0 || !out_path) {
+    return OGG_OPUS_EDIT_ERROR_ARGUMENT;
+  }
+  std::vector<OpusStream> streams(count);
+  for (int i = 0; i < count; ++i) {
+    auto result = ReadOpusStream(in_paths[i], &streams[i]);
+    if (result != 0) {
+      return result;
+    }
+    if (!HeadsMatch(streams[0].head, streams[i].head)) {
+      return OGG_OPUS_EDIT_ERROR_MISMATCH;
+    }
+  }
+
+  // the output starts at granule position 0, so the start offset of the first
+  // stream is dropped, the end trimming of the last one is kept.
+  auto &head = streams[0].head;
+  auto &last_stream = streams[count - 1];
+  auto last_stream_trim = last_stream.start_granule - last_stream.end_granule;
+  for (auto &packet : last_stream.packets) {
+    last_stream_trim += packet.samples;
+  }
+
+  OpusStreamWriter writer;
+  auto result = writer.Open(out_path, streams[0].serial);
+  if (result == 0) {
+    result = writer.WriteHeaders(head, streams[0].tags);
+  }
+  int64_t granule = 0;
+  for (int i = 0; i < count && result == 0; ++i) {
+    auto &packets = streams[i].packets;
+    for (size_t j = 0; j < packets.size() && result == 0; ++j) {
+      granule += packets[j].samples;
+      auto last = i == count - 1 && j == packets.size() - 1;
+      result = writer.WritePacket(packets[j], last ? granule - last_stream_trim : granule, last);
+    }
+  }
+  auto close_result = writer.Close();
+  if (result == 0) {
+    result = close_result;
+  }
+  if (result != 0) {
+    std::cerr << "ogg_opus_concat failed: " << result << std::endl;
+  }
+  return result;
+}
@@ -0,0 +1,52 @@
+#ifndef OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_EDIT_H_
+#define OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_EDIT_H_
+
+#include "stdint.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if _WIN32
+#define FFI_PLUGIN_EXPORT __declspec(dllexport)
+#else
+#define FFI_PLUGIN_EXPORT
+#endif
+
+#define OGG_OPUS_EDIT_ERROR_ARGUMENT (-1)
+#define OGG_OPUS_EDIT_ERROR_OPEN_INPUT (-2)
+#define OGG_OPUS_EDIT_ERROR_OPEN_OUTPUT (-3)
+#define OGG_OPUS_EDIT_ERROR_WRITE (-4)
+// the input is not an ogg opus stream, or is damaged.
+#define OGG_OPUS_EDIT_ERROR_FORMAT (-5)
+// the inputs of a concat have different channels, mapping or output gain.
+#define OGG_OPUS_EDIT_ERROR_MISMATCH (-6)
+
+// Copy the audio of `in_path` between `start` and `end` to `out_path`, both in
+// 48kHz samples from the beginning of the audio. `end` < 0 keeps everything
+// after `start`.
+//
+// The opus packets are copied as they are, nothing is decoded or re-encoded.
+// The cut is still sample accurate: whole packets are kept around the range,
+// plus 80ms before `start` for the decoder to converge, and the extra audio is
+// hidden by the pre-skip and the granule position of the last page.
+//
+// Returns 0 on success, or one of the OGG_OPUS_EDIT_ERROR_* values.
+FFI_PLUGIN_EXPORT int32_t ogg_opus_trim(const char *in_path, const char *out_path, int64_t start, int64_t end);
+
+// Join the `count` files at `in_paths` into one ogg opus stream at `out_path`,
+// without decoding. The files must have the same channel count, channel
+// mapping and output gain. The headers and tags of the first file are kept.
+//
+// The pre-skip of every file but the first and the end trimming of every file
+// but the last can not be expressed in the middle of a stream, so a few
+// milliseconds of encoder padding stay audible at each joint.
+//
+// Returns 0 on success, or one of the OGG_OPUS_EDIT_ERROR_* values.
+FFI_PLUGIN_EXPORT int32_t ogg_opus_concat(const char **in_paths, int32_t count, const char *out_path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_EDIT_H_
@@ -0,0 +1,135 @@
+#include "ogg_opus_loudness.h"
+#include "ogg_opus_loudness_meter.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "ogg/ogg.hh"
+#include "ogg/opusfile.h"
+
+#include "ogg_opus_parallel.h"
+#include "ogg_opus_pcm_cache.h"
+#include "ogg_opus_probe.h"
+#include "ogg_opus_utils.h"
+
+namespace {
+
+// The size of the page header and body of an ogg page starting with the 27
+// bytes of `header` and its segment table.
+void PageSizes(const unsigned char *header, size_t *header_size, size_t *body_size) {
+  *header_size = 27 + size_t(header[26]);
+  *body_size = 0;
+  for (int i = 0; i < header[26]; ++i) {
+    *body_size += header[27 + i];
+  }
+}
+
+}
+
+bool SetPageOutputGain(unsigned char *page, size_t length, int gain) {
+  // the first page holds the OpusHead packet alone, see RFC 7845 section 3.
+  if (length < 27 || memcmp(page, "OggS", 4) != 0 || (page[5] & 0x02) == 0 || length < 27 + size_t(page[26])) {
+    return false;
+  }
+  size_t header_size, body_size;
+  PageSizes(page, &header_size, &body_size);
+  auto *body = page + header_size;
+  if (header_size + body_size != length || body_size < 19 || memcmp(body, "OpusHead", 8) != 0) {
+    return false;
+  }
+  body[16] = uint8_t(gain & 0xff);
+  body[17] = uint8_t((gain >> 8) & 0xff);
+  ogg_page head_page;
+  head_page.header = page;
+  head_page.header_len = long(header_size);
+  head_page.body = body;
+  head_page.body_len = long(body_size);
+  ogg_page_checksum_set(&head_page);
+  return true;
+}
+
+int WriteOutputGain(const char *path, int gain) {
+  auto *file = open_file(path, "r+b");
+  if (!file) {
+    return -1;
+  }
+  std::vector<unsigned char> page(27 + 255);
+  auto ok = fread(page.data(), 1, 27, file) == 27
+      && fread(page.data() + 27, 1, page[26], file) == page[26];
+  if (ok) {
+    size_t header_size, body_size;
+    PageSizes(page.data(), &header_size, &body_size);
+    page.resize(header_size + body_size);
+    ok = fread(page.data() + header_size, 1, body_size, file) == body_size
+        && SetPageOutputGain(page.data(), page.size(), gain)
+        && fseek(file, 0, SEEK_SET) == 0
+        && fwrite(page.data(), 1, page.size(), file) == page.size();
+  }
+  ok = fclose(file) == 0 && ok;
+  // the size is unchanged and the modification time may be too, if the file
+  // was written within the same tick of the file system clock.
+  ForgetProbedFile(path);
+  PcmCache::Global().Remove(path);
+  return ok ? 0 : -1;
+}
+
+int32_t ogg_opus_normalize_loudness(const char **paths, int32_t count, double target_lufs,
+                                    double *loudness, int32_t *results) {
+  if (count <= 0 || !paths || !loudness || !results) {
+    return 0;
+  }
+
+  RunParallel(count, [&](size_t i) {
+    loudness[i] = -HUGE_VAL;
+    int error = 0;
+    auto *file = op_open_file(paths[i], &error);
+    if (!file) {
+      results[i] = error != 0 ? error : OP_EFAULT;
+      return;
+    }
+    // measure the audio as encoded, the gain in the header is replaced.
+    op_set_gain_offset(file, OP_ABSOLUTE_GAIN, 0);
+    auto channels = op_channel_count(file, -1);
+    LoudnessMeter meter(48000, channels);
+    // op_read never returns more than 120ms of audio per channel.
+    std::vector<opus_int16> pcm(size_t(5760) * channels);
+    int link = 0;
+    int read;
+    while ((read = op_read(file, pcm.data(), int(pcm.size()), &link)) != 0) {
+      if (read == OP_HOLE) {
+        continue;
+      }
+      if (read < 0) {
+        break;
+      }
+      // links of a chained file with another channel count are skipped.
+      if (op_channel_count(file, link) == channels) {
+        meter.Process(pcm.data(), read);
+      }
+    }
+    op_free(file);
+    if (read < 0) {
+      results[i] = read;
+      return;
+    }
+
+    loudness[i] = meter.IntegratedLoudness();
+    if (!std::isfinite(loudness[i])) {
+      results[i] = 0;
+      return;
+    }
+    auto gain = LoudnessToOutputGain(loudness[i], meter.Peak(), target_lufs);
+    results[i] = WriteOutputGain(paths[i], gain) == 0 ? 0 : OP_EFAULT;
+  });
+
+  int32_t succeed = 0;
+  for (int i = 0; i < count; ++i) {
+    if (results[i] == 0) {
+      succeed++;
+    }
+  }
+  return succeed;
+}
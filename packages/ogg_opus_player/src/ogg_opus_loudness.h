@@ -0,0 +1,43 @@
+#ifndef OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_LOUDNESS_H_
+#define OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_LOUDNESS_H_
+
+#include "stddef.h"
+#include "stdint.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if _WIN32
+#define FFI_PLUGIN_EXPORT __declspec(dllexport)
+#else
+#define FFI_PLUGIN_EXPORT
+#endif
+
+// Measure the EBU R128 integrated loudness of `count` ogg opus files in
+// parallel, and set the OpusHead output gain of each to bring it to
+// `target_lufs`, e.g. -23. Only the first page of a file is rewritten, the
+// audio is left untouched and decoders apply the gain.
+//
+// The loudness is measured without the gain already in the header.
+// `loudness[i]` receives the loudness of `paths[i]` in LUFS, -inf if it is too
+// short or silent, in which case the gain is not changed. `results[i]` is 0 on
+// success, negative on failure. Returns the number of files processed
+// successfully.
+FFI_PLUGIN_EXPORT int32_t ogg_opus_normalize_loudness(const char **paths, int32_t count, double target_lufs,
+                                                      double *loudness, int32_t *results);
+
+#ifdef __cplusplus
+}
+
+// Set the output gain in the OpusHead of the ogg opus file at `path`, rewriting
+// only its first page. Returns 0 on success.
+int WriteOutputGain(const char *path, int gain);
+
+// Set the output gain in `page`, the first page of an ogg opus stream which
+// holds its OpusHead, and update its checksum. Returns false if `page` is not
+// such a page.
+bool SetPageOutputGain(unsigned char *page, size_t length, int gain);
+#endif
+
+#endif //OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_LOUDNESS_H_
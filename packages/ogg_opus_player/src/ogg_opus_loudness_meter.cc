@@ -0,0 +1,130 @@
+#include "ogg_opus_loudness_meter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace {
+
+// blocks quieter than this are ignored, as silence.
+const double kAbsoluteGateLufs = -70.0;
+
+// blocks this much quieter than the ungated loudness are ignored too.
+const double kRelativeGateLu = -10.0;
+
+// never change the level more than this, in dB.
+const double kMaxGainDb = 40.0;
+
+// msvc has no M_PI unless _USE_MATH_DEFINES is set.
+const double kPi = 3.14159265358979323846;
+
+inline double PowerToLufs(double power) {
+  return -0.691 + 10.0 * std::log10(power);
+}
+
+inline double LufsToPower(double lufs) {
+  return std::pow(10.0, (lufs + 0.691) / 10.0);
+}
+
+inline double Filter(double x, double b0, double b1, double b2, double a1, double a2, double &z1, double &z2) {
+  auto y = b0 * x + z1;
+  z1 = b1 * x - a1 * y + z2;
+  z2 = b2 * x - a2 * y;
+  return y;
+}
+
+}
+
+LoudnessMeter::LoudnessMeter(int sample_rate, int channels)
+    : channels_(channels), states_(size_t(channels) * 2), step_frames_(std::max(1, sample_rate / 10)) {
+  // the K-weighting filters of BS.1770 for any sample rate, from their analog
+  // prototypes. At 48kHz they match the coefficients in the recommendation.
+  auto f0 = 1681.974450955533;
+  auto gain = 3.999843853973347;
+  auto q = 0.7071752369554196;
+  auto k = std::tan(kPi * f0 / sample_rate);
+  auto vh = std::pow(10.0, gain / 20.0);
+  auto vb = std::pow(vh, 0.4996667741545416);
+  auto a0 = 1.0 + k / q + k * k;
+  pre_filter_.b0 = (vh + vb * k / q + k * k) / a0;
+  pre_filter_.b1 = 2.0 * (k * k - vh) / a0;
+  pre_filter_.b2 = (vh - vb * k / q + k * k) / a0;
+  pre_filter_.a1 = 2.0 * (k * k - 1.0) / a0;
+  pre_filter_.a2 = (1.0 - k / q + k * k) / a0;
+
+  f0 = 38.13547087602444;
+  q = 0.5003270373238773;
+  k = std::tan(kPi * f0 / sample_rate);
+  a0 = 1.0 + k / q + k * k;
+  rlb_filter_.b0 = 1.0;
+  rlb_filter_.b1 = -2.0;
+  rlb_filter_.b2 = 1.0;
+  rlb_filter_.a1 = 2.0 * (k * k - 1.0) / a0;
+  rlb_filter_.a2 = (1.0 - k / q + k * k) / a0;
+}
+
+void LoudnessMeter::Process(const int16_t *samples, int frames) {
+  const auto &pre = pre_filter_;
+  const auto &rlb = rlb_filter_;
+  for (int i = 0; i < frames; ++i) {
+    for (int c = 0; c < channels_; ++c) {
+      int32_t sample = samples[i * channels_ + c];
+      peak_ = std::max(peak_, std::abs(sample));
+      auto &pre_state = states_[c * 2];
+      auto &rlb_state = states_[c * 2 + 1];
+      auto y = Filter(sample / 32768.0, pre.b0, pre.b1, pre.b2, pre.a1, pre.a2, pre_state.z1, pre_state.z2);
+      y = Filter(y, rlb.b0, rlb.b1, rlb.b2, rlb.a1, rlb.a2, rlb_state.z1, rlb_state.z2);
+      // the channel weights are 1 for mono and stereo.
+      step_energy_ += y * y;
+    }
+    if (++step_position_ < step_frames_) {
+      continue;
+    }
+    step_energies_[step_count_ % 4] = step_energy_;
+    step_count_++;
+    step_energy_ = 0;
+    step_position_ = 0;
+    if (step_count_ >= 4) {
+      auto energy = step_energies_[0] + step_energies_[1] + step_energies_[2] + step_energies_[3];
+      block_powers_.push_back(energy / (4.0 * step_frames_));
+    }
+  }
+}
+
+double LoudnessMeter::IntegratedLoudness() const {
+  auto absolute_gate = LufsToPower(kAbsoluteGateLufs);
+  double sum = 0;
+  size_t count = 0;
+  for (auto power : block_powers_) {
+    if (power > absolute_gate) {
+      sum += power;
+      count++;
+    }
+  }
+  if (count == 0) {
+    return -HUGE_VAL;
+  }
+  auto relative_gate = std::max(absolute_gate, sum / double(count) * std::pow(10.0, kRelativeGateLu / 10.0));
+  sum = 0;
+  count = 0;
+  for (auto power : block_powers_) {
+    if (power > relative_gate) {
+      sum += power;
+      count++;
+    }
+  }
+  return count == 0 ? -HUGE_VAL : PowerToLufs(sum / double(count));
+}
+
+int LoudnessToOutputGain(double loudness, double peak, double target) {
+  if (!std::isfinite(loudness)) {
+    return 0;
+  }
+  auto gain = target - loudness;
+  if (peak > 0) {
+    gain = std::min(gain, -1.0 - 20.0 * std::log10(peak));
+  }
+  gain = std::max(-kMaxGainDb, std::min(kMaxGainDb, gain));
+  return int(std::lround(gain * 256.0));
+}
+
@@ -0,0 +1,56 @@
+#ifndef OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_LOUDNESS_METER_H_
+#define OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_LOUDNESS_METER_H_
+
+#include <cstdint>
+#include <vector>
+
+// Integrated loudness of EBU R128 / ITU-R BS.1770-4: K-weighting, 400ms blocks
+// overlapping by 75%, absolute gate at -70 LUFS and relative gate at -10 LU.
+// Audio is fed incrementally, only the power of every block is kept.
+class LoudnessMeter {
+
+ public:
+  LoudnessMeter(int sample_rate, int channels);
+
+  // Add `frames` frames of interleaved pcm.
+  void Process(const int16_t *samples, int frames);
+
+  // Integrated loudness in LUFS of everything processed so far, or -inf if it
+  // is shorter than one block or silent.
+  double IntegratedLoudness() const;
+
+  // Max absolute sample value so far, from 0.0 to 1.0.
+  double Peak() const { return peak_ / 32768.0; }
+
+ private:
+  struct Biquad {
+    double b0, b1, b2, a1, a2;
+  };
+
+  struct FilterState {
+    double z1 = 0, z2 = 0;
+  };
+
+  int channels_;
+  Biquad pre_filter_{};
+  Biquad rlb_filter_{};
+  // two filter stages for each channel.
+  std::vector<FilterState> states_;
+
+  // 100ms, a quarter of a block.
+  int step_frames_;
+  int step_position_ = 0;
+  double step_energy_ = 0;
+  double step_energies_[4] = {0, 0, 0, 0};
+  int64_t step_count_ = 0;
+
+  std::vector<double> block_powers_;
+  int32_t peak_ = 0;
+
+};
+
+// The OpusHead output gain, in Q7.8 dB, which brings audio measured at
+// `loudness` LUFS to `target` LUFS, without pushing `peak` above -1 dBFS.
+int LoudnessToOutputGain(double loudness, double peak, double target);
+
+#endif //OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_LOUDNESS_METER_H_
@@ -0,0 +1,46 @@
+#ifndef OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_PARALLEL_H_
+#define OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_PARALLEL_H_
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
+
+// Run task(0) ... task(task_count - 1) on a pool of worker threads.
+// Workers pull task indices from a shared counter, so long tasks do not
+// stall the others. Returns after every task has finished.
+inline void RunParallel(size_t task_count, const std::function<void(size_t)> &task) {
+  if (task_count == 0) {
+    return;
+  }
+  size_t worker_count = std::max(1u, std::thread::hardware_concurrency());
+  worker_count = std::min(worker_count, task_count);
+  if (worker_count == 1) {
+    for (size_t i = 0; i < task_count; ++i) {
+      task(i);
+    }
+    return;
+  }
+
+  std::atomic<size_t> next_task(0);
+  auto worker = [&]() {
+    size_t index;
+    while ((index = next_task.fetch_add(1)) < task_count) {
+      task(index);
+    }
+  };
+
+  std::vector<std::thread> workers;
+  workers.reserve(worker_count - 1);
+  for (size_t i = 0; i + 1 < worker_count; ++i) {
+    workers.emplace_back(worker);
+  }
+  // the calling thread takes part in the work as well.
+  worker();
+  for (auto &thread : workers) {
+    thread.join();
+  }
+}
+
+#endif //OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_PARALLEL_H_
@@ -0,0 +1,90 @@
+#include "ogg_opus_pcm_cache.h"
+
+namespace {
+
+// about 5 minutes of mono voice messages.
+const size_t kDefaultBudgetBytes = 32 * 1024 * 1024;
+
+size_t PcmBytes(const DecodedPcm &pcm) {
+  return pcm.samples.size() * sizeof(int16_t);
+}
+
+}
+
+PcmCache::PcmCache(size_t budget_bytes) : budget_bytes_(budget_bytes) {}
+
+PcmCache &PcmCache::Global() {
+  static PcmCache cache(kDefaultBudgetBytes);
+  return cache;
+}
+
+std::shared_ptr<const DecodedPcm> PcmCache::Lookup(const std::string &path, int64_t mtime, int64_t size) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(path);
+  if (it == entries_.end()) {
+    return nullptr;
+  }
+  if (it->second.mtime != mtime || it->second.size != size) {
+    // the file changed, the pcm is stale.
+    used_bytes_ -= PcmBytes(*it->second.pcm);
+    entries_.erase(it);
+    return nullptr;
+  }
+  it->second.last_used = ++clock_;
+  return it->second.pcm;
+}
+
+void PcmCache::Insert(const std::string &path, int64_t mtime, int64_t size, std::shared_ptr<const DecodedPcm> pcm) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto bytes = PcmBytes(*pcm);
+  if (bytes > budget_bytes_) {
+    return;
+  }
+  auto it = entries_.find(path);
+  if (it != entries_.end()) {
+    used_bytes_ -= PcmBytes(*it->second.pcm);
+    entries_.erase(it);
+  }
+  Evict(budget_bytes_ - bytes);
+  entries_[path] = Entry{mtime, size, ++clock_, std::move(pcm)};
+  used_bytes_ += bytes;
+}
+
+void PcmCache::Remove(const std::string &path) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(path);
+  if (it != entries_.end()) {
+    used_bytes_ -= PcmBytes(*it->second.pcm);
+    entries_.erase(it);
+  }
+}
+
+void PcmCache::SetBudget(size_t budget_bytes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  budget_bytes_ = budget_bytes;
+  Evict(budget_bytes);
+}
+
+size_t PcmCache::Budget() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return budget_bytes_;
+}
+
+size_t PcmCache::UsedBytes() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return used_bytes_;
+}
+
+void PcmCache::Evict(size_t budget_bytes) {
+  // a handful of entries at most, a linear scan is cheaper than keeping a list.
+  while (used_bytes_ > budget_bytes && !entries_.empty()) {
+    auto oldest = entries_.begin();
+    for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+      if (it->second.last_used < oldest->second.last_used) {
+        oldest = it;
+      }
+    }
+    used_bytes_ -= PcmBytes(*oldest->second.pcm);
+    entries_.erase(oldest);
+  }
+}
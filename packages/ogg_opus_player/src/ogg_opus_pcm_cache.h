@@ -0,0 +1,65 @@
+#ifndef OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_PCM_CACHE_H_
+#define OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_PCM_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Decoded 48kHz pcm of a whole file.
+struct DecodedPcm {
+  int channels;
+  int bitrate;
+  // interleaved samples.
+  std::vector<int16_t> samples;
+};
+
+// Least recently used cache of decoded files, keyed by path, modification time
+// in nanoseconds and size. The memory of the cached samples is kept under a byte budget.
+// Entries are shared, evicting one never frees pcm which is still being read.
+class PcmCache {
+
+ public:
+  explicit PcmCache(size_t budget_bytes);
+
+  // The process wide cache used by OggOpusReader.
+  static PcmCache &Global();
+
+  std::shared_ptr<const DecodedPcm> Lookup(const std::string &path, int64_t mtime, int64_t size);
+
+  // Files larger than the whole budget are not cached.
+  void Insert(const std::string &path, int64_t mtime, int64_t size, std::shared_ptr<const DecodedPcm> pcm);
+
+  // Drops the entry of `path`, for files rewritten in place.
+  void Remove(const std::string &path);
+
+  // Evicts the least recently used entries until the cache fits the budget.
+  // 0 disables the cache.
+  void SetBudget(size_t budget_bytes);
+
+  size_t Budget();
+
+  size_t UsedBytes();
+
+ private:
+  struct Entry {
+    int64_t mtime;
+    int64_t size;
+    uint64_t last_used;
+    std::shared_ptr<const DecodedPcm> pcm;
+  };
+
+  std::mutex mutex_;
+  std::unordered_map<std::string, Entry> entries_;
+  size_t budget_bytes_;
+  size_t used_bytes_ = 0;
+  uint64_t clock_ = 0;
+
+  void Evict(size_t budget_bytes);
+
+};
+
+#endif //OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_PCM_CACHE_H_
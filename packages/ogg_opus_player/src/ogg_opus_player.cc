@@ -1,9 +1,13 @@
 #include "ogg_opus_player.h"
 
+#include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <memory>
 #include <chrono>
 #include <cstring>
+#include <thread>
+#include <vector>
 
 #include "ogg/opus.h"
 #include "ogg/opusfile.h"
@@ -11,6 +15,12 @@
 #include "dart_api_dl.h"
 #include "SDL.h"
 
+#include "ogg_opus_analyzer.h"
+#include "ogg_opus_callback_timer.h"
+#include "ogg_opus_pcm_cache.h"
+#include "ogg_opus_reader.h"
+#include "ogg_opus_resampler.h"
+#include "ogg_opus_ring_buffer.h"
 #include "ogg_opus_utils.h"
 #include "sonic.h"
 
@@ -18,73 +28,6 @@
 
 namespace {
 
-class OggOpusReader {
-
- private:
-  const char *file_path_;
-  OggOpusFile *opus_file_;
-
-  bool ended_ = false;
-
- public:
-
-  explicit OggOpusReader(const char *file_path);
-
-  ~OggOpusReader();
-
-  int ReadPcmData(opus_int16 *data, int length);
-
-  int GetChannelCount() const;
-
-};
-
-OggOpusReader::OggOpusReader(const char *file_path) : file_path_(file_path), opus_file_(nullptr) {
-  int result;
-  auto opus_file = op_open_file(file_path, &result);
-  if (result == 0 && opus_file) {
-    opus_file_ = opus_file;
-  } else {
-    std::cerr << "open opus file failed" << result << std::endl;
-  }
-}
-
-OggOpusReader::~OggOpusReader() {
-  if (opus_file_) {
-    op_free(opus_file_);
-  }
-}
-int OggOpusReader::ReadPcmData(opus_int16 *data, int length) {
-  if (!opus_file_) {
-    return 0;
-  }
-  auto read = 0;
-
-  auto result = 1;
-  while ((result == OP_HOLE || result > 0) && read < length) {
-    result = op_read(opus_file_, data + read,
-                     length - read, nullptr);
-    if (result >= 0) {
-      read += result;
-    }
-  }
-
-  if (result < 0) {
-    return 0;
-  }
-
-  if (result == 0) {
-    ended_ = true;
-  }
-
-  return read;
-}
-int OggOpusReader::GetChannelCount() const {
-  if (!opus_file_) {
-    return 1;
-  }
-  return op_channel_count(opus_file_, -1);
-}
-
 class Player {
  public:
   virtual void Play() = 0;
@@ -95,18 +38,53 @@ class Player {
   virtual double CurrentTime() = 0;
 
   virtual void SetPlaybackRate(double rate) = 0;
+
+  virtual void SetPositionInterval(int32_t interval_ms) = 0;
+
+  virtual double OutputLatency() = 0;
+
+  virtual void SetAnalysis(int32_t interval_ms, int32_t bands) = 0;
 };
 
 Player::~Player() = default;
 
+struct OutputProfile {
+  // frames of one device period.
+  int device_samples;
+  // frames decoded at a time on the audio thread.
+  int decode_frames;
+  // device periods decoded before the first callback.
+  int prefill_periods;
+};
+
+// indexed by OGG_OPUS_PLAYER_PROFILE_*.
+const OutputProfile kOutputProfiles[] = {
+    {1024, 500, 0},
+    // 5ms periods, the first two ready before play.
+    {256, 240, 2},
+    // 170ms periods filled from 200ms decode bursts, the audio thread wakes up
+    // about 6 times a second.
+    {8192, 9600, 0},
+};
+
 enum DartPortMessage {
-  PLAYER_REACH_ENDED = 0
+  // [PLAYER_STATE, one of OGG_OPUS_PLAYER_STATE_*]
+  PLAYER_STATE = 0,
+  // [PLAYER_POSITION, position in seconds]
+  PLAYER_POSITION = 1,
+  // [PLAYER_ANALYSIS, Float32List of the rms level, the peak level and the
+  //  spectrum bands]
+  PLAYER_ANALYSIS = 2
 };
 
+// the analysis thread posts zero levels after the device got no audio for this
+// long plus one period, when paused or ended.
+const int kAnalysisIdleMs = 100;
+
 class SdlOggOpusPlayer : public Player {
 
  public:
-  SdlOggOpusPlayer(const char *file_path, Dart_Port_DL send_port);
+  SdlOggOpusPlayer(const char *file_path, Dart_Port_DL send_port, int profile);
   ~SdlOggOpusPlayer() override;
 
   void Play() override;
@@ -115,11 +93,20 @@ class SdlOggOpusPlayer : public Player {
 
   void SetPlaybackRate(double rate) override;
 
+  void SetPositionInterval(int32_t interval_ms) override { position_interval_ms_ = interval_ms; }
+
+  double OutputLatency() override { return output_latency_; }
+
+  void SetAnalysis(int32_t interval_ms, int32_t bands) override;
+
  private:
   std::unique_ptr<OggOpusReader> reader_;
 
   SDL_AudioDeviceID audio_device_id_ = -1;
 
+  const OutputProfile &profile_;
+
+  // position in the file of the end of the audio given to the device.
   double current_time_ = 0;
 
   int64_t last_update_time_ = 0;
@@ -128,73 +115,246 @@ class SdlOggOpusPlayer : public Player {
 
   Dart_Port_DL dart_port_dl_;
 
+  // the last state posted to dart, the audio thread changes it too.
+  std::atomic<int> state_{-1};
+
+  std::atomic<int32_t> position_interval_ms_{0};
+  // frames played since the last position was posted, on the audio thread.
+  int64_t position_frames_ = 0;
+
+  int sample_rate_ = 48000;
+  int channels_ = 1;
+
   sonicStream sonic_stream_;
 
+  // converts the decoded 48kHz pcm to the rate and channels of the device,
+  // null if the device plays it as is.
+  OggOpusResampler *resampler_ = nullptr;
+  std::vector<opus_int16> decode_buffer_;
+  std::vector<int16_t> convert_buffer_;
+  // decoded before play, counted in the position by the first callback.
+  int prefilled_frames_ = 0;
+
+  // seconds from a callback until its last sample is heard. Measured on the
+  // audio thread as the audio given to the device ahead of the wall clock
+  // since playing started.
+  std::atomic<double> output_latency_{0};
+  std::atomic<bool> restart_latency_{true};
+  std::chrono::steady_clock::time_point latency_start_;
+  int64_t latency_frames_ = 0;
+  // seconds of one device period.
+  double device_period_ = 0;
+
+  // the analysis tap. The callback only copies the audio it plays into
+  // analysis_ring_, which is null while the tap is disabled, and the analysis
+  // thread posts its levels as the audio is heard. The ring is only replaced
+  // with the device locked.
+  std::unique_ptr<SpscRingBuffer<int16_t>> analysis_ring_;
+  std::unique_ptr<PlaybackAnalyzer> analyzer_;
+  SDL_sem *analysis_signal_ = nullptr;
+  std::thread analysis_thread_;
+  std::atomic<bool> analysis_running_{false};
+  int32_t analysis_interval_ms_ = 0;
+
   int Initialize();
 
+  // Decode and convert up to `frames` of pcm into sonic. Returns the decoded
+  // 48kHz frames, 0 at the end of the file.
+  int Decode(int frames);
+
+  // Count `frames` given to the device by the callback which started at `time`.
+  void MeasureLatency(std::chrono::steady_clock::time_point time, int frames);
+
+  // The position heard at the time `elapsed` seconds after the last callback.
+  double AudiblePosition(double elapsed);
+
+  void SetState(int state);
+
+  void PostPosition(double position);
+
   void ReadAudioData(uint16_t *stream, int len);
 
+  void StopAnalysis();
+
+  void AnalysisLoop(SpscRingBuffer<int16_t> *ring);
+
+  void PostAnalysis(std::vector<float> &levels);
+
 };
 
-SdlOggOpusPlayer::SdlOggOpusPlayer(const char *file_path, Dart_Port_DL send_port)
+SdlOggOpusPlayer::SdlOggOpusPlayer(const char *file_path, Dart_Port_DL send_port, int profile)
     : reader_(std::make_unique<OggOpusReader>(file_path)),
+      profile_(kOutputProfiles[profile]),
       dart_port_dl_(send_port),
       sonic_stream_(nullptr) {
 #ifdef _OPUS_OGG_PLAYER_LOG
   std::cout << "SdlOggOpusPlayer: " << file_path << " port: " << send_port << std::endl;
 #endif
-  Initialize();
+  if (!reader_->IsOpen() || Initialize() != 0) {
+    SetState(OGG_OPUS_PLAYER_STATE_ERROR);
+  }
+}
+
+void SdlOggOpusPlayer::SetState(int state) {
+  if (state_.exchange(state) != state) {
+    Dart_CObject type;
+    type.type = Dart_CObject_kInt32;
+    type.value.as_int32 = PLAYER_STATE;
+    Dart_CObject value;
+    value.type = Dart_CObject_kInt32;
+    value.value.as_int32 = state;
+    Dart_CObject *values[] = {&type, &value};
+    Dart_CObject message;
+    message.type = Dart_CObject_kArray;
+    message.value.as_array.length = 2;
+    message.value.as_array.values = values;
+    Dart_PostCObject_DL(dart_port_dl_, &message);
+  }
+}
+
+void SdlOggOpusPlayer::PostPosition(double position) {
+  if (position_interval_ms_.load(std::memory_order_relaxed) <= 0) {
+    return;
+  }
+  Dart_CObject type;
+  type.type = Dart_CObject_kInt32;
+  type.value.as_int32 = PLAYER_POSITION;
+  Dart_CObject value;
+  value.type = Dart_CObject_kDouble;
+  value.value.as_double = position;
+  Dart_CObject *values[] = {&type, &value};
+  Dart_CObject message;
+  message.type = Dart_CObject_kArray;
+  message.value.as_array.length = 2;
+  message.value.as_array.values = values;
+  Dart_PostCObject_DL(dart_port_dl_, &message);
 }
 
 void SdlOggOpusPlayer::Play() {
   if (audio_device_id_ > 0) {
     paused_ = false;
+    restart_latency_ = true;
+    // playing once the audio thread delivers the first samples.
+    SetState(OGG_OPUS_PLAYER_STATE_BUFFERING);
     SDL_PauseAudioDevice(audio_device_id_, 0);
   }
 }
+
 void SdlOggOpusPlayer::Pause() {
   if (audio_device_id_ > 0) {
     SDL_PauseAudioDevice(audio_device_id_, 1);
     paused_ = true;
-    auto offset = std::chrono::system_clock::now().time_since_epoch().count() - last_update_time_;
-    current_time_ += double(offset) / 1000000000.0;
+    // the audio given to the device still plays out, playing resumes after it.
     last_update_time_ = 0;
+    // an ended player is paused by dart, it stays ended.
+    auto state = state_.load();
+    if (state == OGG_OPUS_PLAYER_STATE_BUFFERING || state == OGG_OPUS_PLAYER_STATE_PLAYING) {
+      SetState(OGG_OPUS_PLAYER_STATE_PAUSED);
+      PostPosition(current_time_);
+    }
   }
 }
 
 void SdlOggOpusPlayer::ReadAudioData(uint16_t *stream, int len) {
+  // sonic counts frames, `len` counts the samples of every channel.
+  auto frames = len / channels_;
+  AudioCallbackTimer timer(false, frames, sample_rate_);
+  auto callback_time = std::chrono::steady_clock::now();
   if (!sonic_stream_) {
     memset(stream, 0, len * sizeof(uint16_t));
     return;
   }
 
   auto read = 0;
-  auto pcm_read = 0;
-  while (read < len) {
+  auto pcm_read = prefilled_frames_;
+  prefilled_frames_ = 0;
+  while (read < frames) {
     auto result = sonicReadShortFromStream(
-        sonic_stream_, reinterpret_cast<short *>(stream + read),
-        len - read
+        sonic_stream_, reinterpret_cast<short *>(stream + read * channels_),
+        frames - read
     );
     if (result > 0) {
       read += result;
     } else if (result == 0) {
-      auto buffer = static_cast<opus_int16 *>(malloc(len * sizeof(opus_int16)));
-      auto data = reader_->ReadPcmData(buffer, 500);
-      if (data > 0) {
-        sonicWriteShortToStream(sonic_stream_, buffer, data);
-        pcm_read += data;
-      } else {
+      auto data = Decode(profile_.decode_frames);
+      if (data <= 0) {
         break;
       }
-      free(buffer);
+      pcm_read += data;
+    }
+  }
+  if (read < frames) {
+    memset(stream + read * channels_, 0, (len - read * channels_) * sizeof(uint16_t));
+    if (!reader_->IsEnded()) {
+      timer.SetMissing(frames - read);
     }
   }
 
+  if (analysis_ring_ && read > 0) {
+    // whole frames only, the ring may be nearly full.
+    auto space = (analysis_ring_->Capacity() - analysis_ring_->Size()) / channels_;
+    analysis_ring_->Write(reinterpret_cast<int16_t *>(stream), std::min(size_t(read), space) * channels_);
+    SDL_SemPost(analysis_signal_);
+  }
+
   current_time_ = current_time_ + pcm_read / 48000.0;
   last_update_time_ = std::chrono::system_clock::now().time_since_epoch().count();
+  MeasureLatency(callback_time, frames);
   if (read <= 0) {
-    Dart_PostInteger_DL(dart_port_dl_, PLAYER_REACH_ENDED);
+    if (state_.load() != OGG_OPUS_PLAYER_STATE_ENDED) {
+      PostPosition(current_time_);
+      SetState(OGG_OPUS_PLAYER_STATE_ENDED);
+    }
+    return;
+  }
+  if (state_.load() == OGG_OPUS_PLAYER_STATE_BUFFERING) {
+    SetState(OGG_OPUS_PLAYER_STATE_PLAYING);
+  }
+
+  auto interval_ms = position_interval_ms_.load(std::memory_order_relaxed);
+  position_frames_ += read;
+  if (interval_ms > 0 && position_frames_ * 1000 >= int64_t(interval_ms) * sample_rate_) {
+    position_frames_ = 0;
+    PostPosition(AudiblePosition(0));
+  }
+}
+
+int SdlOggOpusPlayer::Decode(int frames) {
+  auto data = reader_->ReadPcmData(decode_buffer_.data(), frames);
+  if (data <= 0) {
+    return 0;
+  }
+  if (resampler_) {
+    auto converted = ogg_opus_resampler_process(resampler_, decode_buffer_.data(), data, convert_buffer_.data());
+    sonicWriteShortToStream(sonic_stream_, convert_buffer_.data(), converted);
+  } else {
+    sonicWriteShortToStream(sonic_stream_, decode_buffer_.data(), data);
+  }
+  return data;
+}
+
+void SdlOggOpusPlayer::MeasureLatency(std::chrono::steady_clock::time_point now, int frames) {
+  auto period = double(frames) / sample_rate_;
+  if (restart_latency_.exchange(false)) {
+    latency_start_ = now;
+    latency_frames_ = 0;
+  }
+  latency_frames_ += frames;
+  std::chrono::duration<double> elapsed = now - latency_start_;
+  auto ahead = double(latency_frames_) / sample_rate_ - elapsed.count();
+  if (ahead < period) {
+    // the device ran dry, or its clock drifted, measure from here again.
+    latency_start_ = now;
+    latency_frames_ = frames;
+    ahead = period;
   }
+  output_latency_ = ahead;
+}
+
+double SdlOggOpusPlayer::AudiblePosition(double elapsed) {
+  auto speed = sonic_stream_ ? sonicGetSpeed(sonic_stream_) : 1.0f;
+  auto unheard = std::max(0.0, output_latency_ - elapsed);
+  return std::max(0.0, current_time_ - unheard * speed);
 }
 
 bool global_init = false;
@@ -203,10 +363,11 @@ int SdlOggOpusPlayer::Initialize() {
   global_init_sdl2();
 
   SDL_AudioSpec wanted_spec, spec;
+  auto file_channels = reader_->GetChannelCount();
   wanted_spec.silence = 0;
   wanted_spec.format = AUDIO_S16SYS;
-  wanted_spec.channels = reader_->GetChannelCount();
-  wanted_spec.samples = 1024;
+  wanted_spec.channels = file_channels;
+  wanted_spec.samples = Uint16(profile_.device_samples);
   wanted_spec.freq = 48000;
   wanted_spec.callback = [](void *userdata, Uint8 *stream, int len) {
     auto *player = static_cast<SdlOggOpusPlayer *>(userdata);
@@ -215,15 +376,40 @@ int SdlOggOpusPlayer::Initialize() {
   };
   wanted_spec.userdata = this;
 
+  // open the device at its native rate and channels, converted here instead
+  // of by another resampling layer of sdl or the sound server.
   audio_device_id_ = SDL_OpenAudioDevice(nullptr, 0,
                                          &wanted_spec, &spec,
-                                         0);
+                                         SDL_AUDIO_ALLOW_FREQUENCY_CHANGE | SDL_AUDIO_ALLOW_CHANNELS_CHANGE);
   if (audio_device_id_ <= 0) {
     std::cout << "SDL_OpenAudioDevice failed: " << SDL_GetError() << std::endl;
     return -1;
   }
 
   sonic_stream_ = sonicCreateStream(spec.freq, spec.channels);
+  sample_rate_ = spec.freq;
+  channels_ = spec.channels;
+
+  decode_buffer_.resize(size_t(profile_.decode_frames) * file_channels);
+  if (spec.freq != 48000 || spec.channels != file_channels) {
+    resampler_ = ogg_opus_resampler_create(48000, file_channels, spec.freq, spec.channels);
+    if (!resampler_) {
+      return -1;
+    }
+    convert_buffer_.resize(size_t(ogg_opus_resampler_max_output(resampler_, profile_.decode_frames)) * spec.channels);
+  }
+  // until the first callback measures it.
+  device_period_ = double(spec.samples) / spec.freq;
+  output_latency_ = device_period_;
+
+  auto prefill = profile_.prefill_periods * int(spec.samples);
+  while (sonicSamplesAvailable(sonic_stream_) < prefill) {
+    auto data = Decode(profile_.decode_frames);
+    if (data <= 0) {
+      break;
+    }
+    prefilled_frames_ += data;
+  }
 
   if (spec.format != AUDIO_S16SYS) {
     std::cout << "SDL_OpenAudioDevice failed: spec format" << std::endl;
@@ -243,12 +429,17 @@ int SdlOggOpusPlayer::Initialize() {
 }
 
 SdlOggOpusPlayer::~SdlOggOpusPlayer() {
+  StopAnalysis();
+  if (analysis_signal_) {
+    SDL_DestroySemaphore(analysis_signal_);
+  }
   if (audio_device_id_ > 0) {
     SDL_CloseAudioDevice(audio_device_id_);
   }
   if (sonic_stream_) {
     sonicDestroyStream(sonic_stream_);
   }
+  ogg_opus_resampler_destroy(resampler_);
 }
 
 double SdlOggOpusPlayer::CurrentTime() {
@@ -256,8 +447,7 @@ double SdlOggOpusPlayer::CurrentTime() {
     return current_time_;
   }
   auto time = std::chrono::system_clock::now().time_since_epoch().count() - last_update_time_;
-  auto speed = sonic_stream_ ? sonicGetSpeed(sonic_stream_) : 1.0f;
-  return current_time_ + ((double) time / 1000000000.0) * speed;
+  return AudiblePosition((double) time / 1000000000.0);
 }
 
 void SdlOggOpusPlayer::SetPlaybackRate(double rate) {
@@ -266,6 +456,119 @@ void SdlOggOpusPlayer::SetPlaybackRate(double rate) {
   }
 }
 
+void SdlOggOpusPlayer::SetAnalysis(int32_t interval_ms, int32_t bands) {
+  if (audio_device_id_ <= 0) {
+    return;
+  }
+  StopAnalysis();
+  if (interval_ms <= 0) {
+    return;
+  }
+  if (!analysis_signal_) {
+    analysis_signal_ = SDL_CreateSemaphore(0);
+  }
+  analyzer_ = std::make_unique<PlaybackAnalyzer>(sample_rate_, channels_, bands);
+  analysis_interval_ms_ = interval_ms;
+  // a second of audio, more than any device period.
+  auto ring = std::make_unique<SpscRingBuffer<int16_t>>(size_t(sample_rate_) * channels_);
+  analysis_running_ = true;
+  analysis_thread_ = std::thread(&SdlOggOpusPlayer::AnalysisLoop, this, ring.get());
+  SDL_LockAudioDevice(audio_device_id_);
+  analysis_ring_ = std::move(ring);
+  SDL_UnlockAudioDevice(audio_device_id_);
+}
+
+void SdlOggOpusPlayer::StopAnalysis() {
+  if (!analysis_thread_.joinable()) {
+    return;
+  }
+  // the callback can not write to the ring anymore once it is taken.
+  SDL_LockAudioDevice(audio_device_id_);
+  auto ring = std::move(analysis_ring_);
+  SDL_UnlockAudioDevice(audio_device_id_);
+  analysis_running_ = false;
+  SDL_SemPost(analysis_signal_);
+  analysis_thread_.join();
+  analyzer_ = nullptr;
+}
+
+void SdlOggOpusPlayer::AnalysisLoop(SpscRingBuffer<int16_t> *ring) {
+  using namespace std::chrono;
+  auto interval = milliseconds(analysis_interval_ms_);
+  auto interval_frames = std::max<int64_t>(1, int64_t(analysis_interval_ms_) * sample_rate_ / 1000);
+  auto idle_after = milliseconds(kAnalysisIdleMs) + duration<double>(device_period_);
+  std::vector<int16_t> buffer(size_t(interval_frames) * channels_);
+  std::vector<float> levels(2 + analyzer_->Bands());
+
+  // the audio is analyzed one interval at a time, as it is heard rather than
+  // as the callback hands it to the device, so that posts stay at the display
+  // rate even with long device periods.
+  auto idle = true;
+  steady_clock::time_point next_post;
+  steady_clock::time_point last_audio;
+  while (analysis_running_) {
+    auto now = steady_clock::now();
+    if (idle) {
+      if (ring->Size() == 0) {
+        SDL_SemWaitTimeout(analysis_signal_, kAnalysisIdleMs);
+        continue;
+      }
+      // the callback runs one period before its first sample is heard.
+      idle = false;
+      auto delay = std::max(0.0, output_latency_.load() - device_period_);
+      next_post = now + duration_cast<steady_clock::duration>(duration<double>(delay));
+      last_audio = now;
+    }
+    if (now < next_post) {
+      auto wait = duration_cast<milliseconds>(next_post - now).count() + 1;
+      SDL_SemWaitTimeout(analysis_signal_, Uint32(wait));
+      continue;
+    }
+
+    while (analyzer_->PendingFrames() < interval_frames) {
+      auto wanted = size_t(interval_frames - analyzer_->PendingFrames()) * channels_;
+      auto read = ring->Read(buffer.data(), wanted);
+      if (read == 0) {
+        break;
+      }
+      analyzer_->Process(buffer.data(), int(read / channels_));
+    }
+    if (analyzer_->PendingFrames() > 0) {
+      analyzer_->Take(levels.data());
+      PostAnalysis(levels);
+      last_audio = now;
+    } else if (now - last_audio > idle_after) {
+      // paused or ended, the levels fall back to silence.
+      std::fill(levels.begin(), levels.end(), 0.0f);
+      PostAnalysis(levels);
+      idle = true;
+      continue;
+    }
+    next_post += interval;
+    if (next_post < now) {
+      // woke up late, do not post the missed intervals in a burst.
+      next_post = now + interval;
+    }
+  }
+}
+
+void SdlOggOpusPlayer::PostAnalysis(std::vector<float> &levels) {
+  Dart_CObject type;
+  type.type = Dart_CObject_kInt32;
+  type.value.as_int32 = PLAYER_ANALYSIS;
+  Dart_CObject value;
+  value.type = Dart_CObject_kTypedData;
+  value.value.as_typed_data.type = Dart_TypedData_kFloat32;
+  value.value.as_typed_data.length = intptr_t(levels.size());
+  value.value.as_typed_data.values = reinterpret_cast<uint8_t *>(levels.data());
+  Dart_CObject *values[] = {&type, &value};
+  Dart_CObject message;
+  message.type = Dart_CObject_kArray;
+  message.value.as_array.length = 2;
+  message.value.as_array.values = values;
+  Dart_PostCObject_DL(dart_port_dl_, &message);
+}
+
 }
 
 void global_init_sdl2() {
@@ -276,7 +579,14 @@ void global_init_sdl2() {
 }
 
 void *ogg_opus_player_create(const char *file_path, Dart_Port_DL send_port) {
-  auto *player = new SdlOggOpusPlayer(file_path, send_port);
+  return ogg_opus_player_create_with_profile(file_path, send_port, OGG_OPUS_PLAYER_PROFILE_DEFAULT);
+}
+
+void *ogg_opus_player_create_with_profile(const char *file_path, Dart_Port_DL send_port, int32_t profile) {
+  if (profile < OGG_OPUS_PLAYER_PROFILE_DEFAULT || profile > OGG_OPUS_PLAYER_PROFILE_POWER_SAVING) {
+    profile = OGG_OPUS_PLAYER_PROFILE_DEFAULT;
+  }
+  auto *player = new SdlOggOpusPlayer(file_path, send_port, profile);
   return player;
 }
 
@@ -308,3 +618,22 @@ void ogg_opus_player_set_playback_rate(void *player, double rate) {
   auto *p = static_cast<Player *>(player);
   p->SetPlaybackRate(rate);
 }
+
+void ogg_opus_player_set_position_interval(void *player, int32_t interval_ms) {
+  auto *p = static_cast<Player *>(player);
+  p->SetPositionInterval(interval_ms);
+}
+
+double ogg_opus_player_get_output_latency(void *player) {
+  auto *p = static_cast<Player *>(player);
+  return p->OutputLatency();
+}
+
+void ogg_opus_player_set_analysis(void *player, int32_t interval_ms, int32_t bands) {
+  auto *p = static_cast<Player *>(player);
+  p->SetAnalysis(interval_ms, bands);
+}
+
+void ogg_opus_player_set_pcm_cache_budget(int64_t bytes) {
+  PcmCache::Global().SetBudget(bytes > 0 ? size_t(bytes) : 0);
+}
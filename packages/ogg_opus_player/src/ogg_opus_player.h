@@ -17,8 +17,33 @@ extern "C" {
 #define FFI_PLUGIN_EXPORT
 #endif
 
+// States posted to the send_port of ogg_opus_player_create, as a list of
+// [0, state], whenever the state changes.
+#define OGG_OPUS_PLAYER_STATE_BUFFERING 0
+#define OGG_OPUS_PLAYER_STATE_PLAYING 1
+#define OGG_OPUS_PLAYER_STATE_PAUSED 2
+#define OGG_OPUS_PLAYER_STATE_ENDED 3
+#define OGG_OPUS_PLAYER_STATE_ERROR 4
+
+// Output profiles of ogg_opus_player_create_with_profile.
+//
+// The default profile plays 21ms device periods. The low latency profile plays
+// 5ms periods and decodes the first two before play, for short ui sounds. The
+// power saving profile plays 170ms periods filled from big decode bursts, so
+// that the cpu sleeps between wakeups while long messages play.
+#define OGG_OPUS_PLAYER_PROFILE_DEFAULT 0
+#define OGG_OPUS_PLAYER_PROFILE_LOW_LATENCY 1
+#define OGG_OPUS_PLAYER_PROFILE_POWER_SAVING 2
+
+// Create a player of `file_path`. It posts its state changes to `send_port`,
+// playing starts in buffering until the first audio reaches the device. A
+// player which can not open the file or the device posts the error state.
 FFI_PLUGIN_EXPORT void *ogg_opus_player_create(const char *file_path, int64_t send_port);
 
+// ogg_opus_player_create with one of OGG_OPUS_PLAYER_PROFILE_*.
+FFI_PLUGIN_EXPORT void *ogg_opus_player_create_with_profile(const char *file_path, int64_t send_port,
+                                                            int32_t profile);
+
 FFI_PLUGIN_EXPORT void ogg_opus_player_pause(void *player);
 
 FFI_PLUGIN_EXPORT void ogg_opus_player_play(void *player);
@@ -29,6 +54,31 @@ FFI_PLUGIN_EXPORT double ogg_opus_player_get_current_time(void *player);
 
 FFI_PLUGIN_EXPORT void ogg_opus_player_set_playback_rate(void *player, double rate);
 
+// Post the playing position to the send_port of ogg_opus_player_create every
+// `interval_ms` milliseconds of played audio, from the audio thread, as a list
+// of [1, position in seconds]. The position is also posted when paused or
+// ended. 0 (the default) disables it.
+FFI_PLUGIN_EXPORT void ogg_opus_player_set_position_interval(void *player, int32_t interval_ms);
+
+// Seconds from the time audio is handed to the device until it is heard, as
+// measured while playing, or one device period before that. Positions are
+// reported as heard, behind the decoded audio by this latency.
+FFI_PLUGIN_EXPORT double ogg_opus_player_get_output_latency(void *player);
+
+// Analyze the played audio on a thread of its own, and post it to the
+// send_port of ogg_opus_player_create every `interval_ms` milliseconds while
+// it is heard, as a list of [2, Float32List of the rms level, the peak level
+// and `bands` spectrum levels], all from 0.0 to 1.0. Up to 64 logarithmic
+// bands from 100Hz to 16kHz, 0 for levels only. Zero levels are posted once
+// after playback pauses or ends. An `interval_ms` of 0 (the default) disables
+// it, the audio thread then does no work for it.
+FFI_PLUGIN_EXPORT void ogg_opus_player_set_analysis(void *player, int32_t interval_ms, int32_t bands);
+
+// Limit the memory of decoded pcm kept for replaying files shorter than 60
+// seconds without decoding them again, 32MB by default. Least recently played
+// files are dropped first, 0 disables the cache.
+FFI_PLUGIN_EXPORT void ogg_opus_player_set_pcm_cache_budget(int64_t bytes);
+
 FFI_PLUGIN_EXPORT void ogg_opus_player_initialize_dart(void *native_port);
 
 #ifdef __cplusplus
@@ -0,0 +1,398 @@
+#include "ogg_opus_probe.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ogg/ogg.hh"
+#include "ogg/opus.h"
+#include "ogg/opusfile.h"
+
+#include "ogg_opus_parallel.h"
+#include "ogg_opus_utils.h"
+
+namespace {
+
+const uint32_t kCacheMagic = 0x4350504f; // "OPPC"
+// 2: modification times in nanoseconds.
+const uint32_t kCacheVersion = 2;
+const size_t kMaxCacheEntries = 4096;
+
+// the end of the file read for its last page, doubled until one is found. Ogg
+// pages are at most 65307 bytes.
+const int64_t kTailChunkSize = 65536;
+
+bool SeekFile(FILE *file, int64_t offset) {
+#if _WIN32
+  return _fseeki64(file, offset, SEEK_SET) == 0;
+#else
+  return fseeko(file, off_t(offset), SEEK_SET) == 0;
+#endif
+}
+
+// Feed `file` from its current position to `sync`, calling `on_page` for every
+// page of the stream `serial` until it returns false.
+template<typename OnPage>
+void ReadPages(FILE *file, int serial, OnPage on_page) {
+  ogg_sync_state sync;
+  ogg_sync_init(&sync);
+  ogg_page page;
+  while (true) {
+    auto state = ogg_sync_pageout(&sync, &page);
+    if (state < 0) {
+      continue;
+    }
+    if (state == 0) {
+      auto *buffer = ogg_sync_buffer(&sync, 4096);
+      auto bytes = fread(buffer, 1, 4096, file);
+      if (bytes == 0) {
+        break;
+      }
+      ogg_sync_wrote(&sync, long(bytes));
+      continue;
+    }
+    if (ogg_page_serialno(&page) == serial && !on_page(page)) {
+      break;
+    }
+  }
+  ogg_sync_clear(&sync);
+}
+
+// The granule position at the start of the audio of the stream `serial`: that
+// of its first audio page, less the samples of the packets ending on it.
+int64_t ReadStartGranule(FILE *file, int serial) {
+  if (!SeekFile(file, 0)) {
+    return 0;
+  }
+  ogg_stream_state stream;
+  ogg_stream_init(&stream, serial);
+  int64_t start = 0;
+  // OpusHead and OpusTags.
+  auto headers = 2;
+  ReadPages(file, serial, [&](ogg_page &page) {
+    ogg_stream_pagein(&stream, &page);
+    int64_t samples = 0;
+    ogg_packet packet;
+    int result;
+    while ((result = ogg_stream_packetout(&stream, &packet)) != 0) {
+      if (result < 0) {
+        continue;
+      }
+      if (headers > 0) {
+        headers--;
+        continue;
+      }
+      auto count = opus_packet_get_nb_samples(packet.packet, opus_int32(packet.bytes), 48000);
+      samples += std::max(0, count);
+    }
+    auto granule = ogg_page_granulepos(&page);
+    if (headers > 0 || samples == 0 || granule < 0) {
+      return true;
+    }
+    start = std::max<int64_t>(0, granule - samples);
+    return false;
+  });
+  ogg_stream_clear(&stream);
+  return start;
+}
+
+// The granule position of the last page of the stream `serial`, or -1 if it
+// has none. Only the end of the file is read.
+int64_t ReadEndGranule(FILE *file, int64_t file_size, int serial) {
+  int64_t granule = -1;
+  for (auto chunk = kTailChunkSize; granule < 0; chunk *= 2) {
+    auto offset = std::max<int64_t>(0, file_size - chunk);
+    if (!SeekFile(file, offset)) {
+      break;
+    }
+    ReadPages(file, serial, [&](ogg_page &page) {
+      if (ogg_page_granulepos(&page) >= 0) {
+        granule = ogg_page_granulepos(&page);
+      }
+      return true;
+    });
+    if (offset == 0) {
+      break;
+    }
+  }
+  return granule;
+}
+
+void CopyTags(const OpusTags *tags, char *out, size_t out_size) {
+  size_t length = 0;
+  auto append = [&](const char *str) {
+    if (!str || length + 1 >= out_size) {
+      return;
+    }
+    auto count = std::min(strlen(str), out_size - length - 1);
+    memcpy(out + length, str, count);
+    length += count;
+    if (length + 1 < out_size) {
+      out[length++] = '\n';
+    }
+  };
+  if (tags) {
+    append(tags->vendor);
+    for (int i = 0; i < tags->comments; ++i) {
+      append(tags->user_comments[i]);
+    }
+  }
+  // drop the trailing line break.
+  if (length > 0 && out[length - 1] == '\n') {
+    length--;
+  }
+  out[length] = '\0';
+}
+
+// In memory copy of a cache file. Entries are persisted back to the file by
+// Save() when they changed, keeping the most recently used ones.
+class ProbeCache {
+
+ public:
+  explicit ProbeCache(std::string file_path);
+
+  bool Lookup(const std::string &path, int64_t mtime, int64_t size, OggOpusProbeInfo *info);
+
+  void Insert(const std::string &path, int64_t mtime, int64_t size, const OggOpusProbeInfo &info);
+
+  void Remove(const std::string &path);
+
+  void Save();
+
+ private:
+  struct Entry {
+    int64_t mtime;
+    int64_t size;
+    uint64_t last_used;
+    OggOpusProbeInfo info;
+  };
+
+  std::string file_path_;
+  std::mutex mutex_;
+  std::unordered_map<std::string, Entry> entries_;
+  uint64_t clock_ = 0;
+  bool dirty_ = false;
+
+  void Load();
+
+};
+
+ProbeCache::ProbeCache(std::string file_path) : file_path_(std::move(file_path)) {
+  Load();
+}
+
+void ProbeCache::Load() {
+  auto *file = open_file(file_path_.c_str(), "rb");
+  if (!file) {
+    return;
+  }
+  uint32_t header[4];
+  if (fread(header, sizeof(header), 1, file) != 1
+      || header[0] != kCacheMagic || header[1] != kCacheVersion
+      || header[2] != sizeof(OggOpusProbeInfo)) {
+    fclose(file);
+    return;
+  }
+  for (uint32_t i = 0; i < header[3]; ++i) {
+    uint32_t path_length;
+    if (fread(&path_length, sizeof(path_length), 1, file) != 1 || path_length > 4096) {
+      break;
+    }
+    std::string path(path_length, '\0');
+    Entry entry{};
+    if (fread(&path[0], 1, path_length, file) != path_length
+        || fread(&entry.mtime, sizeof(entry.mtime), 1, file) != 1
+        || fread(&entry.size, sizeof(entry.size), 1, file) != 1
+        || fread(&entry.info, sizeof(entry.info), 1, file) != 1) {
+      break;
+    }
+    entry.info.tags[OGG_OPUS_PROBE_TAGS_SIZE - 1] = '\0';
+    // entries are saved from the most recently used.
+    entry.last_used = header[3] - i;
+    entries_[path] = entry;
+  }
+  clock_ = header[3] + 1;
+  fclose(file);
+}
+
+bool ProbeCache::Lookup(const std::string &path, int64_t mtime, int64_t size, OggOpusProbeInfo *info) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(path);
+  if (it == entries_.end() || it->second.mtime != mtime || it->second.size != size) {
+    return false;
+  }
+  it->second.last_used = ++clock_;
+  *info = it->second.info;
+  return true;
+}
+
+void ProbeCache::Insert(const std::string &path, int64_t mtime, int64_t size, const OggOpusProbeInfo &info) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  entries_[path] = Entry{mtime, size, ++clock_, info};
+  dirty_ = true;
+}
+
+void ProbeCache::Remove(const std::string &path) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (entries_.erase(path) > 0) {
+    dirty_ = true;
+  }
+}
+
+void ProbeCache::Save() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!dirty_) {
+    return;
+  }
+  dirty_ = false;
+
+  std::vector<std::pair<const std::string *, const Entry *>> sorted;
+  sorted.reserve(entries_.size());
+  for (auto &entry : entries_) {
+    sorted.emplace_back(&entry.first, &entry.second);
+  }
+  std::sort(sorted.begin(), sorted.end(), [](const auto &a, const auto &b) {
+    return a.second->last_used > b.second->last_used;
+  });
+  if (sorted.size() > kMaxCacheEntries) {
+    for (size_t i = kMaxCacheEntries; i < sorted.size(); ++i) {
+      entries_.erase(*sorted[i].first);
+    }
+    sorted.resize(kMaxCacheEntries);
+  }
+
+  // write to a temporary file first, so a crash never leaves a truncated cache.
+  auto temp_path = file_path_ + ".tmp";
+  auto *file = open_file(temp_path.c_str(), "wb");
+  if (!file) {
+    return;
+  }
+  uint32_t header[4] = {kCacheMagic, kCacheVersion, sizeof(OggOpusProbeInfo), uint32_t(sorted.size())};
+  bool ok = fwrite(header, sizeof(header), 1, file) == 1;
+  for (auto &item : sorted) {
+    if (!ok) {
+      break;
+    }
+    auto path_length = uint32_t(item.first->size());
+    ok = fwrite(&path_length, sizeof(path_length), 1, file) == 1
+        && fwrite(item.first->data(), 1, path_length, file) == path_length
+        && fwrite(&item.second->mtime, sizeof(item.second->mtime), 1, file) == 1
+        && fwrite(&item.second->size, sizeof(item.second->size), 1, file) == 1
+        && fwrite(&item.second->info, sizeof(item.second->info), 1, file) == 1;
+  }
+  ok = fclose(file) == 0 && ok;
+  if (!ok) {
+    remove(temp_path.c_str());
+    return;
+  }
+  remove(file_path_.c_str());
+  rename(temp_path.c_str(), file_path_.c_str());
+}
+
+std::mutex caches_mutex;
+std::map<std::string, std::unique_ptr<ProbeCache>> caches;
+
+ProbeCache *GetProbeCache(const char *cache_path) {
+  std::lock_guard<std::mutex> lock(caches_mutex);
+  auto &cache = caches[cache_path];
+  if (!cache) {
+    cache = std::make_unique<ProbeCache>(cache_path);
+  }
+  return cache.get();
+}
+
+}
+
+void ForgetProbedFile(const char *path) {
+  std::lock_guard<std::mutex> lock(caches_mutex);
+  for (auto &cache : caches) {
+    cache.second->Remove(path);
+    cache.second->Save();
+  }
+}
+
+int32_t ogg_opus_probe(const char *path, OggOpusProbeInfo *info) {
+  if (!path || !info) {
+    return OP_EFAULT;
+  }
+  memset(info, 0, sizeof(OggOpusProbeInfo));
+
+  // op_test_file only parses the headers, finishing to open the file would
+  // allocate a decoder. The duration is read from the granule positions of the
+  // first and last pages instead, so only the first link of a chained file is
+  // measured.
+  int error = 0;
+  auto *opus_file = op_test_file(path, &error);
+  if (!opus_file) {
+    return error != 0 ? error : OP_EFAULT;
+  }
+  auto *head = op_head(opus_file, -1);
+  auto serial = int(op_serialno(opus_file, -1));
+  info->channels = head->channel_count;
+  info->input_sample_rate = int32_t(head->input_sample_rate);
+  info->output_gain = head->output_gain;
+  auto pre_skip = int64_t(head->pre_skip);
+  CopyTags(op_tags(opus_file, -1), info->tags, OGG_OPUS_PROBE_TAGS_SIZE);
+  op_free(opus_file);
+
+  int64_t mtime = 0, size = 0;
+  auto *file = open_file(path, "rb");
+  if (!file || !get_file_stat(path, &mtime, &size)) {
+    if (file) {
+      fclose(file);
+    }
+    return OP_EREAD;
+  }
+  auto start = ReadStartGranule(file, serial);
+  auto end = ReadEndGranule(file, size, serial);
+  fclose(file);
+  if (end < 0 || end < start + pre_skip) {
+    return OP_EBADTIMESTAMP;
+  }
+
+  info->duration = end - start - pre_skip;
+  if (info->duration > 0) {
+    // like op_bitrate, over the whole file rather than its audio pages.
+    info->bitrate = int32_t(std::min<int64_t>(INT32_MAX, size * 8 * 48000 / info->duration));
+  }
+  return 0;
+}
+
+int32_t ogg_opus_probe_batch(const char **paths, int32_t count, const char *cache_path,
+                             OggOpusProbeInfo *infos, int32_t *results) {
+  if (count <= 0 || !paths || !infos || !results) {
+    return 0;
+  }
+  auto *cache = cache_path ? GetProbeCache(cache_path) : nullptr;
+
+  RunParallel(count, [&](size_t i) {
+    int64_t mtime = 0, size = 0;
+    auto cacheable = cache && get_file_stat(paths[i], &mtime, &size);
+    if (cacheable && cache->Lookup(paths[i], mtime, size, &infos[i])) {
+      results[i] = 0;
+      return;
+    }
+    results[i] = ogg_opus_probe(paths[i], &infos[i]);
+    if (cacheable && results[i] == 0) {
+      cache->Insert(paths[i], mtime, size, infos[i]);
+    }
+  });
+
+  if (cache) {
+    cache->Save();
+  }
+
+  int32_t succeed = 0;
+  for (int i = 0; i < count; ++i) {
+    if (results[i] == 0) {
+      succeed++;
+    }
+  }
+  return succeed;
+}
@@ -0,0 +1,56 @@
+#ifndef OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_PROBE_H_
+#define OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_PROBE_H_
+
+#include "stdint.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if _WIN32
+#define FFI_PLUGIN_EXPORT __declspec(dllexport)
+#else
+#define FFI_PLUGIN_EXPORT
+#endif
+
+#define OGG_OPUS_PROBE_TAGS_SIZE 512
+
+typedef struct OggOpusProbeInfo {
+  // duration in 48kHz samples.
+  int64_t duration;
+  int32_t channels;
+  // the sample rate of the audio before it was encoded.
+  int32_t input_sample_rate;
+  // the gain to apply to the decoded output, in Q7.8 dB.
+  int32_t output_gain;
+  // average bitrate, in bits per second.
+  int32_t bitrate;
+  // the vendor string and user comments of the OpusTags, one per line.
+  // truncated if it does not fit.
+  char tags[OGG_OPUS_PROBE_TAGS_SIZE];
+} OggOpusProbeInfo;
+
+// Read the metadata of the ogg opus file at `path` from its headers, without
+// decoding any audio or allocating a decoder. The duration is that of the
+// first link of a chained file. Returns 0 on success, a negative value on
+// failure.
+FFI_PLUGIN_EXPORT int32_t ogg_opus_probe(const char *path, OggOpusProbeInfo *info);
+
+// Probe `count` files in parallel. `results[i]` receives the return value of
+// ogg_opus_probe for `paths[i]` and `infos[i]` its metadata.
+//
+// If `cache_path` is not null, metadata is cached in memory and in that file,
+// keyed by path, modification time in nanoseconds and size. Files which hit the cache are only
+// stat-ed. Returns the number of files probed successfully.
+FFI_PLUGIN_EXPORT int32_t ogg_opus_probe_batch(const char **paths, int32_t count, const char *cache_path,
+                                               OggOpusProbeInfo *infos, int32_t *results);
+
+#ifdef __cplusplus
+}
+
+// Drop `path` from every probe cache in use, for files rewritten in place
+// within the resolution of their modification time.
+void ForgetProbedFile(const char *path);
+#endif
+
+#endif //OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_PROBE_H_
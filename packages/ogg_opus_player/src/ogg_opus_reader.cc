@@ -0,0 +1,135 @@
+#include "ogg_opus_reader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include "ogg_opus_utils.h"
+
+namespace {
+
+// longer files are streamed, e.g. 60 seconds of mono pcm is 5.5MB.
+const ogg_int64_t kMaxCachedSamples = 60 * 48000;
+
+}
+
+OggOpusReader::OggOpusReader(const char *file_path) : file_path_(file_path), opus_file_(nullptr) {
+  auto &cache = PcmCache::Global();
+  auto cacheable = cache.Budget() > 0 && get_file_stat(file_path, &file_mtime_, &file_size_);
+  if (cacheable) {
+    cached_pcm_ = cache.Lookup(file_path, file_mtime_, file_size_);
+    if (cached_pcm_) {
+      return;
+    }
+  }
+
+  int result;
+  auto opus_file = op_open_file(file_path, &result);
+  if (result == 0 && opus_file) {
+    opus_file_ = opus_file;
+  } else {
+    std::cerr << "open opus file failed" << result << std::endl;
+    return;
+  }
+
+  auto total = op_pcm_total(opus_file_, -1);
+  auto channels = GetChannelCount();
+  if (cacheable && total > 0 && total <= kMaxCachedSamples
+      && size_t(total * channels) * sizeof(opus_int16) <= cache.Budget()) {
+    decoded_pcm_ = std::make_unique<DecodedPcm>();
+    decoded_pcm_->channels = channels;
+    decoded_pcm_->bitrate = GetBitrate();
+    decoded_pcm_->samples.resize(size_t(total * channels));
+  }
+}
+
+OggOpusReader::~OggOpusReader() {
+  if (decoded_pcm_ && !decoded_discarded_ && ended_) {
+    decoded_pcm_->samples.resize(decoded_length_);
+    PcmCache::Global().Insert(file_path_, file_mtime_, file_size_, std::move(decoded_pcm_));
+  }
+  if (opus_file_) {
+    op_free(opus_file_);
+  }
+}
+
+int OggOpusReader::ReadPcmData(opus_int16 *data, int length) {
+  if (cached_pcm_) {
+    auto channels = size_t(cached_pcm_->channels);
+    auto available = (cached_pcm_->samples.size() - cached_offset_) / channels;
+    auto read = std::min(available, size_t(std::max(length, 0)));
+    memcpy(data, cached_pcm_->samples.data() + cached_offset_, read * channels * sizeof(opus_int16));
+    cached_offset_ += read * channels;
+    if (read == 0) {
+      ended_ = true;
+    }
+    return int(read);
+  }
+
+  if (!opus_file_) {
+    return 0;
+  }
+  auto channels = GetChannelCount();
+  auto read = 0;
+
+  auto result = 1;
+  while ((result == OP_HOLE || result > 0) && read < length) {
+    // op_read counts the buffer size in values, but returns samples per channel.
+    result = op_read(opus_file_, data + read * channels,
+                     (length - read) * channels, nullptr);
+    if (result >= 0) {
+      read += result;
+    } else {
+      // a damaged file is not cached, it is decoded again next time.
+      decoded_discarded_ = true;
+    }
+  }
+
+  if (result < 0 && result != OP_HOLE) {
+    return 0;
+  }
+
+  if (result == 0) {
+    ended_ = true;
+  }
+
+  CacheDecoded(data, read);
+
+  return read;
+}
+
+void OggOpusReader::CacheDecoded(const opus_int16 *data, int length) {
+  if (!decoded_pcm_ || decoded_discarded_) {
+    return;
+  }
+  auto &samples = decoded_pcm_->samples;
+  auto count = size_t(length) * decoded_pcm_->channels;
+  if (count > samples.size() - decoded_length_) {
+    // more pcm than op_pcm_total announced, never grow the buffer here.
+    decoded_discarded_ = true;
+    return;
+  }
+  memcpy(samples.data() + decoded_length_, data, count * sizeof(opus_int16));
+  decoded_length_ += count;
+}
+
+int OggOpusReader::GetChannelCount() const {
+  if (cached_pcm_) {
+    return cached_pcm_->channels;
+  }
+  if (!opus_file_) {
+    return 1;
+  }
+  return op_channel_count(opus_file_, -1);
+}
+
+int OggOpusReader::GetBitrate() const {
+  if (cached_pcm_) {
+    return cached_pcm_->bitrate;
+  }
+  if (!opus_file_) {
+    return 0;
+  }
+  auto bitrate = op_bitrate(opus_file_, -1);
+  return bitrate > 0 ? bitrate : 0;
+}
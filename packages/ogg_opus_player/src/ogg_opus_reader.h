@@ -0,0 +1,70 @@
+#ifndef OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_READER_H_
+#define OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_READER_H_
+
+#include <memory>
+#include <string>
+
+#include "ogg/opusfile.h"
+
+#include "ogg_opus_pcm_cache.h"
+
+// Decodes an ogg opus file to interleaved 48kHz pcm.
+//
+// Short files are decoded once: the pcm of a file read to its end is kept in
+// PcmCache::Global(), and readers of the same unchanged file serve it from
+// there without opening the file.
+//
+// ReadPcmData runs on the audio thread of the player, so it never allocates
+// or locks: the pcm is collected into a buffer sized when the file is opened,
+// and inserted into the cache when the reader is destroyed.
+class OggOpusReader {
+
+ private:
+  std::string file_path_;
+  OggOpusFile *opus_file_;
+
+  bool ended_ = false;
+
+  // the cached pcm being served, instead of opus_file_.
+  std::shared_ptr<const DecodedPcm> cached_pcm_;
+  size_t cached_offset_ = 0;
+
+  // pcm decoded so far, inserted into the cache by the destructor if the file
+  // was read to its end.
+  std::unique_ptr<DecodedPcm> decoded_pcm_;
+  size_t decoded_length_ = 0;
+  // set instead of freeing decoded_pcm_ on the audio thread.
+  bool decoded_discarded_ = false;
+  int64_t file_mtime_ = 0;
+  int64_t file_size_ = 0;
+
+  // Copy `length` decoded samples per channel into decoded_pcm_.
+  void CacheDecoded(const opus_int16 *data, int length);
+
+ public:
+
+  explicit OggOpusReader(const char *file_path);
+
+  ~OggOpusReader();
+
+  // Read up to `length` samples per channel into `data`, which must hold
+  // `length * GetChannelCount()` values. Returns the number of samples per
+  // channel read, 0 at the end of the file or on error.
+  int ReadPcmData(opus_int16 *data, int length);
+
+  int GetChannelCount() const;
+
+  // Whether the file was opened, the reader decodes nothing otherwise.
+  bool IsOpen() const { return opus_file_ != nullptr || cached_pcm_ != nullptr; }
+
+  bool IsEnded() const { return ended_; }
+
+  // Whether the pcm is served from the cache, without decoding.
+  bool IsCached() const { return cached_pcm_ != nullptr; }
+
+  // Average bitrate of the file in bits per second, or 0 if unknown.
+  int GetBitrate() const;
+
+};
+
+#endif //OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_READER_H_
@@ -6,106 +6,182 @@
 
 #include "ogg/opusenc.h"
 
+#include <atomic>
+#include <deque>
+#include <functional>
 #include <memory>
 #include <iostream>
+#include <thread>
 #include <vector>
 #include <cmath>
 #include <cstring>
+#include <string>
 
 #include "SDL.h"
+#include "dart_api_dl.h"
+#include "ogg_opus_callback_timer.h"
+#include "ogg_opus_loudness.h"
+#include "ogg_opus_loudness_meter.h"
+#include "ogg_opus_ring_buffer.h"
 #include "ogg_opus_utils.h"
+#include "ogg_opus_vad.h"
+#include "ogg_opus_waveform_core.h"
+#include "ogg_opus_writer.h"
 
 namespace {
 
-inline void set_bits(uint8_t *bytes, int32_t bitOffset, int32_t value) {
-  bytes += bitOffset / 8;
-  bitOffset %= 8;
-  *((int32_t *) bytes) |= (value << bitOffset);
-}
+// 2 seconds of 16kHz mono audio.
+const size_t kCaptureRingCapacity = 32768;
+
+// samples encoded per OggOpusWriter::Write call on the encoder thread.
+const int kEncodeChunkSamples = 1920;
+
+// samples reduced to one waveform peak.
+const int kWaveformBucketSamples = 100;
+
+// buckets of the waveform returned by MakeWaveData.
+const int kWaveDataBuckets = 100;
+
+// silence kept before the first speech and after the last one.
+const int kVadLeadingSilenceMs = 200;
+const int kVadTrailingSilenceMs = 200;
+
+// silence held back in case the recording stops before speech resumes. Longer
+// silence is encoded with DTX and can not be trimmed anymore.
+const int kVadMaxPendingSilenceMs = 10000;
+
+enum RecorderPortMessage {
+  // [RECORDER_PROGRESS, recorded duration in seconds, rms level, peak level,
+  //  Int16List of the waveform samples since the last progress,
+  //  encoded duration in seconds]
+  RECORDER_PROGRESS = 0,
+  // [RECORDER_PAGE, Uint8List of one complete ogg page]
+  RECORDER_PAGE = 1,
+  // [RECORDER_PAGES_END], after the last page.
+  RECORDER_PAGES_END = 2,
+  // [RECORDER_HEADER_PAGE, Uint8List of the first page with the loudness
+  //  gain], before RECORDER_PAGES_END.
+  RECORDER_HEADER_PAGE = 3
+};
 
-class OggOpusWriter {
+class SdlOggOpusRecorder {
 
- public:
-  OggOpusWriter() = default;
+ private:
+  std::unique_ptr<OggOpusWriter> writer_;
+  std::string file_path_;
+  int sample_rate_ = 0;
 
-  int Init(const char *file_name, int sample_rate);
+  SDL_AudioDeviceID device_id_ = -1;
 
-  int Write(const opus_int16 *data, int size);
+  // the capture callback only copies samples into this ring, they are encoded
+  // on encoder_thread_ so that encoding spikes never stall the capture.
+  SpscRingBuffer<int16_t> capture_ring_;
+  SDL_sem *capture_signal_ = nullptr;
+  std::thread encoder_thread_;
+  std::atomic<bool> encoder_running_{false};
 
-  ~OggOpusWriter();
+  std::atomic<int64_t> ring_high_water_mark_{0};
+  std::atomic<int64_t> overrun_count_{0};
 
- private:
-  OggOpusComments *comments_ = nullptr;
-  OggOpusEnc *encoder_ = nullptr;
+  // peaks never exceed 32767, they are posted to dart as an Int16List.
+  std::vector<uint16_t> waveform_samples_;
+  WaveformBuilder waveform_builder_{};
 
-};
+  // number of samples captured, and encoded. Silence dropped by the voice
+  // activity detection is only captured.
+  std::atomic<int64_t> captured_samples_{0};
+  std::atomic<int64_t> encoded_samples_{0};
 
-int OggOpusWriter::Init(const char *file_name, opus_int32 sample_rate) {
-  auto *comments = ope_comments_create();
-  if (!comments) {
-    return -1;
-  }
-  int error = OPE_OK;
-  auto encoder = ope_encoder_create_file(file_name, comments, sample_rate, 1, 0, &error);
-  if (error != OPE_OK) {
-    ope_comments_destroy(comments);
-    return -1;
-  }
-  error = ope_encoder_ctl(encoder, OPUS_SET_BITRATE_REQUEST, 16 * 1024);
-  if (error != OPE_OK) {
-    ope_encoder_destroy(encoder);
-    ope_comments_destroy(comments);
-    return -1;
-  }
-  comments_ = comments;
-  encoder_ = encoder;
-  return 0;
-}
+  Dart_Port_DL dart_port_;
 
-OggOpusWriter::~OggOpusWriter() {
-  if (encoder_) {
-    ope_encoder_drain(encoder_);
-    ope_encoder_destroy(encoder_);
-  }
-  if (comments_) {
-    ope_comments_destroy(comments_);
-  }
-}
+  // post progress to dart every this many milliseconds, 0 to disable.
+  std::atomic<int32_t> progress_interval_ms_{0};
+  int64_t progress_samples_ = 0;
+  double progress_square_sum_ = 0;
+  int32_t progress_peak_ = 0;
+  size_t progress_waveform_offset_ = 0;
 
-int OggOpusWriter::Write(const opus_int16 *data, int size) {
-  if (!encoder_) {
-    return -1;
-  }
-  int error = ope_encoder_write(encoder_, data, size / 2);
-  return error;
-}
+  // measures the loudness on the encoder thread if normalization is enabled.
+  std::unique_ptr<LoudnessMeter> loudness_meter_;
+  double loudness_target_ = 0;
+  double loudness_ = -HUGE_VAL;
 
-class SdlOggOpusRecorder {
+  // trims silence on the encoder thread if voice activity detection is enabled.
+  std::unique_ptr<VoiceActivityDetector> vad_;
+  std::vector<int16_t> vad_frame_;
+  size_t vad_frame_length_ = 0;
+  // silent frames not encoded yet.
+  std::deque<std::vector<int16_t>> pending_silence_;
+  bool speech_started_ = false;
+  // pauses are shortened to this many frames, 0 keeps them.
+  size_t max_pause_frames_ = 0;
 
- private:
-  std::unique_ptr<OggOpusWriter> writer_;
-  int sample_rate_ = 0;
+  // a copy of the first streamed page, posted again by Stop() with the
+  // loudness gain set.
+  std::vector<unsigned char> header_page_;
+  // the stream ended, RECORDER_PAGES_END is posted by Stop() after the header.
+  bool pages_ended_ = false;
 
-  SDL_AudioDeviceID device_id_ = -1;
+  void ProcessCaptured(const int16_t *samples, int number_of_samples);
+
+  void ProcessVadFrame();
+
+  void EncodePendingSilence(size_t frames);
 
-  std::vector<int16_t> waveform_samples_;
+  void FinishVad();
 
-  int16_t wave_form_peek_ = 0;
-  int32_t wave_form_peek_count_ = 0;
+  void EncodeLoop();
 
-  // recorded duration in seconds
-  double duration_ = 0;
+  void UpdateProgress(const int16_t *samples, int number_of_samples);
+
+  void PostProgress();
+
+  // Post `page` as a message of `type`, or only `type` if `page` is null.
+  void PostPage(RecorderPortMessage type, const unsigned char *page, int length);
+
+  void EncodeSamples(const int16_t *samples, int number_of_samples);
 
  public:
-  SdlOggOpusRecorder();
+  explicit SdlOggOpusRecorder(Dart_Port_DL dart_port);
+
+  void SetProgressInterval(int32_t interval_ms) { progress_interval_ms_ = interval_ms; }
 
   int Init(const char *file_name);
 
-  void Start() const;
+  void Start();
 
   void Stop();
 
-  double GetDuration() const { return duration_; }
+  // recorded duration in seconds, including the silence which is dropped.
+  double GetDuration() const {
+    return sample_rate_ > 0 ? double(captured_samples_.load()) / sample_rate_ : 0;
+  }
+
+  // duration of the encoded audio in seconds.
+  double GetEncodedDuration() const {
+    return sample_rate_ > 0 ? double(encoded_samples_.load()) / sample_rate_ : 0;
+  }
+
+  // Post every ogg page to dart as it is completed, at least every
+  // `max_page_delay_ms` of audio. Only before Start().
+  void EnablePageStream(int32_t max_page_delay_ms);
+
+  // Drop silence before the first and after the last speech, and shorten
+  // pauses longer than `max_pause_ms` if it is not 0. Silence which is kept is
+  // encoded with DTX. Only before Start().
+  void EnableVoiceActivityDetection(int32_t max_pause_ms);
+
+  // Measure the loudness while recording, and on Stop() set the output gain of
+  // the file to bring it to `target_lufs`. Only before Start().
+  void SetLoudnessTarget(double target_lufs);
+
+  // integrated loudness of the recording in LUFS, available after Stop().
+  double GetLoudness() const { return loudness_; }
+
+  void GetBufferStats(int64_t *high_water_mark, int64_t *overrun_count) const {
+    *high_water_mark = ring_high_water_mark_.load();
+    *overrun_count = overrun_count_.load();
+  }
 
   ~SdlOggOpusRecorder();
 
@@ -115,8 +191,11 @@ class SdlOggOpusRecorder {
 
 };
 
-SdlOggOpusRecorder::SdlOggOpusRecorder() : waveform_samples_() {
-
+SdlOggOpusRecorder::SdlOggOpusRecorder(Dart_Port_DL dart_port)
+    : capture_ring_(kCaptureRingCapacity), waveform_samples_(), dart_port_(dart_port) {
+  // about 10 minutes of waveform samples before the vector has to grow.
+  waveform_samples_.reserve(16000 * 60 * 10 / kWaveformBucketSamples);
+  waveform_builder_init(&waveform_builder_, kWaveformBucketSamples);
 }
 
 int SdlOggOpusRecorder::Init(const char *file_name) {
@@ -140,91 +219,346 @@ int SdlOggOpusRecorder::Init(const char *file_name) {
     return -1;
   }
   sample_rate_ = spec.freq;
+  file_path_ = file_name ? file_name : "";
   std::cout << "SDL_OpenAudioDevice: spec freq = " << spec.freq << std::endl;
   writer_ = std::make_unique<OggOpusWriter>();
   return writer_->Init(file_name, sample_rate_);
 }
 
 void SdlOggOpusRecorder::WriteAudioData(Uint8 *stream, int size) {
+  auto number_of_samples = size_t(size / 2);
+  AudioCallbackTimer timer(true, int(number_of_samples), sample_rate_);
+  auto written = capture_ring_.Write(reinterpret_cast<int16_t *>(stream), number_of_samples);
+  if (written < number_of_samples) {
+    overrun_count_++;
+    timer.SetMissing(int(number_of_samples - written));
+  }
+  auto buffered = int64_t(capture_ring_.Size());
+  if (buffered > ring_high_water_mark_.load(std::memory_order_relaxed)) {
+    ring_high_water_mark_.store(buffered, std::memory_order_relaxed);
+  }
+  SDL_SemPost(capture_signal_);
+}
+
+void SdlOggOpusRecorder::EncodeLoop() {
+  int16_t buffer[kEncodeChunkSamples];
+  while (true) {
+    auto running = encoder_running_.load();
+    size_t read;
+    while ((read = capture_ring_.Read(buffer, kEncodeChunkSamples)) > 0) {
+      ProcessCaptured(buffer, int(read));
+    }
+    if (!running) {
+      FinishVad();
+      // the ring has been drained after the capture stopped.
+      if (progress_samples_ > 0) {
+        PostProgress();
+      }
+      break;
+    }
+    SDL_SemWaitTimeout(capture_signal_, 100);
+  }
+}
+
+void SdlOggOpusRecorder::ProcessCaptured(const int16_t *samples, int number_of_samples) {
+  captured_samples_ += number_of_samples;
+  if (!vad_) {
+    EncodeSamples(samples, number_of_samples);
+  } else {
+    for (auto remaining = 0; remaining < number_of_samples;) {
+      auto count = std::min(size_t(number_of_samples - remaining), vad_frame_.size() - vad_frame_length_);
+      memcpy(vad_frame_.data() + vad_frame_length_, samples + remaining, count * sizeof(int16_t));
+      vad_frame_length_ += count;
+      remaining += int(count);
+      if (vad_frame_length_ == vad_frame_.size()) {
+        ProcessVadFrame();
+        vad_frame_length_ = 0;
+      }
+    }
+  }
+  // after encoding, so the progress has the waveform of the encoded samples.
+  // Silence held back still moves the progress.
+  UpdateProgress(samples, number_of_samples);
+}
+
+void SdlOggOpusRecorder::ProcessVadFrame() {
+  auto frame_ms = 1000 * int(vad_frame_.size()) / sample_rate_;
+  if (vad_->Process(vad_frame_.data())) {
+    // a pause, or the silence before the first speech, ends.
+    EncodePendingSilence(pending_silence_.size());
+    writer_->SetDtx(false);
+    EncodeSamples(vad_frame_.data(), int(vad_frame_.size()));
+    speech_started_ = true;
+    return;
+  }
+
+  pending_silence_.push_back(vad_frame_);
+  if (!speech_started_) {
+    while (pending_silence_.size() * frame_ms > kVadLeadingSilenceMs) {
+      pending_silence_.pop_front();
+    }
+  } else if (max_pause_frames_ > 0 && pending_silence_.size() > max_pause_frames_) {
+    // keep both ends of the pause, so it fades out and in as recorded.
+    pending_silence_.erase(pending_silence_.begin() + long(max_pause_frames_ / 2));
+  } else if (pending_silence_.size() * frame_ms > kVadMaxPendingSilenceMs) {
+    EncodePendingSilence(1);
+  }
+}
+
+void SdlOggOpusRecorder::EncodePendingSilence(size_t frames) {
+  if (frames == 0) {
+    return;
+  }
+  writer_->SetDtx(true);
+  for (size_t i = 0; i < frames && !pending_silence_.empty(); ++i) {
+    auto &frame = pending_silence_.front();
+    EncodeSamples(frame.data(), int(frame.size()));
+    pending_silence_.pop_front();
+  }
+}
+
+void SdlOggOpusRecorder::FinishVad() {
+  if (!vad_) {
+    return;
+  }
+  // the last partial frame is part of the trailing silence.
+  if (speech_started_) {
+    auto frame_ms = 1000 * int(vad_frame_.size()) / sample_rate_;
+    EncodePendingSilence(std::min(pending_silence_.size(), size_t(kVadTrailingSilenceMs / frame_ms)));
+  }
+  pending_silence_.clear();
+  vad_frame_length_ = 0;
+}
+
+void SdlOggOpusRecorder::EncodeSamples(const int16_t *samples, int number_of_samples) {
   if (!writer_) {
     std::cerr << "writer_ is null" << std::endl;
     return;
   }
-  writer_->Write(reinterpret_cast<opus_int16 *>(stream), size);
+  writer_->Write(samples, number_of_samples * 2);
+  encoded_samples_ += number_of_samples;
+
+  if (loudness_meter_) {
+    loudness_meter_->Process(samples, number_of_samples);
+  }
 
-  auto number_of_samples = size / 2;
-  duration_ = duration_ + number_of_samples / 16000.0;
+  auto waveform_size = waveform_samples_.size();
+  waveform_samples_.resize(waveform_size + number_of_samples / kWaveformBucketSamples + 1);
+  auto peaks = waveform_builder_add(&waveform_builder_, samples, number_of_samples,
+                                    waveform_samples_.data() + waveform_size);
+  waveform_samples_.resize(waveform_size + peaks);
+}
 
-  // process waveform data
-  if (number_of_samples <= 0) {
+void SdlOggOpusRecorder::UpdateProgress(const int16_t *samples, int number_of_samples) {
+  auto interval_ms = progress_interval_ms_.load(std::memory_order_relaxed);
+  if (interval_ms <= 0 || dart_port_ == 0) {
     return;
   }
-
-  auto *samples = reinterpret_cast<int16_t *>(stream);
   for (int i = 0; i < number_of_samples; ++i) {
-    auto sample = samples[i];
-    wave_form_peek_ = std::max(wave_form_peek_, sample);
-    wave_form_peek_count_++;
-
-    if (wave_form_peek_count_ >= 100) {
-      waveform_samples_.push_back(wave_form_peek_);
-      wave_form_peek_ = 0;
-      wave_form_peek_count_ = 0;
+    int32_t sample = samples[i];
+    progress_square_sum_ += double(sample * sample);
+    progress_peak_ = std::max(progress_peak_, std::abs(sample));
+  }
+  progress_samples_ += number_of_samples;
+  if (progress_samples_ * 1000 >= int64_t(interval_ms) * sample_rate_) {
+    PostProgress();
+  }
+}
+
+void SdlOggOpusRecorder::PostProgress() {
+  Dart_CObject type;
+  type.type = Dart_CObject_kInt32;
+  type.value.as_int32 = RECORDER_PROGRESS;
+
+  Dart_CObject duration;
+  duration.type = Dart_CObject_kDouble;
+  duration.value.as_double = GetDuration();
+
+  Dart_CObject rms;
+  rms.type = Dart_CObject_kDouble;
+  rms.value.as_double = std::sqrt(progress_square_sum_ / double(progress_samples_)) / 32768.0;
+
+  Dart_CObject peak;
+  peak.type = Dart_CObject_kDouble;
+  peak.value.as_double = progress_peak_ / 32768.0;
+
+  // waveform_samples_ only grows, new samples are appended to the dart side.
+  Dart_CObject waveform;
+  waveform.type = Dart_CObject_kTypedData;
+  waveform.value.as_typed_data.type = Dart_TypedData_kInt16;
+  waveform.value.as_typed_data.length = intptr_t(waveform_samples_.size() - progress_waveform_offset_);
+  waveform.value.as_typed_data.values =
+      reinterpret_cast<uint8_t *>(waveform_samples_.data() + progress_waveform_offset_);
+
+  Dart_CObject encoded_duration;
+  encoded_duration.type = Dart_CObject_kDouble;
+  encoded_duration.value.as_double = GetEncodedDuration();
+
+  Dart_CObject *values[] = {&type, &duration, &rms, &peak, &waveform, &encoded_duration};
+  Dart_CObject message;
+  message.type = Dart_CObject_kArray;
+  message.value.as_array.length = 6;
+  message.value.as_array.values = values;
+  Dart_PostCObject_DL(dart_port_, &message);
+
+  progress_samples_ = 0;
+  progress_square_sum_ = 0;
+  progress_peak_ = 0;
+  progress_waveform_offset_ = waveform_samples_.size();
+}
+
+void SdlOggOpusRecorder::EnablePageStream(int32_t max_page_delay_ms) {
+  if (encoder_running_ || !writer_ || dart_port_ == 0) {
+    return;
+  }
+  writer_->SetPageCallback([this](const unsigned char *page, int length) {
+    if (!page) {
+      pages_ended_ = true;
+      return;
+    }
+    if (header_page_.empty()) {
+      header_page_.assign(page, page + length);
     }
+    PostPage(RECORDER_PAGE, page, length);
+  }, max_page_delay_ms);
+}
+
+void SdlOggOpusRecorder::PostPage(RecorderPortMessage message_type, const unsigned char *page, int length) {
+  Dart_CObject type;
+  type.type = Dart_CObject_kInt32;
+  type.value.as_int32 = message_type;
+  if (!page) {
+    Dart_CObject *values[] = {&type};
+    Dart_CObject message;
+    message.type = Dart_CObject_kArray;
+    message.value.as_array.length = 1;
+    message.value.as_array.values = values;
+    Dart_PostCObject_DL(dart_port_, &message);
+    return;
   }
 
+  // the page buffer is reused by libopusenc, dart owns this copy and frees it
+  // when the Uint8List is collected.
+  auto *data = static_cast<uint8_t *>(malloc(length));
+  memcpy(data, page, length);
+  Dart_CObject bytes;
+  bytes.type = Dart_CObject_kExternalTypedData;
+  bytes.value.as_external_typed_data.type = Dart_TypedData_kUint8;
+  bytes.value.as_external_typed_data.length = length;
+  bytes.value.as_external_typed_data.data = data;
+  bytes.value.as_external_typed_data.peer = data;
+  bytes.value.as_external_typed_data.callback = [](void *, void *peer) {
+    free(peer);
+  };
+
+  Dart_CObject *values[] = {&type, &bytes};
+  Dart_CObject message;
+  message.type = Dart_CObject_kArray;
+  message.value.as_array.length = 2;
+  message.value.as_array.values = values;
+  if (!Dart_PostCObject_DL(dart_port_, &message)) {
+    free(data);
+  }
+}
+
+void SdlOggOpusRecorder::EnableVoiceActivityDetection(int32_t max_pause_ms) {
+  if (encoder_running_ || !writer_) {
+    return;
+  }
+  vad_ = std::make_unique<VoiceActivityDetector>(sample_rate_);
+  vad_frame_.resize(vad_->FrameSize());
+  vad_frame_length_ = 0;
+  auto frame_ms = std::max(1, 1000 * vad_->FrameSize() / sample_rate_);
+  max_pause_frames_ = max_pause_ms > 0 ? size_t(std::max(1, max_pause_ms / frame_ms)) : 0;
+}
+
+void SdlOggOpusRecorder::SetLoudnessTarget(double target_lufs) {
+  if (encoder_running_ || !writer_) {
+    return;
+  }
+  loudness_target_ = target_lufs;
+  loudness_meter_ = std::make_unique<LoudnessMeter>(sample_rate_, 1);
 }
 
-void SdlOggOpusRecorder::Start() const {
+void SdlOggOpusRecorder::Start() {
+  if (device_id_ <= 0 || encoder_running_) {
+    return;
+  }
+  if (!capture_signal_) {
+    capture_signal_ = SDL_CreateSemaphore(0);
+  }
+  encoder_running_ = true;
+  encoder_thread_ = std::thread(&SdlOggOpusRecorder::EncodeLoop, this);
   SDL_PauseAudioDevice(device_id_, 0);
 }
 
 void SdlOggOpusRecorder::Stop() {
-  SDL_LockAudioDevice(device_id_);
-  SDL_PauseAudioDevice(device_id_, 1);
+  if (device_id_ > 0) {
+    SDL_PauseAudioDevice(device_id_, 1);
+    SDL_CloseAudioDevice(device_id_);
+    device_id_ = 0;
+  }
+  // the capture callback can not run anymore, let the encoder drain the ring.
+  if (encoder_thread_.joinable()) {
+    encoder_running_ = false;
+    SDL_SemPost(capture_signal_);
+    encoder_thread_.join();
+  }
+  if (!writer_) {
+    return;
+  }
+  // finish the file before its header is rewritten.
   writer_ = nullptr;
-  SDL_UnlockAudioDevice(device_id_);
-  SDL_CloseAudioDevice(device_id_);
-  device_id_ = 0;
+  if (loudness_meter_) {
+    loudness_ = loudness_meter_->IntegratedLoudness();
+    if (std::isfinite(loudness_)) {
+      auto gain = LoudnessToOutputGain(loudness_, loudness_meter_->Peak(), loudness_target_);
+      if (!file_path_.empty() && WriteOutputGain(file_path_.c_str(), gain) != 0) {
+        std::cerr << "failed to write output gain: " << file_path_ << std::endl;
+      }
+      // the streamed header was posted with a gain of 0.
+      if (!header_page_.empty() && SetPageOutputGain(header_page_.data(), header_page_.size(), gain)) {
+        PostPage(RECORDER_HEADER_PAGE, header_page_.data(), int(header_page_.size()));
+      }
+    }
+  }
+  if (pages_ended_) {
+    pages_ended_ = false;
+    PostPage(RECORDER_PAGES_END, nullptr, 0);
+  }
 }
 
 SdlOggOpusRecorder::~SdlOggOpusRecorder() {
-  if (device_id_ > 0) {
-    Stop();
+  Stop();
+  if (capture_signal_) {
+    SDL_DestroySemaphore(capture_signal_);
   }
 }
 
 void SdlOggOpusRecorder::MakeWaveData(uint8_t **result, int64_t *size) {
-  const int number_of_waveform_intensities = 100;
-  auto *intensities = static_cast<uint8_t *>(malloc(number_of_waveform_intensities));
-  memset(intensities, 0, number_of_waveform_intensities);
-
-  int16_t min_raw_sample = INT16_MAX;
-  int16_t max_raw_sample = 0;
-
-  for (auto &sample : waveform_samples_) {
-    min_raw_sample = std::min(min_raw_sample, sample);
-    max_raw_sample = std::max(max_raw_sample, sample);
+  std::vector<uint16_t> peaks(waveform_samples_);
+  // the last partial bucket, without disturbing the builder.
+  auto builder = waveform_builder_;
+  uint16_t last_peak;
+  if (waveform_builder_flush(&builder, &last_peak)) {
+    peaks.push_back(last_peak);
   }
 
-  auto range = max_raw_sample - min_raw_sample;
-  auto delta = range == 0 ? 0 : float_t(UINT8_MAX) / float_t(range);
-
-  for (int i = 0; i < waveform_samples_.size(); ++i) {
-    auto index = i * number_of_waveform_intensities / waveform_samples_.size();
-    auto intensity = std::min(float_t(UINT8_MAX), float_t(waveform_samples_[i]) * delta);
-    intensities[index] = uint8_t(intensity);
-  }
+  uint16_t buckets[kWaveDataBuckets];
+  waveform_resample(peaks.data(), int32_t(peaks.size()), buckets, kWaveDataBuckets);
+  auto packed_size = waveform_packed_size(kWaveDataBuckets);
+  auto *packed = static_cast<uint8_t *>(malloc(packed_size));
+  waveform_pack(buckets, kWaveDataBuckets, packed);
 
-  *result = intensities;
-  *size = number_of_waveform_intensities;
+  *result = packed;
+  *size = packed_size;
 
 }
 
 }
 
 void *ogg_opus_recorder_create(const char *file_path, int64_t send_port) {
-  auto *recoder = new SdlOggOpusRecorder();
+  auto *recoder = new SdlOggOpusRecorder(send_port);
   if (recoder->Init(file_path) < 0) {
     delete recoder;
     return nullptr;
@@ -271,3 +605,59 @@ double ogg_opus_recorder_get_duration(void *recoder) {
   auto *sdl_recoder = static_cast<SdlOggOpusRecorder *>(recoder);
   return sdl_recoder->GetDuration();
 }
+
+double ogg_opus_recorder_get_encoded_duration(void *recoder) {
+  if (!recoder) {
+    return 0;
+  }
+  auto *sdl_recoder = static_cast<SdlOggOpusRecorder *>(recoder);
+  return sdl_recoder->GetEncodedDuration();
+}
+
+void ogg_opus_recorder_get_buffer_stats(void *recoder, int64_t *high_water_mark, int64_t *overrun_count) {
+  if (!recoder) {
+    return;
+  }
+  auto *sdl_recoder = static_cast<SdlOggOpusRecorder *>(recoder);
+  sdl_recoder->GetBufferStats(high_water_mark, overrun_count);
+}
+
+void ogg_opus_recorder_set_progress_interval(void *recoder, int32_t interval_ms) {
+  if (!recoder) {
+    return;
+  }
+  auto *sdl_recoder = static_cast<SdlOggOpusRecorder *>(recoder);
+  sdl_recoder->SetProgressInterval(interval_ms);
+}
+
+void ogg_opus_recorder_set_loudness_target(void *recoder, double target_lufs) {
+  if (!recoder) {
+    return;
+  }
+  auto *sdl_recoder = static_cast<SdlOggOpusRecorder *>(recoder);
+  sdl_recoder->SetLoudnessTarget(target_lufs);
+}
+
+double ogg_opus_recorder_get_loudness(void *recoder) {
+  if (!recoder) {
+    return -HUGE_VAL;
+  }
+  auto *sdl_recoder = static_cast<SdlOggOpusRecorder *>(recoder);
+  return sdl_recoder->GetLoudness();
+}
+
+void ogg_opus_recorder_enable_page_stream(void *recoder, int32_t max_page_delay_ms) {
+  if (!recoder) {
+    return;
+  }
+  auto *sdl_recoder = static_cast<SdlOggOpusRecorder *>(recoder);
+  sdl_recoder->EnablePageStream(max_page_delay_ms);
+}
+
+void ogg_opus_recorder_enable_voice_activity_detection(void *recoder, int32_t max_pause_ms) {
+  if (!recoder) {
+    return;
+  }
+  auto *sdl_recoder = static_cast<SdlOggOpusRecorder *>(recoder);
+  sdl_recoder->EnableVoiceActivityDetection(max_pause_ms);
+}
@@ -17,6 +17,8 @@ extern "C" {
 #define FFI_PLUGIN_EXPORT
 #endif
 
+// Create a recorder which writes to `file_path`. `file_path` may be null if
+// the pages are only streamed, see ogg_opus_recorder_enable_page_stream.
 FFI_PLUGIN_EXPORT void *ogg_opus_recorder_create(const char *file_path, int64_t send_port);
 
 FFI_PLUGIN_EXPORT void ogg_opus_recorder_start(void *recoder);
@@ -25,10 +27,62 @@ FFI_PLUGIN_EXPORT void ogg_opus_recorder_stop(void *recoder);
 
 FFI_PLUGIN_EXPORT void ogg_opus_recorder_destroy(void *recoder);
 
+// The waveform of the recording, 100 peaks packed into 5 bits each like on
+// Android.
 FFI_PLUGIN_EXPORT void ogg_opus_recorder_get_wave_data(void *recoder, uint8_t **wave_data, int64_t *wave_data_length);
 
+// The recorded duration in seconds, including silence which is not encoded.
 FFI_PLUGIN_EXPORT double ogg_opus_recorder_get_duration(void *recoder);
 
+// The duration of the encoded audio in seconds, which is the duration of the
+// file.
+FFI_PLUGIN_EXPORT double ogg_opus_recorder_get_encoded_duration(void *recoder);
+
+// Post recording progress to the send_port of ogg_opus_recorder_create every
+// `interval_ms` milliseconds of recorded audio. 0 (the default) disables it.
+//
+// Each progress is a list of [0, recorded duration in seconds, rms level, peak
+// level, Int16List of the waveform samples encoded since the previous
+// progress, encoded duration in seconds], levels are in the range of 0.0 to
+// 1.0. Progress is posted while silence is held back too.
+FFI_PLUGIN_EXPORT void ogg_opus_recorder_set_progress_interval(void *recoder, int32_t interval_ms);
+
+// Stats of the buffer between the capture callback and the encoder thread.
+// high_water_mark: the max number of samples waiting to be encoded.
+// overrun_count: the number of capture callbacks which dropped samples because
+// the buffer was full.
+FFI_PLUGIN_EXPORT void ogg_opus_recorder_get_buffer_stats(void *recoder, int64_t *high_water_mark,
+                                                          int64_t *overrun_count);
+
+// Measure the EBU R128 integrated loudness while recording, and when stopped
+// set the OpusHead output gain of the file to bring it to `target_lufs`, e.g.
+// -23. Decoders apply the gain, the audio itself is not changed. Must be
+// called before ogg_opus_recorder_start.
+FFI_PLUGIN_EXPORT void ogg_opus_recorder_set_loudness_target(void *recoder, double target_lufs);
+
+// The integrated loudness of the recording in LUFS, after it is stopped. -inf
+// if it was not measured, or the recording is too short or silent.
+FFI_PLUGIN_EXPORT double ogg_opus_recorder_get_loudness(void *recoder);
+
+// Post every ogg page to the send_port of ogg_opus_recorder_create as soon as
+// it is complete, as a list of [1, Uint8List page], and [2] after the last
+// page. A page is completed at least every `max_page_delay_ms` of audio. The
+// pages are also written to the file, if any. Must be called before
+// ogg_opus_recorder_start.
+//
+// The first page is posted before the loudness gain is known. If it is
+// measured, see ogg_opus_recorder_set_loudness_target, the first page with the
+// gain is posted as [3, Uint8List page] before [2], and consumers must replace
+// the first page they received with it to match the file.
+FFI_PLUGIN_EXPORT void ogg_opus_recorder_enable_page_stream(void *recoder, int32_t max_page_delay_ms);
+
+// Detect speech while recording: silence before the first and after the last
+// speech is not encoded, and pauses longer than `max_pause_ms` are shortened
+// to it, unless it is 0. The silence which is kept is encoded with Opus DTX.
+// The encoded duration and the waveform only cover the encoded audio. Must be
+// called before ogg_opus_recorder_start.
+FFI_PLUGIN_EXPORT void ogg_opus_recorder_enable_voice_activity_detection(void *recoder, int32_t max_pause_ms);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,412 @@
+#include "ogg_opus_render.h"
+
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "ogg/opusenc.h"
+
+#include "ogg_opus_reader.h"
+#include "ogg_opus_utils.h"
+#include "sonic.h"
+
+namespace {
+
+const int kSampleRate = 48000;
+
+// samples per channel decoded per chunk, the longest opus packet.
+const int kDecodeChunkSamples = 5760;
+
+// chunks buffered between two pipeline stages.
+const size_t kPipelineQueueSize = 16;
+
+typedef std::vector<opus_int16> PcmChunk;
+
+class RenderSink {
+ public:
+  virtual ~RenderSink();
+
+  virtual int Open(const char *path, int channels, int bitrate) = 0;
+
+  // Write `samples` samples per channel of interleaved pcm.
+  virtual int Write(const opus_int16 *data, int samples) = 0;
+
+  // Finish the file. No more Write after this.
+  virtual int Close() = 0;
+};
+
+RenderSink::~RenderSink() = default;
+
+class WavSink : public RenderSink {
+
+ public:
+  ~WavSink() override;
+
+  int Open(const char *path, int channels, int bitrate) override;
+
+  int Write(const opus_int16 *data, int samples) override;
+
+  int Close() override;
+
+ private:
+  FILE *file_ = nullptr;
+  int channels_ = 0;
+  uint32_t data_bytes_ = 0;
+
+  bool WriteHeader();
+
+};
+
+WavSink::~WavSink() {
+  if (file_) {
+    fclose(file_);
+  }
+}
+
+int WavSink::Open(const char *path, int channels, int bitrate) {
+  file_ = open_file(path, "wb");
+  if (!file_) {
+    return OGG_OPUS_RENDER_ERROR_OPEN_OUTPUT;
+  }
+  channels_ = channels;
+  // the sizes are patched in Close().
+  return WriteHeader() ? 0 : OGG_OPUS_RENDER_ERROR_WRITE;
+}
+
+bool WavSink::WriteHeader() {
+  uint8_t header[44];
+  auto put32 = [&](int offset, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+      header[offset + i] = uint8_t(value >> (i * 8));
+    }
+  };
+  auto put16 = [&](int offset, uint16_t value) {
+    header[offset] = uint8_t(value);
+    header[offset + 1] = uint8_t(value >> 8);
+  };
+  memcpy(header, "RIFF", 4);
+  put32(4, 36 + data_bytes_);
+  memcpy(header + 8, "WAVEfmt ", 8);
+  put32(16, 16);
+  put16(20, 1); // pcm
+  put16(22, uint16_t(channels_));
+  put32(24, kSampleRate);
+  put32(28, kSampleRate * channels_ * 2);
+  put16(32, uint16_t(channels_ * 2));
+  put16(34, 16);
+  memcpy(header + 36, "data", 4);
+  put32(40, data_bytes_);
+  return fwrite(header, sizeof(header), 1, file_) == 1;
+}
+
+int WavSink::Write(const opus_int16 *data, int samples) {
+  auto count = size_t(samples) * channels_;
+  // wav is little endian, like every platform this plugin runs on.
+  if (fwrite(data, sizeof(opus_int16), count, file_) != count) {
+    return OGG_OPUS_RENDER_ERROR_WRITE;
+  }
+  data_bytes_ += uint32_t(count * sizeof(opus_int16));
+  return 0;
+}
+
+int WavSink::Close() {
+  auto ok = fseek(file_, 0, SEEK_SET) == 0 && WriteHeader();
+  ok = fclose(file_) == 0 && ok;
+  file_ = nullptr;
+  return ok ? 0 : OGG_OPUS_RENDER_ERROR_WRITE;
+}
+
+class OpusSink : public RenderSink {
+
+ public:
+  ~OpusSink() override;
+
+  int Open(const char *path, int channels, int bitrate) override;
+
+  int Write(const opus_int16 *data, int samples) override;
+
+  int Close() override;
+
+ private:
+  OggOpusComments *comments_ = nullptr;
+  OggOpusEnc *encoder_ = nullptr;
+
+};
+
+OpusSink::~OpusSink() {
+  if (encoder_) {
+    ope_encoder_destroy(encoder_);
+  }
+  if (comments_) {
+    ope_comments_destroy(comments_);
+  }
+}
+
+int OpusSink::Open(const char *path, int channels, int bitrate) {
+  comments_ = ope_comments_create();
+  if (!comments_) {
+    return OGG_OPUS_RENDER_ERROR_OPEN_OUTPUT;
+  }
+  int error = OPE_OK;
+  encoder_ = ope_encoder_create_file(path, comments_, kSampleRate, channels, channels > 2 ? 1 : 0, &error);
+  if (error != OPE_OK || !encoder_) {
+    encoder_ = nullptr;
+    return OGG_OPUS_RENDER_ERROR_OPEN_OUTPUT;
+  }
+  // keep voice notes as small as the original, instead of the encoder default.
+  if (bitrate > 0) {
+    ope_encoder_ctl(encoder_, OPUS_SET_BITRATE_REQUEST, bitrate);
+  }
+  return 0;
+}
+
+int OpusSink::Write(const opus_int16 *data, int samples) {
+  return ope_encoder_write(encoder_, data, samples) == OPE_OK ? 0 : OGG_OPUS_RENDER_ERROR_WRITE;
+}
+
+int OpusSink::Close() {
+  auto error = ope_encoder_drain(encoder_);
+  ope_encoder_destroy(encoder_);
+  encoder_ = nullptr;
+  return error == OPE_OK ? 0 : OGG_OPUS_RENDER_ERROR_WRITE;
+}
+
+// Changes speed and pitch with sonic, or passes the audio through untouched
+// when both are 1.
+class Stretcher {
+
+ public:
+  Stretcher(int channels, float speed, float pitch);
+
+  ~Stretcher();
+
+  // Process `samples` samples per channel, appending the output to `out`.
+  // Flushes the remaining output if `data` is null.
+  void Process(const opus_int16 *data, int samples, PcmChunk &out);
+
+ private:
+  int channels_;
+  sonicStream stream_ = nullptr;
+
+};
+
+Stretcher::Stretcher(int channels, float speed, float pitch) : channels_(channels) {
+  if (speed != 1.0f || pitch != 1.0f) {
+    stream_ = sonicCreateStream(kSampleRate, channels);
+    sonicSetSpeed(stream_, speed);
+    sonicSetPitch(stream_, pitch);
+  }
+}
+
+Stretcher::~Stretcher() {
+  if (stream_) {
+    sonicDestroyStream(stream_);
+  }
+}
+
+void Stretcher::Process(const opus_int16 *data, int samples, PcmChunk &out) {
+  if (!stream_) {
+    if (data) {
+      out.insert(out.end(), data, data + samples * channels_);
+    }
+    return;
+  }
+  if (data) {
+    sonicWriteShortToStream(stream_, data, samples);
+  } else {
+    sonicFlushStream(stream_);
+  }
+  auto available = sonicSamplesAvailable(stream_);
+  if (available <= 0) {
+    return;
+  }
+  auto offset = out.size();
+  out.resize(offset + size_t(available) * channels_);
+  auto read = sonicReadShortFromStream(stream_, out.data() + offset, available);
+  out.resize(offset + size_t(read) * channels_);
+}
+
+// Bounded queue of pcm chunks between two pipeline stages.
+class ChunkQueue {
+
+ public:
+  // Blocks while the queue is full. Returns false if the queue was cancelled.
+  bool Push(PcmChunk chunk);
+
+  // Blocks while the queue is empty. Returns false once the queue is closed and
+  // drained, or cancelled.
+  bool Pop(PcmChunk &chunk);
+
+  // No more Push, Pop drains what is left.
+  void Close();
+
+  // Stop both sides now, used when a stage fails.
+  void Cancel();
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable changed_;
+  std::deque<PcmChunk> chunks_;
+  bool closed_ = false;
+  bool cancelled_ = false;
+
+};
+
+bool ChunkQueue::Push(PcmChunk chunk) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  changed_.wait(lock, [this] { return cancelled_ || chunks_.size() < kPipelineQueueSize; });
+  if (cancelled_) {
+    return false;
+  }
+  chunks_.push_back(std::move(chunk));
+  changed_.notify_all();
+  return true;
+}
+
+bool ChunkQueue::Pop(PcmChunk &chunk) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  changed_.wait(lock, [this] { return cancelled_ || closed_ || !chunks_.empty(); });
+  if (cancelled_ || chunks_.empty()) {
+    return false;
+  }
+  chunk = std::move(chunks_.front());
+  chunks_.pop_front();
+  changed_.notify_all();
+  return true;
+}
+
+void ChunkQueue::Close() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  closed_ = true;
+  changed_.notify_all();
+}
+
+void ChunkQueue::Cancel() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  cancelled_ = true;
+  changed_.notify_all();
+}
+
+int RenderSequential(OggOpusReader &reader, Stretcher &stretcher, RenderSink &sink) {
+  auto channels = reader.GetChannelCount();
+  PcmChunk pcm(size_t(kDecodeChunkSamples) * channels);
+  PcmChunk out;
+  while (true) {
+    auto read = reader.ReadPcmData(pcm.data(), kDecodeChunkSamples);
+    out.clear();
+    stretcher.Process(read > 0 ? pcm.data() : nullptr, read, out);
+    if (!out.empty()) {
+      auto error = sink.Write(out.data(), int(out.size()) / channels);
+      if (error != 0) {
+        return error;
+      }
+    }
+    if (read <= 0) {
+      return 0;
+    }
+  }
+}
+
+// Decode and time stretch on their own threads while the calling thread
+// encodes, so a render takes as long as the slowest stage instead of the sum.
+int RenderPipelined(OggOpusReader &reader, Stretcher &stretcher, RenderSink &sink) {
+  auto channels = reader.GetChannelCount();
+  ChunkQueue decoded, stretched;
+
+  std::thread decoder([&]() {
+    while (true) {
+      PcmChunk pcm(size_t(kDecodeChunkSamples) * channels);
+      auto read = reader.ReadPcmData(pcm.data(), kDecodeChunkSamples);
+      if (read <= 0) {
+        break;
+      }
+      pcm.resize(size_t(read) * channels);
+      if (!decoded.Push(std::move(pcm))) {
+        return;
+      }
+    }
+    decoded.Close();
+  });
+
+  std::thread stretch([&]() {
+    PcmChunk pcm;
+    while (decoded.Pop(pcm)) {
+      PcmChunk out;
+      stretcher.Process(pcm.data(), int(pcm.size()) / channels, out);
+      if (!out.empty() && !stretched.Push(std::move(out))) {
+        return;
+      }
+    }
+    PcmChunk out;
+    stretcher.Process(nullptr, 0, out);
+    if (!out.empty()) {
+      stretched.Push(std::move(out));
+    }
+    stretched.Close();
+  });
+
+  int error = 0;
+  PcmChunk out;
+  while (stretched.Pop(out)) {
+    error = sink.Write(out.data(), int(out.size()) / channels);
+    if (error != 0) {
+      decoded.Cancel();
+      stretched.Cancel();
+      break;
+    }
+  }
+
+  decoder.join();
+  stretch.join();
+  return error;
+}
+
+}
+
+int32_t ogg_opus_render(const char *in_path, const char *out_path,
+                        double speed, double pitch, int32_t format) {
+  auto pipelined = (format & OGG_OPUS_RENDER_PIPELINED) != 0;
+  format &= ~OGG_OPUS_RENDER_PIPELINED;
+  if (!in_path || !out_path || !(speed > 0) || !(pitch > 0)
+      || (format != OGG_OPUS_RENDER_FORMAT_WAV && format != OGG_OPUS_RENDER_FORMAT_OPUS)) {
+    return OGG_OPUS_RENDER_ERROR_ARGUMENT;
+  }
+
+  OggOpusReader reader(in_path);
+  if (!reader.IsOpen()) {
+    return OGG_OPUS_RENDER_ERROR_OPEN_INPUT;
+  }
+  auto channels = reader.GetChannelCount();
+
+  std::unique_ptr<RenderSink> sink;
+  if (format == OGG_OPUS_RENDER_FORMAT_WAV) {
+    sink = std::make_unique<WavSink>();
+  } else {
+    sink = std::make_unique<OpusSink>();
+  }
+  auto error = sink->Open(out_path, channels, reader.GetBitrate());
+  if (error != 0) {
+    return error;
+  }
+
+  Stretcher stretcher(channels, float(speed), float(pitch));
+  if (pipelined) {
+    error = RenderPipelined(reader, stretcher, *sink);
+  } else {
+    error = RenderSequential(reader, stretcher, *sink);
+  }
+  auto close_error = sink->Close();
+  if (error == 0) {
+    error = close_error;
+  }
+  if (error != 0) {
+    std::cerr << "ogg_opus_render failed: " << error << std::endl;
+  }
+  return error;
+}
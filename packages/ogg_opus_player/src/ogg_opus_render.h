@@ -0,0 +1,42 @@
+#ifndef OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_RENDER_H_
+#define OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_RENDER_H_
+
+#include "stdint.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if _WIN32
+#define FFI_PLUGIN_EXPORT __declspec(dllexport)
+#else
+#define FFI_PLUGIN_EXPORT
+#endif
+
+// 16 bit pcm wav, 48kHz with the channels of the input.
+#define OGG_OPUS_RENDER_FORMAT_WAV 0
+// ogg opus, re-encoded at the bitrate of the input.
+#define OGG_OPUS_RENDER_FORMAT_OPUS 1
+
+// Or-ed into the format: decode, time stretch and encode on separate threads.
+#define OGG_OPUS_RENDER_PIPELINED 0x100
+
+#define OGG_OPUS_RENDER_ERROR_ARGUMENT (-1)
+#define OGG_OPUS_RENDER_ERROR_OPEN_INPUT (-2)
+#define OGG_OPUS_RENDER_ERROR_OPEN_OUTPUT (-3)
+#define OGG_OPUS_RENDER_ERROR_WRITE (-4)
+
+// Decode the ogg opus file at `in_path`, change its speed and pitch and write
+// the result to `out_path` in `format`, as fast as possible and without any
+// audio device. `speed` and `pitch` are factors, 1.0 keeps the original.
+//
+// Blocks until the file is written. Returns 0 on success, or one of the
+// OGG_OPUS_RENDER_ERROR_* values.
+FFI_PLUGIN_EXPORT int32_t ogg_opus_render(const char *in_path, const char *out_path,
+                                          double speed, double pitch, int32_t format);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_RENDER_H_
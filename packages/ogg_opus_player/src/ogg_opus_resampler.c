@@ -0,0 +1,368 @@
+/* Sample rate and channel conversion of 16 bit pcm.  See
+   ogg_opus_resampler.h. */
+
+#include "ogg_opus_resampler.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define RESAMPLER_SIMD_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#define RESAMPLER_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/* Taps of each phase when upsampling, more when downsampling to keep the
+   transition band as narrow relative to the output rate. Multiples of 4 for
+   the vector dot product. */
+#define RESAMPLER_TAPS 64
+#define RESAMPLER_MAX_TAPS 256
+
+/* Cutoff relative to the lower nyquist frequency, the rest is the transition
+   band of the window. */
+#define RESAMPLER_CUTOFF 0.92
+
+struct OggOpusResampler {
+  int32_t in_channels;
+  int32_t out_channels;
+  /* channels of the resampled signal, the fewer of the two. */
+  int32_t channels;
+
+  /* the rate changes by up / down, reduced by their gcd. */
+  int32_t up;
+  int32_t down;
+  int32_t taps;
+  /* `up` phases of `taps` coefficients, each reversed for the dot product
+     with the oldest input sample first. */
+  float *filters;
+
+  /* planar input of every channel, `capacity` frames apart. The first
+     taps - 1 frames are the history of the previous call. */
+  float *input;
+  int32_t capacity;
+  int32_t buffered;
+  /* upsampled index of the next output frame, relative to input[0]. */
+  int64_t position;
+
+  /* interleaved pcm before or after the channel mix. */
+  int16_t *mixed;
+  int32_t mixed_capacity;
+};
+
+static int32_t gcd(int32_t a, int32_t b) {
+  while (b != 0) {
+    int32_t t = a % b;
+    a = b;
+    b = t;
+  }
+  return a;
+}
+
+static int16_t to_int16(float value) {
+  value = value >= 0 ? value + 0.5f : value - 0.5f;
+  if (value > 32767.0f) {
+    return 32767;
+  }
+  if (value < -32768.0f) {
+    return -32768;
+  }
+  return (int16_t) value;
+}
+
+/* Windowed sinc lowpass of taps * up coefficients, split into up phases whose
+   coefficients each sum to about 1. */
+static void design_filters(OggOpusResampler *resampler) {
+  int32_t up = resampler->up;
+  int32_t taps = resampler->taps;
+  int32_t length = up * taps;
+  double center = (length - 1) / 2.0;
+  double cutoff = RESAMPLER_CUTOFF * 0.5 / (up > resampler->down ? up : resampler->down);
+  double sum = 0;
+  int32_t n;
+
+  for (n = 0; n < length; n++) {
+    double x = n - center;
+    double sinc = x == 0 ? 2 * cutoff : sin(2 * M_PI * cutoff * x) / (M_PI * x);
+    double window = 0.42 - 0.5 * cos(2 * M_PI * (n + 0.5) / length) + 0.08 * cos(4 * M_PI * (n + 0.5) / length);
+    double h = sinc * window;
+    /* phase n % up, tap n / up, stored reversed. */
+    resampler->filters[(n % up) * taps + (taps - 1 - n / up)] = (float) h;
+    sum += h;
+  }
+  for (n = 0; n < length; n++) {
+    resampler->filters[n] = (float) (resampler->filters[n] * up / sum);
+  }
+}
+
+OggOpusResampler *ogg_opus_resampler_create(int32_t in_rate, int32_t in_channels,
+                                            int32_t out_rate, int32_t out_channels) {
+  OggOpusResampler *resampler;
+  int32_t divisor;
+
+  if (in_rate <= 0 || out_rate <= 0 || in_channels <= 0 || out_channels <= 0) {
+    return NULL;
+  }
+  resampler = (OggOpusResampler *) calloc(1, sizeof(OggOpusResampler));
+  if (!resampler) {
+    return NULL;
+  }
+  divisor = gcd(in_rate, out_rate);
+  resampler->in_channels = in_channels;
+  resampler->out_channels = out_channels;
+  resampler->channels = in_channels < out_channels ? in_channels : out_channels;
+  resampler->up = out_rate / divisor;
+  resampler->down = in_rate / divisor;
+  if (resampler->up == resampler->down) {
+    return resampler;
+  }
+
+  resampler->taps = RESAMPLER_TAPS * ((resampler->down + resampler->up - 1) / resampler->up);
+  if (resampler->taps > RESAMPLER_MAX_TAPS) {
+    resampler->taps = RESAMPLER_MAX_TAPS;
+  }
+  resampler->filters = (float *) malloc(sizeof(float) * resampler->up * resampler->taps);
+  if (!resampler->filters) {
+    free(resampler);
+    return NULL;
+  }
+  design_filters(resampler);
+  /* silence before the first frame. */
+  resampler->buffered = resampler->taps - 1;
+  resampler->position = (int64_t) (resampler->taps - 1) * resampler->up;
+  return resampler;
+}
+
+void ogg_opus_resampler_destroy(OggOpusResampler *resampler) {
+  if (!resampler) {
+    return;
+  }
+  free(resampler->filters);
+  free(resampler->input);
+  free(resampler->mixed);
+  free(resampler);
+}
+
+int32_t ogg_opus_resampler_max_output(const OggOpusResampler *resampler, int32_t frames) {
+  if (resampler->up == resampler->down) {
+    return frames;
+  }
+  return (int32_t) ((int64_t) frames * resampler->up / resampler->down + 2);
+}
+
+/* Make room for `frames` more planar input frames of every channel. */
+static int reserve_input(OggOpusResampler *resampler, int32_t frames) {
+  int32_t needed = resampler->buffered + frames;
+  float *input;
+  int32_t c;
+
+  if (needed <= resampler->capacity) {
+    return 0;
+  }
+  input = (float *) calloc((size_t) needed * resampler->channels, sizeof(float));
+  if (!input) {
+    return -1;
+  }
+  for (c = 0; c < resampler->channels; c++) {
+    if (resampler->input) {
+      memcpy(input + (size_t) c * needed, resampler->input + (size_t) c * resampler->capacity,
+             sizeof(float) * resampler->buffered);
+    }
+  }
+  free(resampler->input);
+  resampler->input = input;
+  resampler->capacity = needed;
+  return 0;
+}
+
+static int reserve_mixed(OggOpusResampler *resampler, int32_t samples) {
+  int16_t *mixed;
+
+  if (samples <= resampler->mixed_capacity) {
+    return 0;
+  }
+  mixed = (int16_t *) realloc(resampler->mixed, sizeof(int16_t) * samples);
+  if (!mixed) {
+    return -1;
+  }
+  resampler->mixed = mixed;
+  resampler->mixed_capacity = samples;
+  return 0;
+}
+
+/* Resample `frames` interleaved frames of resampler->channels into `out`. */
+static int32_t resample(OggOpusResampler *resampler, const int16_t *in, int32_t frames, int16_t *out) {
+  int32_t channels = resampler->channels;
+  int32_t taps = resampler->taps;
+  int32_t written = 0;
+  int32_t consumed;
+  int32_t c, f;
+
+  if (reserve_input(resampler, frames) != 0) {
+    return 0;
+  }
+  for (c = 0; c < channels; c++) {
+    float *input = resampler->input + (size_t) c * resampler->capacity + resampler->buffered;
+    for (f = 0; f < frames; f++) {
+      input[f] = in[(size_t) f * channels + c];
+    }
+  }
+  resampler->buffered += frames;
+
+  while (resampler->position / resampler->up < resampler->buffered) {
+    int32_t index = (int32_t) (resampler->position / resampler->up);
+    const float *filter = resampler->filters + (resampler->position % resampler->up) * taps;
+    for (c = 0; c < channels; c++) {
+      const float *input = resampler->input + (size_t) c * resampler->capacity + index - (taps - 1);
+      out[(size_t) written * channels + c] = to_int16(ogg_opus_dot_product(filter, input, taps));
+    }
+    written++;
+    resampler->position += resampler->down;
+  }
+
+  /* keep the history of the next output frame. */
+  consumed = (int32_t) (resampler->position / resampler->up) - (taps - 1);
+  if (consumed > resampler->buffered) {
+    consumed = resampler->buffered;
+  }
+  if (consumed > 0) {
+    for (c = 0; c < channels; c++) {
+      float *input = resampler->input + (size_t) c * resampler->capacity;
+      memmove(input, input + consumed, sizeof(float) * (resampler->buffered - consumed));
+    }
+    resampler->buffered -= consumed;
+    resampler->position -= (int64_t) consumed * resampler->up;
+  }
+  return written;
+}
+
+int32_t ogg_opus_resampler_process(OggOpusResampler *resampler, const int16_t *in, int32_t frames, int16_t *out) {
+  int32_t written;
+
+  if (frames <= 0) {
+    return 0;
+  }
+  if (resampler->in_channels > resampler->out_channels) {
+    if (reserve_mixed(resampler, frames * resampler->channels) != 0) {
+      return 0;
+    }
+    ogg_opus_mix_channels(in, resampler->in_channels, resampler->mixed, resampler->channels, frames);
+    if (resampler->up == resampler->down) {
+      memcpy(out, resampler->mixed, sizeof(int16_t) * frames * resampler->channels);
+      return frames;
+    }
+    return resample(resampler, resampler->mixed, frames, out);
+  }
+
+  if (resampler->in_channels == resampler->out_channels) {
+    if (resampler->up == resampler->down) {
+      memcpy(out, in, sizeof(int16_t) * frames * resampler->channels);
+      return frames;
+    }
+    return resample(resampler, in, frames, out);
+  }
+
+  if (resampler->up == resampler->down) {
+    ogg_opus_mix_channels(in, resampler->in_channels, out, resampler->out_channels, frames);
+    return frames;
+  }
+  if (reserve_mixed(resampler, ogg_opus_resampler_max_output(resampler, frames) * resampler->channels) != 0) {
+    return 0;
+  }
+  written = resample(resampler, in, frames, resampler->mixed);
+  ogg_opus_mix_channels(resampler->mixed, resampler->channels, out, resampler->out_channels, written);
+  return written;
+}
+
+void ogg_opus_mix_channels(const int16_t *in, int32_t in_channels, int16_t *out, int32_t out_channels, int32_t frames) {
+  int32_t f, c;
+
+  for (f = 0; f < frames; f++) {
+    const int16_t *frame = in + (size_t) f * in_channels;
+    int16_t *mixed = out + (size_t) f * out_channels;
+    if (out_channels == 1) {
+      int32_t sum = 0;
+      for (c = 0; c < in_channels; c++) {
+        sum += frame[c];
+      }
+      mixed[0] = (int16_t) (sum / in_channels);
+    } else if (in_channels == 1) {
+      for (c = 0; c < out_channels; c++) {
+        mixed[c] = c < 2 ? frame[0] : 0;
+      }
+    } else {
+      for (c = 0; c < out_channels; c++) {
+        mixed[c] = c < in_channels ? frame[c] : 0;
+      }
+    }
+  }
+}
+
+float ogg_opus_dot_product_scalar(const float *a, const float *b, int32_t count) {
+  float sum = 0;
+  int32_t i;
+
+  for (i = 0; i < count; i++) {
+    sum += a[i] * b[i];
+  }
+  return sum;
+}
+
+/* The vector versions keep two accumulators to hide the add latency, and
+   finish the tail in scalar code. */
+
+#if RESAMPLER_SIMD_SSE2
+
+float ogg_opus_dot_product(const float *a, const float *b, int32_t count) {
+  __m128 sum0 = _mm_setzero_ps();
+  __m128 sum1 = _mm_setzero_ps();
+  float lanes[4];
+  float sum;
+  int32_t i = 0;
+
+  for (; i + 8 <= count; i += 8) {
+    sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+  }
+  _mm_storeu_ps(lanes, _mm_add_ps(sum0, sum1));
+  sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+  for (; i < count; i++) {
+    sum += a[i] * b[i];
+  }
+  return sum;
+}
+
+#elif RESAMPLER_SIMD_NEON
+
+float ogg_opus_dot_product(const float *a, const float *b, int32_t count) {
+  float32x4_t sum0 = vdupq_n_f32(0);
+  float32x4_t sum1 = vdupq_n_f32(0);
+  float lanes[4];
+  float sum;
+  int32_t i = 0;
+
+  for (; i + 8 <= count; i += 8) {
+    sum0 = vmlaq_f32(sum0, vld1q_f32(a + i), vld1q_f32(b + i));
+    sum1 = vmlaq_f32(sum1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+  }
+  vst1q_f32(lanes, vaddq_f32(sum0, sum1));
+  sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+  for (; i < count; i++) {
+    sum += a[i] * b[i];
+  }
+  return sum;
+}
+
+#else
+
+float ogg_opus_dot_product(const float *a, const float *b, int32_t count) {
+  return ogg_opus_dot_product_scalar(a, b, count);
+}
+
+#endif
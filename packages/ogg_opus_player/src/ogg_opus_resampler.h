@@ -0,0 +1,53 @@
+/* Sample rate and channel conversion of 16 bit pcm, for audio devices which
+   do not open at the 48kHz and the channel count of the decoded file.
+
+   Channels are mixed first when the device has fewer of them, and last when
+   it has more, so the resampler always runs on the fewest channels. The
+   resampler is a polyphase windowed sinc filter whose dot products use SSE2
+   or NEON where available.
+*/
+
+#ifndef OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_RESAMPLER_H_
+#define OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_RESAMPLER_H_
+
+#include "stdint.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct OggOpusResampler OggOpusResampler;
+
+/* Returns null if a rate or a channel count is not positive. */
+OggOpusResampler *ogg_opus_resampler_create(int32_t in_rate, int32_t in_channels,
+                                            int32_t out_rate, int32_t out_channels);
+
+void ogg_opus_resampler_destroy(OggOpusResampler *resampler);
+
+/* Most frames ogg_opus_resampler_process writes for `frames` input frames. */
+int32_t ogg_opus_resampler_max_output(const OggOpusResampler *resampler, int32_t frames);
+
+/* Convert `frames` interleaved input frames into `out`, which must hold
+   ogg_opus_resampler_max_output(resampler, frames) output frames. Returns the
+   number of frames written. The filter delays the output by a few samples,
+   which are kept until the next call. Only allocates when `frames` is larger
+   than in any call before. */
+int32_t ogg_opus_resampler_process(OggOpusResampler *resampler, const int16_t *in, int32_t frames, int16_t *out);
+
+/* Mix `frames` interleaved frames of `in_channels` into `out_channels`. Mono
+   is the average of all channels, mono is copied to the first two channels of
+   more, and otherwise shared channels are copied, extra input channels are
+   dropped and extra output channels are silent. */
+void ogg_opus_mix_channels(const int16_t *in, int32_t in_channels, int16_t *out, int32_t out_channels, int32_t frames);
+
+/* Dot product of `count` floats, with SSE2 or NEON where available. */
+float ogg_opus_dot_product(const float *a, const float *b, int32_t count);
+
+/* The plain C version of ogg_opus_dot_product, for tests and benchmarks. */
+float ogg_opus_dot_product_scalar(const float *a, const float *b, int32_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_RESAMPLER_H_ */
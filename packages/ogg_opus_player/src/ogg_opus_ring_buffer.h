@@ -0,0 +1,72 @@
+#ifndef OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_RING_BUFFER_H_
+#define OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_RING_BUFFER_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <vector>
+
+// Lock free ring buffer for exactly one producer thread and one consumer
+// thread, e.g. an audio callback and a worker thread. Never allocates after
+// construction.
+template<typename T>
+class SpscRingBuffer {
+
+ public:
+  // capacity is rounded up to a power of two.
+  explicit SpscRingBuffer(size_t capacity) {
+    size_t size = 1;
+    while (size < capacity) {
+      size <<= 1;
+    }
+    buffer_.resize(size);
+    mask_ = size - 1;
+  }
+
+  size_t Capacity() const { return buffer_.size(); }
+
+  // number of items available to read.
+  size_t Size() const {
+    return write_index_.load(std::memory_order_acquire) - read_index_.load(std::memory_order_acquire);
+  }
+
+  // number of items which can be written. Only grows until the producer
+  // writes, so it is exact on the producer thread.
+  size_t Space() const { return Capacity() - Size(); }
+
+  // Called from the producer thread. Writes as many items as fit and returns
+  // that count.
+  size_t Write(const T *data, size_t count) {
+    auto write = write_index_.load(std::memory_order_relaxed);
+    auto read = read_index_.load(std::memory_order_acquire);
+    count = std::min(count, Capacity() - (write - read));
+    auto offset = write & mask_;
+    auto first = std::min(count, Capacity() - offset);
+    memcpy(buffer_.data() + offset, data, first * sizeof(T));
+    memcpy(buffer_.data(), data + first, (count - first) * sizeof(T));
+    write_index_.store(write + count, std::memory_order_release);
+    return count;
+  }
+
+  // Called from the consumer thread. Reads up to `count` items and returns
+  // the number read.
+  size_t Read(T *data, size_t count) {
+    auto read = read_index_.load(std::memory_order_relaxed);
+    auto write = write_index_.load(std::memory_order_acquire);
+    count = std::min(count, write - read);
+    auto offset = read & mask_;
+    auto first = std::min(count, Capacity() - offset);
+    memcpy(data, buffer_.data() + offset, first * sizeof(T));
+    memcpy(data + first, buffer_.data(), (count - first) * sizeof(T));
+    read_index_.store(read + count, std::memory_order_release);
+    return count;
+  }
+
+ private:
+  std::vector<T> buffer_;
+  size_t mask_ = 0;
+  std::atomic<size_t> write_index_{0};
+  std::atomic<size_t> read_index_{0};
+};
+
+#endif //OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_RING_BUFFER_H_
@@ -0,0 +1,232 @@
+#include "ogg_opus_stream_encoder.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "ogg/opusenc.h"
+
+#include "ogg_opus_ring_buffer.h"
+#include "ogg_opus_waveform_core.h"
+
+namespace {
+
+// samples encoded per ope_encoder_write call on the worker.
+const int kEncodeChunkSamples = 1920;
+
+// samples reduced to one waveform peak.
+const int kWaveformBucketSamples = 100;
+
+class StreamEncoder {
+
+ public:
+  StreamEncoder(int sample_rate, int channels);
+
+  ~StreamEncoder();
+
+  int Open(const char *path, int bitrate);
+
+  int Write(const int16_t *samples, int frames);
+
+  int Finish();
+
+  int Waveform(int buckets, uint8_t *out) const;
+
+ private:
+  int sample_rate_;
+  int channels_;
+  OggOpusComments *comments_ = nullptr;
+  OggOpusEnc *encoder_ = nullptr;
+
+  // written by the capture thread, read by worker_.
+  SpscRingBuffer<int16_t> ring_;
+  std::mutex mutex_;
+  std::condition_variable signal_;
+  std::thread worker_;
+  std::atomic<bool> running_{false};
+  std::atomic<bool> finished_{false};
+  int error_ = 0;
+  // frames which did not fit in ring_.
+  int64_t dropped_frames_ = 0;
+
+  std::vector<uint16_t> waveform_peaks_;
+  WaveformBuilder waveform_builder_{};
+
+  void EncodeLoop();
+
+  void Encode(const int16_t *samples, int count);
+
+};
+
+StreamEncoder::StreamEncoder(int sample_rate, int channels)
+    : sample_rate_(sample_rate), channels_(channels), ring_(size_t(sample_rate) * channels * 4) {
+  waveform_builder_init(&waveform_builder_, kWaveformBucketSamples * channels);
+}
+
+StreamEncoder::~StreamEncoder() {
+  Finish();
+}
+
+int StreamEncoder::Open(const char *path, int bitrate) {
+  comments_ = ope_comments_create();
+  if (!comments_) {
+    return OGG_OPUS_STREAM_ENCODER_ERROR_OPEN;
+  }
+  int error = OPE_OK;
+  encoder_ = ope_encoder_create_file(path, comments_, sample_rate_, channels_, channels_ > 2 ? 1 : 0, &error);
+  if (error != OPE_OK || !encoder_) {
+    encoder_ = nullptr;
+    return OGG_OPUS_STREAM_ENCODER_ERROR_OPEN;
+  }
+  if (bitrate > 0 && ope_encoder_ctl(encoder_, OPUS_SET_BITRATE_REQUEST, bitrate) != OPE_OK) {
+    return OGG_OPUS_STREAM_ENCODER_ERROR_OPEN;
+  }
+  running_ = true;
+  worker_ = std::thread(&StreamEncoder::EncodeLoop, this);
+  return 0;
+}
+
+int StreamEncoder::Write(const int16_t *samples, int frames) {
+  if (!running_) {
+    return OGG_OPUS_STREAM_ENCODER_ERROR_FINISHED;
+  }
+  // whole frames only, so that the worker never reads half of one.
+  auto fit = std::min(size_t(frames), ring_.Space() / channels_);
+  auto written = ring_.Write(samples, fit * channels_);
+  if (fit < size_t(frames)) {
+    dropped_frames_ += frames - int64_t(fit);
+  }
+  {
+    // the worker is either waiting or yet to check the ring, the wakeup is
+    // never lost.
+    std::lock_guard<std::mutex> lock(mutex_);
+  }
+  signal_.notify_one();
+  return int(written / channels_);
+}
+
+void StreamEncoder::EncodeLoop() {
+  // whole frames only, so that no read splits one.
+  std::vector<int16_t> buffer(size_t(kEncodeChunkSamples) * channels_);
+  while (true) {
+    auto running = running_.load();
+    size_t read;
+    while ((read = ring_.Read(buffer.data(), buffer.size())) > 0) {
+      Encode(buffer.data(), int(read));
+    }
+    if (!running) {
+      break;
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    signal_.wait_for(lock, std::chrono::milliseconds(100), [this] {
+      return ring_.Size() > 0 || !running_;
+    });
+  }
+}
+
+void StreamEncoder::Encode(const int16_t *samples, int count) {
+  if (error_ == 0 && ope_encoder_write(encoder_, samples, count / channels_) != OPE_OK) {
+    error_ = OGG_OPUS_STREAM_ENCODER_ERROR_ENCODE;
+  }
+  auto size = waveform_peaks_.size();
+  waveform_peaks_.resize(size + count / waveform_builder_.bucket_size + 1);
+  auto peaks = waveform_builder_add(&waveform_builder_, samples, count, waveform_peaks_.data() + size);
+  waveform_peaks_.resize(size + peaks);
+}
+
+int StreamEncoder::Finish() {
+  if (worker_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      running_ = false;
+    }
+    signal_.notify_one();
+    worker_.join();
+  }
+  running_ = false;
+  if (encoder_) {
+    if (ope_encoder_drain(encoder_) != OPE_OK && error_ == 0) {
+      error_ = OGG_OPUS_STREAM_ENCODER_ERROR_ENCODE;
+    }
+    ope_encoder_destroy(encoder_);
+    encoder_ = nullptr;
+  }
+  if (comments_) {
+    ope_comments_destroy(comments_);
+    comments_ = nullptr;
+  }
+  finished_ = true;
+  if (dropped_frames_ > 0) {
+    std::cerr << "stream encoder dropped " << dropped_frames_ << " frames" << std::endl;
+    dropped_frames_ = 0;
+  }
+  return error_;
+}
+
+int StreamEncoder::Waveform(int buckets, uint8_t *out) const {
+  if (!finished_) {
+    return OGG_OPUS_STREAM_ENCODER_ERROR_FINISHED;
+  }
+  std::vector<uint16_t> peaks(waveform_peaks_);
+  // the last partial bucket, the builder itself is left alone.
+  auto builder = waveform_builder_;
+  uint16_t last_peak;
+  if (waveform_builder_flush(&builder, &last_peak)) {
+    peaks.push_back(last_peak);
+  }
+  std::vector<uint16_t> resampled(buckets);
+  waveform_resample(peaks.data(), int32_t(peaks.size()), resampled.data(), buckets);
+  waveform_pack(resampled.data(), buckets, out);
+  return waveform_packed_size(buckets);
+}
+
+}
+
+void *ogg_opus_stream_encoder_create(const char *path, int32_t sample_rate, int32_t channels,
+                                     int32_t bitrate, int32_t *error) {
+  if (!path || sample_rate <= 0 || channels <= 0 || channels > 255) {
+    if (error) {
+      *error = OGG_OPUS_STREAM_ENCODER_ERROR_ARGUMENT;
+    }
+    return nullptr;
+  }
+  auto *encoder = new StreamEncoder(sample_rate, channels);
+  auto result = encoder->Open(path, bitrate);
+  if (error) {
+    *error = result;
+  }
+  if (result != 0) {
+    delete encoder;
+    return nullptr;
+  }
+  return encoder;
+}
+
+int32_t ogg_opus_stream_encoder_write(void *encoder, const int16_t *samples, int32_t frames) {
+  if (!encoder || !samples || frames < 0) {
+    return OGG_OPUS_STREAM_ENCODER_ERROR_ARGUMENT;
+  }
+  return static_cast<StreamEncoder *>(encoder)->Write(samples, frames);
+}
+
+int32_t ogg_opus_stream_encoder_finish(void *encoder) {
+  if (!encoder) {
+    return OGG_OPUS_STREAM_ENCODER_ERROR_ARGUMENT;
+  }
+  return static_cast<StreamEncoder *>(encoder)->Finish();
+}
+
+int32_t ogg_opus_stream_encoder_waveform(void *encoder, int32_t buckets, uint8_t *out) {
+  if (!encoder || buckets <= 0 || !out) {
+    return OGG_OPUS_STREAM_ENCODER_ERROR_ARGUMENT;
+  }
+  return static_cast<StreamEncoder *>(encoder)->Waveform(buckets, out);
+}
+
+void ogg_opus_stream_encoder_destroy(void *encoder) {
+  delete static_cast<StreamEncoder *>(encoder);
+}
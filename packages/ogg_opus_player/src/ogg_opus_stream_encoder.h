@@ -0,0 +1,48 @@
+#ifndef OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_STREAM_ENCODER_H_
+#define OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_STREAM_ENCODER_H_
+
+#include "stdint.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OGG_OPUS_STREAM_ENCODER_ERROR_ARGUMENT (-1)
+#define OGG_OPUS_STREAM_ENCODER_ERROR_OPEN (-2)
+#define OGG_OPUS_STREAM_ENCODER_ERROR_ENCODE (-3)
+#define OGG_OPUS_STREAM_ENCODER_ERROR_FINISHED (-4)
+
+// Ogg opus encoder for pcm pushed by a capture loop, used by the Android
+// recorder. Writing only copies the samples into a ring buffer, they are
+// encoded on a worker thread owned by the encoder. Encoders share no state,
+// any number of them may record at the same time.
+//
+// Returns null on failure, and sets `*error` if it is not null.
+void *ogg_opus_stream_encoder_create(const char *path, int32_t sample_rate, int32_t channels,
+                                     int32_t bitrate, int32_t *error);
+
+// Queue `frames` frames of interleaved pcm. Must always be called from the
+// same thread, and not concurrently with ogg_opus_stream_encoder_finish.
+// Returns the number of frames queued, fewer if the worker fell more than 4
+// seconds behind, or a negative error. Only whole frames are queued, the
+// frames which do not fit are dropped.
+int32_t ogg_opus_stream_encoder_write(void *encoder, const int16_t *samples, int32_t frames);
+
+// Encode everything queued, stop the worker and close the file. Returns 0, or
+// the first error of the worker.
+int32_t ogg_opus_stream_encoder_finish(void *encoder);
+
+// Pack the waveform of the encoded audio into `buckets` 5 bit values, see
+// ogg_opus_waveform_core.h. `out` must hold `buckets * 5 / 8 + 1` bytes.
+// Returns the number of bytes written, or a negative error if the encoder is
+// not finished yet.
+int32_t ogg_opus_stream_encoder_waveform(void *encoder, int32_t buckets, uint8_t *out);
+
+// Finish the encoder if needed and free it.
+void ogg_opus_stream_encoder_destroy(void *encoder);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_STREAM_ENCODER_H_
@@ -0,0 +1,59 @@
+#include "ogg_opus_utils.h"
+
+#include <sys/stat.h>
+
+#if _WIN32
+#include <Windows.h>
+#include <string>
+
+namespace {
+
+// 1970-01-01 in FILETIME units.
+const int64_t kUnixEpochFileTime = 116444736000000000;
+
+std::wstring Utf8ToWide(const char *str) {
+  auto length = MultiByteToWideChar(CP_UTF8, 0, str, -1, nullptr, 0);
+  if (length <= 0) {
+    return {};
+  }
+  std::wstring wide(length, L'\0');
+  MultiByteToWideChar(CP_UTF8, 0, str, -1, &wide[0], length);
+  return wide;
+}
+
+}
+#endif
+
+bool get_file_stat(const char *path, int64_t *mtime, int64_t *size) {
+#if _WIN32
+  // _stat64 only has whole seconds, the last write time is in 100ns units
+  // since 1601, which overflow as nanoseconds unless rebased to 1970 first.
+  WIN32_FILE_ATTRIBUTE_DATA data;
+  if (!GetFileAttributesExW(Utf8ToWide(path).c_str(), GetFileExInfoStandard, &data)) {
+    return false;
+  }
+  auto ticks = (int64_t(data.ftLastWriteTime.dwHighDateTime) << 32) | data.ftLastWriteTime.dwLowDateTime;
+  *mtime = (ticks - kUnixEpochFileTime) * 100;
+  *size = (int64_t(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+#else
+  struct stat st{};
+  if (stat(path, &st) != 0) {
+    return false;
+  }
+#if __APPLE__
+  *mtime = int64_t(st.st_mtimespec.tv_sec) * 1000000000 + st.st_mtimespec.tv_nsec;
+#else
+  *mtime = int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+  *size = int64_t(st.st_size);
+#endif
+  return true;
+}
+
+FILE *open_file(const char *path, const char *mode) {
+#if _WIN32
+  return _wfopen(Utf8ToWide(path).c_str(), Utf8ToWide(mode).c_str());
+#else
+  return fopen(path, mode);
+#endif
+}
@@ -5,7 +5,17 @@
 #ifndef OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_UTILS_H_
 #define OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_UTILS_H_
 
+#include <cstdint>
+#include <cstdio>
 
 void global_init_sdl2();
 
+// Get the last modification time (in nanoseconds, as precise as the file
+// system keeps it) and size (in bytes) of the file at utf-8 encoded `path`.
+// Returns false if the file can not be accessed.
+bool get_file_stat(const char *path, int64_t *mtime, int64_t *size);
+
+// fopen with an utf-8 encoded `path` on every platform.
+FILE *open_file(const char *path, const char *mode);
+
 #endif //OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_UTILS_H_
@@ -0,0 +1,62 @@
+#include "ogg_opus_vad.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// frames in the noise floor window, 1.5 seconds.
+const size_t kNoiseWindowFrames = 75;
+
+// frames held as speech after the last loud one, 300ms.
+const int kHangoverFrames = 15;
+
+// quieter frames are never speech.
+const double kMinSpeechDb = -55.0;
+
+// voiced speech is this much louder than the noise floor.
+const double kSpeechMarginDb = 10.0;
+
+// fricatives are quieter, but cross zero often.
+const double kFricativeMarginDb = 5.0;
+const double kFricativeZcr = 0.3;
+
+}
+
+VoiceActivityDetector::VoiceActivityDetector(int sample_rate)
+    : frame_size_(std::max(1, sample_rate / 50)), energies_(kNoiseWindowFrames, 0.0) {
+}
+
+bool VoiceActivityDetector::Process(const int16_t *frame) {
+  double square_sum = 0;
+  int crossings = 0;
+  for (int i = 0; i < frame_size_; ++i) {
+    double sample = frame[i];
+    square_sum += sample * sample;
+    if (i > 0 && (frame[i] < 0) != (frame[i - 1] < 0)) {
+      crossings++;
+    }
+  }
+  auto energy_db = 10.0 * std::log10(square_sum / frame_size_ / (32768.0 * 32768.0) + 1e-10);
+  auto zcr = frame_size_ > 1 ? double(crossings) / (frame_size_ - 1) : 0.0;
+
+  energies_[frame_count_ % kNoiseWindowFrames] = energy_db;
+  frame_count_++;
+  auto filled = std::min(frame_count_, kNoiseWindowFrames);
+  // speech right from the start is taken for noise until its first gap, the
+  // recorder keeps some audio before the first speech for that.
+  auto noise_db = *std::min_element(energies_.begin(), energies_.begin() + long(filled));
+
+  auto loud = energy_db > kMinSpeechDb
+      && (energy_db > noise_db + kSpeechMarginDb
+          || (energy_db > noise_db + kFricativeMarginDb && zcr > kFricativeZcr));
+  if (loud) {
+    hangover_ = kHangoverFrames;
+    return true;
+  }
+  if (hangover_ > 0) {
+    hangover_--;
+    return true;
+  }
+  return false;
+}
@@ -0,0 +1,32 @@
+#ifndef OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_VAD_H_
+#define OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_VAD_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Voice activity detector for mono pcm, from the energy and the zero crossing
+// rate of 20ms frames. The noise floor is the quietest frame of the last
+// 1.5 seconds, and speech is held for 300ms after it fades, so the gaps
+// between words are not cut.
+class VoiceActivityDetector {
+
+ public:
+  explicit VoiceActivityDetector(int sample_rate);
+
+  // number of samples in one frame.
+  int FrameSize() const { return frame_size_; }
+
+  // Classify the next frame of FrameSize() samples. Returns true for speech.
+  bool Process(const int16_t *frame);
+
+ private:
+  int frame_size_;
+  // energy in dBFS of the recent frames, to track the noise floor.
+  std::vector<double> energies_;
+  size_t frame_count_ = 0;
+  int hangover_ = 0;
+
+};
+
+#endif //OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_VAD_H_
@@ -0,0 +1,168 @@
+#include "ogg_opus_waveform.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "ogg/opusfile.h"
+
+#include "ogg_opus_parallel.h"
+#include "ogg_opus_waveform_core.h"
+
+namespace {
+
+// Files shorter than this are decoded by a single worker. Longer ones are
+// split into segments of about this length which are decoded in parallel.
+const int64_t kMinSegmentSamples = 48000 * 15;
+
+// op_read never returns more than 120ms of audio per channel.
+const int kReadBufferSamples = 5760 * 2;
+
+inline int64_t BucketStart(int64_t total, int buckets, int bucket) {
+  return total * bucket / buckets;
+}
+
+struct WaveformJob {
+  const char *path = nullptr;
+  // the file opened while probing the length, reused by the first segment.
+  OggOpusFile *head_file = nullptr;
+  int64_t total_samples = 0;
+  int segment_count = 0;
+  std::atomic<bool> failed{false};
+  std::vector<uint16_t> peaks;
+};
+
+struct SegmentTask {
+  WaveformJob *job;
+  int first_bucket;
+  int end_bucket;
+};
+
+// Decode the buckets [first_bucket, end_bucket) of `file` into `peaks`.
+// Every bucket holds the max absolute sample value of all channels in it.
+bool DecodeSegment(OggOpusFile *file, const WaveformJob &job, int buckets,
+                   int first_bucket, int end_bucket, uint16_t *peaks) {
+  auto total = job.total_samples;
+  auto position = BucketStart(total, buckets, first_bucket);
+  auto end = BucketStart(total, buckets, end_bucket);
+  if (position > 0 && op_pcm_seek(file, position) != 0) {
+    return false;
+  }
+
+  opus_int16 buffer[kReadBufferSamples];
+  auto bucket = first_bucket;
+  auto bucket_end = BucketStart(total, buckets, bucket + 1);
+
+  while (position < end && bucket < end_bucket) {
+    int link = -1;
+    auto frames = op_read(file, buffer, kReadBufferSamples, &link);
+    if (frames == OP_HOLE) {
+      continue;
+    }
+    if (frames < 0) {
+      // a damaged file, not a shorter waveform.
+      return false;
+    }
+    if (frames == 0) {
+      break;
+    }
+    auto channels = op_channel_count(file, link);
+    auto offset = 0;
+    while (offset < frames && bucket < end_bucket) {
+      auto count = int(std::min<int64_t>(frames - offset, bucket_end - position));
+      auto peak = waveform_max_abs(buffer + offset * channels, count * channels);
+      peaks[bucket] = std::max(peaks[bucket], peak);
+      offset += count;
+      position += count;
+      if (position >= bucket_end) {
+        bucket++;
+        bucket_end = BucketStart(total, buckets, bucket + 1);
+      }
+    }
+  }
+  return true;
+}
+
+}
+
+int32_t ogg_opus_waveform_packed_size(int32_t buckets) {
+  return waveform_packed_size(buckets);
+}
+
+int32_t ogg_opus_waveform_batch(const char **paths, int32_t count, int32_t buckets, uint8_t *out) {
+  if (count <= 0 || buckets <= 0 || !paths || !out) {
+    return 0;
+  }
+
+  std::vector<WaveformJob> jobs(count);
+
+  // open every file to learn its length, which decides how to split it.
+  RunParallel(count, [&](size_t i) {
+    auto &job = jobs[i];
+    job.path = paths[i];
+    int error = 0;
+    job.head_file = op_open_file(job.path, &error);
+    if (error != 0 || !job.head_file) {
+      std::cerr << "waveform: open opus file failed " << error << std::endl;
+      job.head_file = nullptr;
+      job.failed = true;
+      return;
+    }
+    job.total_samples = op_pcm_total(job.head_file, -1);
+    if (job.total_samples <= 0) {
+      job.failed = true;
+      return;
+    }
+    auto segments = job.total_samples / kMinSegmentSamples;
+    job.segment_count = int(std::max<int64_t>(1, std::min<int64_t>(segments, buckets)));
+    job.peaks.assign(buckets, 0);
+  });
+
+  std::vector<SegmentTask> tasks;
+  for (auto &job : jobs) {
+    for (int s = 0; s < job.segment_count; ++s) {
+      tasks.push_back({&job, s * buckets / job.segment_count, (s + 1) * buckets / job.segment_count});
+    }
+  }
+
+  // segments cover disjoint buckets, so each one reduces into the peaks of
+  // its file without any locking.
+  RunParallel(tasks.size(), [&](size_t i) {
+    auto &task = tasks[i];
+    auto &job = *task.job;
+    auto *file = job.head_file;
+    if (task.first_bucket != 0) {
+      int error = 0;
+      file = op_open_file(job.path, &error);
+      if (error != 0 || !file) {
+        job.failed = true;
+        return;
+      }
+    }
+    if (!DecodeSegment(file, job, buckets, task.first_bucket, task.end_bucket, job.peaks.data())) {
+      job.failed = true;
+    }
+    if (file != job.head_file) {
+      op_free(file);
+    }
+  });
+
+  auto packed_size = ogg_opus_waveform_packed_size(buckets);
+  int32_t succeed = 0;
+  for (int i = 0; i < count; ++i) {
+    auto &job = jobs[i];
+    if (job.head_file) {
+      op_free(job.head_file);
+    }
+    auto *waveform = out + int64_t(i) * packed_size;
+    if (job.failed) {
+      memset(waveform, 0, packed_size);
+      continue;
+    }
+    waveform_pack(job.peaks.data(), buckets, waveform);
+    succeed++;
+  }
+  return succeed;
+}
@@ -0,0 +1,33 @@
+#ifndef OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_WAVEFORM_H_
+#define OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_WAVEFORM_H_
+
+#include "stdint.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if _WIN32
+#define FFI_PLUGIN_EXPORT __declspec(dllexport)
+#else
+#define FFI_PLUGIN_EXPORT
+#endif
+
+// Size in bytes of one packed waveform with `buckets` 5-bit values.
+FFI_PLUGIN_EXPORT int32_t ogg_opus_waveform_packed_size(int32_t buckets);
+
+// Decode `count` ogg opus files in parallel and write their waveforms to `out`.
+//
+// Each waveform is `buckets` peak values packed as 5 bits each, the same
+// format produced by getWaveform2 on Android. Waveform `i` is written at
+// `out + i * ogg_opus_waveform_packed_size(buckets)`, so `out` must hold
+// `count` of them. The waveform of a file that can not be decoded is all zeros.
+//
+// Returns the number of files decoded successfully.
+FFI_PLUGIN_EXPORT int32_t ogg_opus_waveform_batch(const char **paths, int32_t count, int32_t buckets, uint8_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_WAVEFORM_H_
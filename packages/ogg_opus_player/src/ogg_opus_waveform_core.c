@@ -0,0 +1,218 @@
+/* Peak waveforms of 16 bit pcm.  See ogg_opus_waveform_core.h. */
+
+#include "ogg_opus_waveform_core.h"
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define WAVEFORM_SIMD_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#define WAVEFORM_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+/* Normalization of waveform_pack. */
+#define WAVEFORM_PEAK_FACTOR 1.8f
+#define WAVEFORM_MIN_PEAK 2500
+
+/* max(max, -min) without overflowing on -32768. */
+static uint16_t abs_peak(int32_t max, int32_t min) {
+  int32_t peak = max > -min ? max : -min;
+  return (uint16_t) (peak > 32767 ? 32767 : peak);
+}
+
+uint16_t waveform_max_abs_scalar(const int16_t *samples, int32_t count) {
+  int32_t max = 0;
+  int32_t min = 0;
+  int32_t i;
+
+  for (i = 0; i < count; i++) {
+    int32_t sample = samples[i];
+    max = sample > max ? sample : max;
+    min = sample < min ? sample : min;
+  }
+  return abs_peak(max, min);
+}
+
+/* The vector versions track the max and the min separately, which needs no
+   abs instruction and can not overflow, and finish the tail in scalar code. */
+
+#if WAVEFORM_SIMD_SSE2
+
+uint16_t waveform_max_abs(const int16_t *samples, int32_t count) {
+  __m128i max0 = _mm_setzero_si128();
+  __m128i min0 = _mm_setzero_si128();
+  __m128i max1 = _mm_setzero_si128();
+  __m128i min1 = _mm_setzero_si128();
+  int16_t lanes[8];
+  int32_t max = 0;
+  int32_t min = 0;
+  int32_t i = 0;
+
+  for (; i + 16 <= count; i += 16) {
+    __m128i a = _mm_loadu_si128((const __m128i *) (samples + i));
+    __m128i b = _mm_loadu_si128((const __m128i *) (samples + i + 8));
+    max0 = _mm_max_epi16(max0, a);
+    min0 = _mm_min_epi16(min0, a);
+    max1 = _mm_max_epi16(max1, b);
+    min1 = _mm_min_epi16(min1, b);
+  }
+  max0 = _mm_max_epi16(max0, max1);
+  min0 = _mm_min_epi16(min0, min1);
+
+  _mm_storeu_si128((__m128i *) lanes, max0);
+  for (int j = 0; j < 8; j++) {
+    max = lanes[j] > max ? lanes[j] : max;
+  }
+  _mm_storeu_si128((__m128i *) lanes, min0);
+  for (int j = 0; j < 8; j++) {
+    min = lanes[j] < min ? lanes[j] : min;
+  }
+  for (; i < count; i++) {
+    max = samples[i] > max ? samples[i] : max;
+    min = samples[i] < min ? samples[i] : min;
+  }
+  return abs_peak(max, min);
+}
+
+#elif WAVEFORM_SIMD_NEON
+
+uint16_t waveform_max_abs(const int16_t *samples, int32_t count) {
+  int16x8_t max0 = vdupq_n_s16(0);
+  int16x8_t min0 = vdupq_n_s16(0);
+  int16x8_t max1 = vdupq_n_s16(0);
+  int16x8_t min1 = vdupq_n_s16(0);
+  int16_t lanes[8];
+  int32_t max = 0;
+  int32_t min = 0;
+  int32_t i = 0;
+
+  for (; i + 16 <= count; i += 16) {
+    int16x8_t a = vld1q_s16(samples + i);
+    int16x8_t b = vld1q_s16(samples + i + 8);
+    max0 = vmaxq_s16(max0, a);
+    min0 = vminq_s16(min0, a);
+    max1 = vmaxq_s16(max1, b);
+    min1 = vminq_s16(min1, b);
+  }
+  max0 = vmaxq_s16(max0, max1);
+  min0 = vminq_s16(min0, min1);
+
+  vst1q_s16(lanes, max0);
+  for (int j = 0; j < 8; j++) {
+    max = lanes[j] > max ? lanes[j] : max;
+  }
+  vst1q_s16(lanes, min0);
+  for (int j = 0; j < 8; j++) {
+    min = lanes[j] < min ? lanes[j] : min;
+  }
+  for (; i < count; i++) {
+    max = samples[i] > max ? samples[i] : max;
+    min = samples[i] < min ? samples[i] : min;
+  }
+  return abs_peak(max, min);
+}
+
+#else
+
+uint16_t waveform_max_abs(const int16_t *samples, int32_t count) {
+  return waveform_max_abs_scalar(samples, count);
+}
+
+#endif
+
+void waveform_builder_init(WaveformBuilder *builder, int32_t bucket_size) {
+  builder->bucket_size = bucket_size > 0 ? bucket_size : 1;
+  builder->filled = 0;
+  builder->peak = 0;
+}
+
+int32_t waveform_builder_add(WaveformBuilder *builder, const int16_t *samples, int32_t count, uint16_t *peaks) {
+  int32_t written = 0;
+
+  while (count > 0) {
+    int32_t take = builder->bucket_size - builder->filled;
+    uint16_t peak;
+    if (take > count) {
+      take = count;
+    }
+    peak = waveform_max_abs(samples, take);
+    if (peak > builder->peak) {
+      builder->peak = peak;
+    }
+    builder->filled += take;
+    samples += take;
+    count -= take;
+    if (builder->filled == builder->bucket_size) {
+      peaks[written++] = builder->peak;
+      builder->filled = 0;
+      builder->peak = 0;
+    }
+  }
+  return written;
+}
+
+int32_t waveform_builder_flush(WaveformBuilder *builder, uint16_t *peak) {
+  if (builder->filled == 0) {
+    return 0;
+  }
+  *peak = builder->peak;
+  builder->filled = 0;
+  builder->peak = 0;
+  return 1;
+}
+
+void waveform_resample(const uint16_t *peaks, int32_t count, uint16_t *out, int32_t buckets) {
+  int32_t i;
+
+  for (i = 0; i < buckets; i++) {
+    int64_t start = (int64_t) count * i / buckets;
+    int64_t end = (int64_t) count * (i + 1) / buckets;
+    uint16_t peak = 0;
+    if (count == 0) {
+      out[i] = 0;
+      continue;
+    }
+    if (end == start) {
+      /* stretched, the bucket is inside a single peak. */
+      end = start + 1;
+    }
+    for (; start < end; start++) {
+      peak = peaks[start] > peak ? peaks[start] : peak;
+    }
+    out[i] = peak;
+  }
+}
+
+int32_t waveform_packed_size(int32_t buckets) {
+  return buckets * 5 / 8 + 1;
+}
+
+void waveform_pack(const uint16_t *peaks, int32_t buckets, uint8_t *out) {
+  int64_t sum = 0;
+  int32_t peak;
+  int32_t i;
+
+  for (i = 0; i < buckets; i++) {
+    sum += peaks[i];
+  }
+  peak = buckets > 0 ? (int32_t) ((float) sum * WAVEFORM_PEAK_FACTOR / (float) buckets) : 0;
+  if (peak < WAVEFORM_MIN_PEAK) {
+    peak = WAVEFORM_MIN_PEAK;
+  }
+
+  memset(out, 0, (size_t) waveform_packed_size(buckets));
+  for (i = 0; i < buckets; i++) {
+    int32_t sample = peaks[i] < peak ? peaks[i] : peak;
+    int32_t value = sample * 31 / peak;
+    int32_t bit = i * 5;
+    uint8_t *bytes = out + bit / 8;
+    value = value < 31 ? value : 31;
+    /* little endian bit order, a value spans at most two bytes. */
+    bytes[0] |= (uint8_t) (value << (bit % 8));
+    if (bit % 8 > 3) {
+      bytes[1] |= (uint8_t) (value >> (8 - bit % 8));
+    }
+  }
+}
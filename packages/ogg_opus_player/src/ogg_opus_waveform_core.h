@@ -0,0 +1,60 @@
+/* Peak waveforms of 16 bit pcm, shared by the recorders of every platform and
+   the waveform loader.
+
+   Samples are reduced to the max absolute value of fixed size buckets as they
+   arrive, and the peaks are packed into 5 bit values at the end, normalized
+   the way the Android recorder always did: clipped to 1.8x of the average
+   peak, but never below 2500.
+*/
+
+#ifndef OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_WAVEFORM_CORE_H_
+#define OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_WAVEFORM_CORE_H_
+
+#include "stdint.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+  /* samples in one bucket. */
+  int32_t bucket_size;
+  /* samples already in the current bucket. */
+  int32_t filled;
+  uint16_t peak;
+} WaveformBuilder;
+
+/* Max absolute value of `count` samples, clamped to 32767 so that it also
+   fits an int16_t. Uses SSE2 or NEON where available. */
+uint16_t waveform_max_abs(const int16_t *samples, int32_t count);
+
+/* The plain C version of waveform_max_abs, for tests and benchmarks. */
+uint16_t waveform_max_abs_scalar(const int16_t *samples, int32_t count);
+
+void waveform_builder_init(WaveformBuilder *builder, int32_t bucket_size);
+
+/* Add `count` samples, which may end anywhere in a bucket. The peak of every
+   bucket completed is written to `peaks`, which must hold
+   `count / bucket_size + 1` values. Returns the number of peaks written. */
+int32_t waveform_builder_add(WaveformBuilder *builder, const int16_t *samples, int32_t count, uint16_t *peaks);
+
+/* Write the peak of the partly filled bucket, if any, to `peak` and start a
+   new one. Returns the number of peaks written, 0 or 1. */
+int32_t waveform_builder_flush(WaveformBuilder *builder, uint16_t *peak);
+
+/* Reduce `count` peaks to `buckets` peaks, keeping the max of each range.
+   Fewer peaks than buckets are stretched. */
+void waveform_resample(const uint16_t *peaks, int32_t count, uint16_t *out, int32_t buckets);
+
+/* Size in bytes of `buckets` packed 5 bit values. */
+int32_t waveform_packed_size(int32_t buckets);
+
+/* Normalize and pack `buckets` peaks into `out`, which must hold
+   waveform_packed_size(buckets) bytes. */
+void waveform_pack(const uint16_t *peaks, int32_t buckets, uint8_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_WAVEFORM_CORE_H_ */
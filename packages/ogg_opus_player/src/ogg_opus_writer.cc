@@ -0,0 +1,94 @@
+#include "ogg_opus_writer.h"
+
+#include "ogg_opus_utils.h"
+
+int OggOpusWriter::WritePage(void *user_data, const unsigned char *page, opus_int32 length) {
+  auto *writer = static_cast<OggOpusWriter *>(user_data);
+  if (writer->page_callback_) {
+    writer->page_callback_(page, length);
+  }
+  if (writer->file_ && fwrite(page, 1, length, writer->file_) != size_t(length)) {
+    return 1;
+  }
+  return 0;
+}
+
+int OggOpusWriter::CloseStream(void *user_data) {
+  auto *writer = static_cast<OggOpusWriter *>(user_data);
+  if (writer->page_callback_) {
+    writer->page_callback_(nullptr, 0);
+  }
+  if (!writer->file_) {
+    return 0;
+  }
+  auto error = fclose(writer->file_);
+  writer->file_ = nullptr;
+  return error == 0 ? 0 : 1;
+}
+
+int OggOpusWriter::Init(const char *file_name, opus_int32 sample_rate) {
+  if (file_name) {
+    file_ = open_file(file_name, "wb");
+    if (!file_) {
+      return -1;
+    }
+  }
+  auto *comments = ope_comments_create();
+  if (!comments) {
+    return -1;
+  }
+  // libopusenc writes whole pages through these, to the file and to the page
+  // callback if any.
+  static const OpusEncCallbacks callbacks = {&OggOpusWriter::WritePage, &OggOpusWriter::CloseStream};
+  int error = OPE_OK;
+  auto encoder = ope_encoder_create_callbacks(&callbacks, this, comments, sample_rate, 1, 0, &error);
+  if (error != OPE_OK) {
+    ope_comments_destroy(comments);
+    return -1;
+  }
+  error = ope_encoder_ctl(encoder, OPUS_SET_BITRATE_REQUEST, 16 * 1024);
+  if (error != OPE_OK) {
+    ope_encoder_destroy(encoder);
+    ope_comments_destroy(comments);
+    return -1;
+  }
+  comments_ = comments;
+  encoder_ = encoder;
+  return 0;
+}
+
+OggOpusWriter::~OggOpusWriter() {
+  if (encoder_) {
+    ope_encoder_drain(encoder_);
+    ope_encoder_destroy(encoder_);
+  }
+  if (comments_) {
+    ope_comments_destroy(comments_);
+  }
+  if (file_) {
+    fclose(file_);
+  }
+}
+
+void OggOpusWriter::SetPageCallback(OggPageCallback callback, int max_page_delay_ms) {
+  page_callback_ = std::move(callback);
+  if (encoder_ && max_page_delay_ms > 0) {
+    // the muxing delay is counted in 48kHz samples.
+    ope_encoder_ctl(encoder_, OPE_SET_MUXING_DELAY(max_page_delay_ms * 48));
+  }
+}
+
+void OggOpusWriter::SetDtx(bool enabled) {
+  if (encoder_ && dtx_ != enabled) {
+    ope_encoder_ctl(encoder_, OPUS_SET_DTX(enabled ? 1 : 0));
+    dtx_ = enabled;
+  }
+}
+
+int OggOpusWriter::Write(const opus_int16 *data, int size) {
+  if (!encoder_) {
+    return -1;
+  }
+  int error = ope_encoder_write(encoder_, data, size / 2);
+  return error;
+}
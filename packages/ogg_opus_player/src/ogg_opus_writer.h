@@ -0,0 +1,47 @@
+#ifndef OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_WRITER_H_
+#define OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_WRITER_H_
+
+#include <cstdio>
+#include <functional>
+
+#include "ogg/opusenc.h"
+
+// Called with every complete ogg page, and with null once the stream ended.
+typedef std::function<void(const unsigned char *page, int length)> OggPageCallback;
+
+// Encodes mono pcm to ogg opus at 16kbps, for the recorder.
+class OggOpusWriter {
+
+ public:
+  OggOpusWriter() = default;
+
+  // `file_name` may be null to only hand the pages to the page callback.
+  int Init(const char *file_name, int sample_rate);
+
+  // Also hand the pages to `callback`, on the thread which writes or drains.
+  // A page is completed at least every `max_page_delay_ms` of audio. Set it
+  // before the first Write to receive the header pages too.
+  void SetPageCallback(OggPageCallback callback, int max_page_delay_ms);
+
+  // Encode `size` bytes of pcm. Returns 0 or an OPE_* error.
+  int Write(const opus_int16 *data, int size);
+
+  // Opus DTX, which encodes silence in almost no bytes.
+  void SetDtx(bool enabled);
+
+  ~OggOpusWriter();
+
+ private:
+  OggOpusComments *comments_ = nullptr;
+  OggOpusEnc *encoder_ = nullptr;
+  FILE *file_ = nullptr;
+  OggPageCallback page_callback_;
+  bool dtx_ = false;
+
+  static int WritePage(void *user_data, const unsigned char *page, opus_int32 length);
+
+  static int CloseStream(void *user_data);
+
+};
+
+#endif //OGG_OPUS_PLAYER_LIBRARY__OGG_OPUS_WRITER_H_
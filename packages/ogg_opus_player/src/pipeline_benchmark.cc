@@ -0,0 +1,358 @@
+// Benchmark of the whole audio pipeline without a sound card:
+//
+//   1. encodes synthetic voice and stereo fixtures with libopusenc,
+//   2. prints the realtime factor of OggOpusReader::ReadPcmData, of the
+//      resampler to common device formats, of sonic at 0.5x to 3x, and of
+//      OggOpusWriter::Write,
+//   3. runs player and recorder sessions against an sdl driver which needs
+//      no device, and prints the percentiles of the audio callback times, the
+//      xruns (callbacks which played silence before the end of the file, or
+//      dropped captured audio) and the callbacks slower than real time. One
+//      session enables the analysis tap and prints its post rate.
+//
+// Sessions use the sdl `disk` driver unless SDL_AUDIODRIVER is set, e.g. to
+// `dummy`. They run in real time, about a minute in total.
+//
+// Build with -DOGG_OPUS_PLAYER_BUILD_BENCHMARK=ON and run
+// PipelineBenchmark [work directory]. Fixtures are written to the work
+// directory, the current one by default.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ogg/opusenc.h"
+#include "SDL.h"
+
+#include "dart_api_dl.h"
+#include "ogg_opus_callback_timer.h"
+#include "ogg_opus_pcm_cache.h"
+#include "ogg_opus_player.h"
+#include "ogg_opus_reader.h"
+#include "ogg_opus_recorder.h"
+#include "ogg_opus_resampler.h"
+#include "ogg_opus_writer.h"
+#include "sonic.h"
+
+namespace {
+
+const double kFixtureSeconds = 60;
+const double kSessionSeconds = 10;
+
+const Dart_Port_DL kPlayerPort = 1;
+const Dart_Port_DL kRecorderPort = 2;
+
+std::vector<int16_t> VoiceSamples(int sample_rate, int channels, double seconds) {
+  std::mt19937 random(42);
+  std::normal_distribution<double> noise(0, 300);
+  auto frames = int(sample_rate * seconds);
+  std::vector<int16_t> samples(size_t(frames) * channels);
+  double phase = 0;
+  for (int i = 0; i < frames; ++i) {
+    auto t = double(i) / sample_rate;
+    phase += 2 * M_PI * (140 + 60 * std::sin(2 * M_PI * 0.7 * t)) / sample_rate;
+    auto value = 6000 * std::sin(phase) + 3000 * std::sin(2 * phase) + 1500 * std::sin(3 * phase);
+    value *= 0.6 + 0.4 * std::sin(2 * M_PI * 3 * t);
+    for (int c = 0; c < channels; ++c) {
+      samples[size_t(i) * channels + c] = int16_t(std::max(-32768.0, std::min(32767.0, value + noise(random))));
+    }
+  }
+  return samples;
+}
+
+bool EncodeFixture(const std::string &path, const std::vector<int16_t> &samples,
+                   int sample_rate, int channels, int bitrate) {
+  auto *comments = ope_comments_create();
+  int error = OPE_OK;
+  auto *encoder = ope_encoder_create_file(path.c_str(), comments, sample_rate, channels, 0, &error);
+  if (!encoder) {
+    ope_comments_destroy(comments);
+    return false;
+  }
+  ope_encoder_ctl(encoder, OPUS_SET_BITRATE_REQUEST, bitrate);
+  auto frames = int(samples.size()) / channels;
+  error = ope_encoder_write(encoder, samples.data(), frames);
+  if (error == OPE_OK) {
+    error = ope_encoder_drain(encoder);
+  }
+  ope_encoder_destroy(encoder);
+  ope_comments_destroy(comments);
+  return error == OPE_OK;
+}
+
+// Returns the best seconds of a few runs of `body`.
+template<typename Body>
+double Measure(Body body) {
+  double best = 1e9;
+  for (int round = 0; round < 3; ++round) {
+    auto start = std::chrono::steady_clock::now();
+    body();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    best = std::min(best, elapsed.count());
+  }
+  return best;
+}
+
+// Reads the whole file in chunks of 500 samples per channel, like the player.
+std::vector<int16_t> ReadAll(const std::string &path, int *channels) {
+  OggOpusReader reader(path.c_str());
+  *channels = reader.GetChannelCount();
+  std::vector<int16_t> pcm;
+  std::vector<opus_int16> buffer(size_t(500) * *channels);
+  int read;
+  while ((read = reader.ReadPcmData(buffer.data(), 500)) > 0) {
+    pcm.insert(pcm.end(), buffer.begin(), buffer.begin() + read * *channels);
+  }
+  return pcm;
+}
+
+void BenchmarkDecode(const std::string &path, const char *name) {
+  int channels = 1;
+  auto budget = PcmCache::Global().Budget();
+  PcmCache::Global().SetBudget(0);
+  auto decode = Measure([&] { ReadAll(path, &channels); });
+  PcmCache::Global().SetBudget(budget);
+  ReadAll(path, &channels);
+  auto cached = Measure([&] { ReadAll(path, &channels); });
+  printf("%-24s %-10s %11.0fx\n", "decode", name, kFixtureSeconds / decode);
+  printf("%-24s %-10s %11.0fx\n", "decode (cached)", name, kFixtureSeconds / cached);
+}
+
+// Converts the pcm in chunks of 500 frames, like the player.
+void BenchmarkResampler(const std::string &path, const char *name) {
+  int channels = 1;
+  auto pcm = ReadAll(path, &channels);
+  auto frames = int(pcm.size()) / channels;
+  for (int rate : {44100, 96000}) {
+    for (int out_channels : {1, 2}) {
+      std::vector<int16_t> out;
+      auto seconds = Measure([&] {
+        auto *resampler = ogg_opus_resampler_create(48000, channels, rate, out_channels);
+        out.resize(size_t(ogg_opus_resampler_max_output(resampler, 500)) * out_channels);
+        for (int offset = 0; offset < frames; offset += 500) {
+          ogg_opus_resampler_process(resampler, pcm.data() + size_t(offset) * channels,
+                                     std::min(500, frames - offset), out.data());
+        }
+        ogg_opus_resampler_destroy(resampler);
+      });
+      char label[32];
+      snprintf(label, sizeof(label), "resample %d/%d", rate, out_channels);
+      printf("%-24s %-10s %11.0fx\n", label, name, double(frames) / 48000 / seconds);
+    }
+  }
+}
+
+// Runs the pcm through sonic in chunks of 500 frames, reading 1024 frames at
+// a time like the player callback.
+void BenchmarkSonic(const std::string &path, const char *name) {
+  int channels = 1;
+  auto pcm = ReadAll(path, &channels);
+  auto frames = int(pcm.size()) / channels;
+  std::vector<short> buffer(size_t(1024) * channels);
+  for (float speed : {0.5f, 1.0f, 1.5f, 2.0f, 3.0f}) {
+    auto seconds = Measure([&] {
+      auto stream = sonicCreateStream(48000, channels);
+      sonicSetSpeed(stream, speed);
+      for (int offset = 0; offset < frames; offset += 500) {
+        sonicWriteShortToStream(stream, pcm.data() + size_t(offset) * channels, std::min(500, frames - offset));
+        while (sonicReadShortFromStream(stream, buffer.data(), 1024) > 0) {
+        }
+      }
+      sonicFlushStream(stream);
+      while (sonicReadShortFromStream(stream, buffer.data(), 1024) > 0) {
+      }
+      sonicDestroyStream(stream);
+    });
+    char label[32];
+    snprintf(label, sizeof(label), "sonic %.1fx", speed);
+    printf("%-24s %-10s %11.0fx\n", label, name, double(frames) / 48000 / seconds);
+  }
+}
+
+// Encodes 16kHz mono like the recorder, in chunks of its encoder thread.
+void BenchmarkWriter() {
+  auto samples = VoiceSamples(16000, 1, kFixtureSeconds);
+  auto count = int(samples.size());
+  auto seconds = Measure([&] {
+    OggOpusWriter writer;
+    writer.Init(nullptr, 16000);
+    for (int offset = 0; offset < count; offset += 1920) {
+      writer.Write(samples.data() + offset, std::min(1920, count - offset) * 2);
+    }
+  });
+  printf("%-24s %-10s %11.0fx\n", "OggOpusWriter::Write", "voice", kFixtureSeconds / seconds);
+}
+
+struct CallbackStats {
+  std::mutex mutex;
+  std::vector<int64_t> elapsed_ns;
+  int frames = 0;
+  int sample_rate = 0;
+  int64_t missing_callbacks = 0;
+  int64_t late_callbacks = 0;
+
+  void Reset() {
+    std::lock_guard<std::mutex> lock(mutex);
+    elapsed_ns.clear();
+    elapsed_ns.reserve(100000);
+    missing_callbacks = 0;
+    late_callbacks = 0;
+  }
+};
+
+CallbackStats playback_stats;
+CallbackStats capture_stats;
+
+std::atomic<int> player_state{-1};
+std::atomic<int64_t> analysis_posts{0};
+
+bool PostCObject(Dart_Port_DL port, Dart_CObject *message) {
+  if (port == kPlayerPort && message->type == Dart_CObject_kArray
+      && message->value.as_array.length == 2
+      && message->value.as_array.values[0]->value.as_int32 == 0) {
+    player_state = message->value.as_array.values[1]->value.as_int32;
+  }
+  if (port == kPlayerPort && message->type == Dart_CObject_kArray
+      && message->value.as_array.values[0]->value.as_int32 == 2) {
+    analysis_posts++;
+  }
+  return true;
+}
+
+void PrintCallbackStats(const char *name, CallbackStats &stats) {
+  std::lock_guard<std::mutex> lock(stats.mutex);
+  auto &elapsed = stats.elapsed_ns;
+  if (elapsed.empty()) {
+    printf("%-24s no callbacks, is the sdl audio driver available?\n", name);
+    return;
+  }
+  std::sort(elapsed.begin(), elapsed.end());
+  auto percentile = [&](double p) {
+    return double(elapsed[std::min(elapsed.size() - 1, size_t(p * elapsed.size()))]) / 1000;
+  };
+  printf("%-24s %9zu %7.1fms %8.1fus %8.1fus %8.1fus %8.1fus %6lld %6lld\n",
+         name, elapsed.size(), 1000.0 * stats.frames / stats.sample_rate,
+         percentile(0.5), percentile(0.9), percentile(0.99), double(elapsed.back()) / 1000,
+         (long long) stats.missing_callbacks, (long long) stats.late_callbacks);
+}
+
+// `analysis_bands` of the analysis tap posting at 30Hz, -1 to leave it off.
+void RunPlayerSession(const std::string &path, double rate, int profile, const char *profile_name,
+                      int analysis_bands = -1) {
+  playback_stats.Reset();
+  player_state = -1;
+  analysis_posts = 0;
+  auto *player = ogg_opus_player_create_with_profile(path.c_str(), kPlayerPort, profile);
+  ogg_opus_player_set_playback_rate(player, rate);
+  if (analysis_bands >= 0) {
+    ogg_opus_player_set_analysis(player, 33, analysis_bands);
+  }
+  auto start = std::chrono::steady_clock::now();
+  ogg_opus_player_play(player);
+  auto deadline = std::chrono::steady_clock::now()
+      + std::chrono::milliseconds(int64_t(kSessionSeconds / rate * 1000) + 5000);
+  while (player_state != OGG_OPUS_PLAYER_STATE_ENDED && player_state != OGG_OPUS_PLAYER_STATE_ERROR
+      && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  }
+  std::chrono::duration<double> played = std::chrono::steady_clock::now() - start;
+  auto latency = ogg_opus_player_get_output_latency(player);
+  ogg_opus_player_dispose(player);
+  char name[32];
+  snprintf(name, sizeof(name), "player %s %.1fx%s", profile_name, rate, analysis_bands >= 0 ? " tap" : "");
+  PrintCallbackStats(name, playback_stats);
+  printf("%-24s output latency %.1fms\n", "", latency * 1000);
+  if (analysis_bands >= 0) {
+    printf("%-24s analysis %lld posts, %.1f/s\n", "", (long long) analysis_posts.load(),
+           double(analysis_posts) / played.count());
+  }
+}
+
+void RunRecorderSession(const std::string &path) {
+  capture_stats.Reset();
+  auto *recorder = ogg_opus_recorder_create(path.c_str(), kRecorderPort);
+  if (!recorder) {
+    printf("%-24s failed to open the capture device\n", "recorder");
+    return;
+  }
+  ogg_opus_recorder_start(recorder);
+  std::this_thread::sleep_for(std::chrono::milliseconds(int64_t(kSessionSeconds * 1000)));
+  ogg_opus_recorder_stop(recorder);
+  int64_t high_water_mark = 0, overruns = 0;
+  ogg_opus_recorder_get_buffer_stats(recorder, &high_water_mark, &overruns);
+  ogg_opus_recorder_destroy(recorder);
+  PrintCallbackStats("recorder", capture_stats);
+  printf("%-24s ring high water mark %lld samples\n", "", (long long) high_water_mark);
+}
+
+}
+
+void ogg_opus_callback_hook(bool capture, int64_t elapsed_ns, int frames, int missing, int sample_rate) {
+  auto &stats = capture ? capture_stats : playback_stats;
+  std::lock_guard<std::mutex> lock(stats.mutex);
+  stats.elapsed_ns.push_back(elapsed_ns);
+  stats.frames = frames;
+  stats.sample_rate = sample_rate;
+  if (missing > 0) {
+    stats.missing_callbacks++;
+  }
+  // the device would starve if the callback takes longer than it plays.
+  if (elapsed_ns * sample_rate > int64_t(frames) * 1000000000) {
+    stats.late_callbacks++;
+  }
+}
+
+int main(int argc, char **argv) {
+  std::string dir = argc > 1 ? std::string(argv[1]) + "/" : "";
+  auto voice_path = dir + "pipeline_voice.ogg";
+  auto stereo_path = dir + "pipeline_stereo.ogg";
+  auto session_path = dir + "pipeline_session.ogg";
+  auto capture_input_path = dir + "pipeline_capture.raw";
+
+  if (!EncodeFixture(voice_path, VoiceSamples(16000, 1, kFixtureSeconds), 16000, 1, 16 * 1024)
+      || !EncodeFixture(stereo_path, VoiceSamples(48000, 2, kFixtureSeconds), 48000, 2, 64 * 1024)
+      || !EncodeFixture(session_path, VoiceSamples(16000, 1, kSessionSeconds), 16000, 1, 16 * 1024)) {
+    fprintf(stderr, "failed to write the fixtures to %s\n", dir.empty() ? "." : dir.c_str());
+    return 1;
+  }
+
+  printf("%-24s %-10s %12s\n", "stage", "fixture", "realtime");
+  BenchmarkDecode(voice_path, "voice");
+  BenchmarkDecode(stereo_path, "stereo");
+  BenchmarkResampler(voice_path, "voice");
+  BenchmarkResampler(stereo_path, "stereo");
+  BenchmarkSonic(voice_path, "voice");
+  BenchmarkSonic(stereo_path, "stereo");
+  BenchmarkWriter();
+
+  // the disk driver plays to a file and captures from one, in real time.
+  auto capture_input = VoiceSamples(16000, 1, kSessionSeconds);
+  auto *file = fopen(capture_input_path.c_str(), "wb");
+  if (file) {
+    fwrite(capture_input.data(), sizeof(int16_t), capture_input.size(), file);
+    fclose(file);
+  }
+  SDL_setenv("SDL_AUDIODRIVER", "disk", 0);
+  SDL_setenv("SDL_DISKAUDIOFILE", (dir + "pipeline_output.raw").c_str(), 0);
+  SDL_setenv("SDL_DISKAUDIOFILEIN", capture_input_path.c_str(), 0);
+  Dart_PostCObject_DL = PostCObject;
+  // decode in every session, instead of replaying the first one from memory.
+  PcmCache::Global().SetBudget(0);
+
+  printf("\n%-24s %9s %9s %10s %10s %10s %10s %6s %6s\n", "session", "callbacks", "period",
+         "p50", "p90", "p99", "max", "xruns", "late");
+  RunPlayerSession(session_path, 1.0, OGG_OPUS_PLAYER_PROFILE_DEFAULT, "default");
+  RunPlayerSession(session_path, 2.0, OGG_OPUS_PLAYER_PROFILE_DEFAULT, "default");
+  RunPlayerSession(session_path, 1.0, OGG_OPUS_PLAYER_PROFILE_LOW_LATENCY, "low");
+  RunPlayerSession(session_path, 1.0, OGG_OPUS_PLAYER_PROFILE_POWER_SAVING, "power");
+  RunPlayerSession(session_path, 1.0, OGG_OPUS_PLAYER_PROFILE_POWER_SAVING, "power", 16);
+  RunRecorderSession(dir + "pipeline_recording.ogg");
+  return 0;
+}
@@ -7,6 +7,7 @@
 */
 
 #include "sonic.h"
+#include "sonic_simd.h"
 
 #include <limits.h>
 #include <math.h>
@@ -223,6 +224,14 @@ struct sonicStreamStruct {
   int inputBufferSize;
   int pitchBufferSize;
   int outputBufferSize;
+  /* The input, output and pitch buffers are used as ring buffers: valid
+     samples start at these offsets instead of always at the front, so
+     consuming samples is free.  The samples are only moved back to the front
+     when the free space at the end runs out, which keeps every window the
+     algorithms look at contiguous. */
+  int inputStart;
+  int outputStart;
+  int pitchStart;
   int numInputSamples;
   int numOutputSamples;
   int numPitchSamples;
@@ -372,26 +381,27 @@ static int allocateStreamBuffers(sonicStream stream, int sampleRate,
   int maxRequired = 2 * maxPeriod;
   int skip = computeSkip(stream);
 
-  /* Allocate 25% more than needed so we hopefully won't grow. */
-  stream->inputBufferSize = maxRequired + (maxRequired >> 2);;
+  /* Room for maxRequired samples kept for the pitch search, plus the new input
+     written per pass, see inputChunkSize. */
+  stream->inputBufferSize = SONIC_RING_BUFFER_FACTOR * maxRequired;
   stream->inputBuffer =
       (short*)sonicCalloc(stream->inputBufferSize, sizeof(short) * numChannels);
   if (stream->inputBuffer == NULL) {
     sonicDestroyStream(stream);
     return 0;
   }
-  /* Allocate 25% more than needed so we hopefully won't grow. */
-  stream->outputBufferSize = maxRequired + (maxRequired >> 2);
+  /* Enough for the output of one input chunk at common speeds, so it only grows
+     while warming up, or if the caller does not drain the output. */
+  stream->outputBufferSize = SONIC_RING_BUFFER_FACTOR * maxRequired;
   stream->outputBuffer =
       (short*)sonicCalloc(stream->outputBufferSize, sizeof(short) * numChannels);
   if (stream->outputBuffer == NULL) {
     sonicDestroyStream(stream);
     return 0;
   }
-  /* Allocate 25% more than needed so we hopefully won't grow. */
-  stream->pitchBufferSize = maxRequired + (maxRequired >> 2);
+  stream->pitchBufferSize = SONIC_RING_BUFFER_FACTOR * maxRequired;
   stream->pitchBuffer =
-      (short*)sonicCalloc(maxRequired, sizeof(short) * numChannels);
+      (short*)sonicCalloc(stream->pitchBufferSize, sizeof(short) * numChannels);
   if (stream->pitchBuffer == NULL) {
     sonicDestroyStream(stream);
     return 0;
@@ -411,6 +421,9 @@ static int allocateStreamBuffers(sonicStream stream, int sampleRate,
   stream->maxPeriod = maxPeriod;
   stream->maxRequired = maxRequired;
   stream->prevPeriod = 0;
+  stream->inputStart = 0;
+  stream->outputStart = 0;
+  stream->pitchStart = 0;
   return 1;
 }
 
@@ -456,40 +469,78 @@ void sonicSetNumChannels(sonicStream stream, int numChannels) {
   allocateStreamBuffers(stream, stream->sampleRate, numChannels);
 }
 
-/* Enlarge the output buffer if needed. */
-static int enlargeOutputBufferIfNeeded(sonicStream stream, int numSamples) {
-  int outputBufferSize = stream->outputBufferSize;
-
-  if (stream->numOutputSamples + numSamples > outputBufferSize) {
-    stream->outputBufferSize += (outputBufferSize >> 1) + numSamples;
-    stream->outputBuffer = (short*)sonicRealloc(
-        stream->outputBuffer,
-        outputBufferSize,
-        stream->outputBufferSize,
-        sizeof(short) * stream->numChannels);
-    if (stream->outputBuffer == NULL) {
-      return 0;
+/* Make room for numSamples more samples after the count samples starting at
+   *start in *buffer.  The samples are moved back to the front if that frees
+   enough space, and the buffer only grows if they still do not fit. */
+static int reserveRingBuffer(short** buffer, int* bufferSize, int* start,
+                             int count, int numSamples, int numChannels) {
+  int size = *bufferSize;
+
+  if (*start + count + numSamples <= size) {
+    return 1;
+  }
+  if (*start > 0) {
+    if (count > 0) {
+      memmove(*buffer, *buffer + *start * numChannels,
+              count * sizeof(short) * numChannels);
+    }
+    *start = 0;
+    if (count + numSamples <= size) {
+      return 1;
     }
   }
-  return 1;
+  *bufferSize += (size >> 1) + numSamples;
+  *buffer = (short*)sonicRealloc(*buffer, size, *bufferSize,
+                                 sizeof(short) * numChannels);
+  return *buffer != NULL;
+}
+
+/* Enlarge the output buffer if needed. */
+static int enlargeOutputBufferIfNeeded(sonicStream stream, int numSamples) {
+  return reserveRingBuffer(&stream->outputBuffer, &stream->outputBufferSize,
+                           &stream->outputStart, stream->numOutputSamples,
+                           numSamples, stream->numChannels);
 }
 
 /* Enlarge the input buffer if needed. */
 static int enlargeInputBufferIfNeeded(sonicStream stream, int numSamples) {
-  int inputBufferSize = stream->inputBufferSize;
-
-  if (stream->numInputSamples + numSamples > inputBufferSize) {
-    stream->inputBufferSize += (inputBufferSize >> 1) + numSamples;
-    stream->inputBuffer = (short*)sonicRealloc(
-        stream->inputBuffer,
-        inputBufferSize,
-        stream->inputBufferSize,
-        sizeof(short) * stream->numChannels);
-    if (stream->inputBuffer == NULL) {
-      return 0;
-    }
-  }
-  return 1;
+  return reserveRingBuffer(&stream->inputBuffer, &stream->inputBufferSize,
+                           &stream->inputStart, stream->numInputSamples,
+                           numSamples, stream->numChannels);
+}
+
+/* Enlarge the pitch buffer if needed. */
+static int enlargePitchBufferIfNeeded(sonicStream stream, int numSamples) {
+  return reserveRingBuffer(&stream->pitchBuffer, &stream->pitchBufferSize,
+                           &stream->pitchStart, stream->numPitchSamples,
+                           numSamples, stream->numChannels);
+}
+
+/* The first valid input sample. */
+static short* inputSamples(sonicStream stream) {
+  return stream->inputBuffer + stream->inputStart * stream->numChannels;
+}
+
+/* The first valid pitch sample. */
+static short* pitchSamples(sonicStream stream) {
+  return stream->pitchBuffer + stream->pitchStart * stream->numChannels;
+}
+
+/* The first valid output sample. */
+static short* outputSamples(sonicStream stream) {
+  return stream->outputBuffer + stream->outputStart * stream->numChannels;
+}
+
+/* Where the next output sample is written. */
+static short* outputEnd(sonicStream stream) {
+  return outputSamples(stream) + stream->numOutputSamples * stream->numChannels;
+}
+
+/* Remove numSamples samples from the front of the output buffer. */
+static void removeOutputSamples(sonicStream stream, int numSamples) {
+  stream->numOutputSamples -= numSamples;
+  stream->outputStart =
+      stream->numOutputSamples == 0 ? 0 : stream->outputStart + numSamples;
 }
 
 /* Update stream->numInputSamples, and update stream->inputPlayTime.  Call this
@@ -514,7 +565,7 @@ static int addFloatSamplesToInputBuffer(sonicStream stream, const float* samples
   if (!enlargeInputBufferIfNeeded(stream, numSamples)) {
     return 0;
   }
-  buffer = stream->inputBuffer + stream->numInputSamples * stream->numChannels;
+  buffer = inputSamples(stream) + stream->numInputSamples * stream->numChannels;
   while (count--) {
     *buffer++ = (*samples++) * 32767.0f;
   }
@@ -531,7 +582,7 @@ static int addShortSamplesToInputBuffer(sonicStream stream, const short* samples
   if (!enlargeInputBufferIfNeeded(stream, numSamples)) {
     return 0;
   }
-  memcpy(stream->inputBuffer + stream->numInputSamples * stream->numChannels,
+  memcpy(inputSamples(stream) + stream->numInputSamples * stream->numChannels,
          samples, numSamples * sizeof(short) * stream->numChannels);
   updateNumInputSamples(stream, numSamples);
   return 1;
@@ -550,7 +601,7 @@ static int addUnsignedCharSamplesToInputBuffer(sonicStream stream,
   if (!enlargeInputBufferIfNeeded(stream, numSamples)) {
     return 0;
   }
-  buffer = stream->inputBuffer + stream->numInputSamples * stream->numChannels;
+  buffer = inputSamples(stream) + stream->numInputSamples * stream->numChannels;
   while (count--) {
     *buffer++ = (*samples++ - 128) << 8;
   }
@@ -562,11 +613,7 @@ static int addUnsignedCharSamplesToInputBuffer(sonicStream stream,
 static void removeInputSamples(sonicStream stream, int position) {
   int remainingSamples = stream->numInputSamples - position;
 
-  if (remainingSamples > 0) {
-    memmove(stream->inputBuffer,
-            stream->inputBuffer + position * stream->numChannels,
-            remainingSamples * sizeof(short) * stream->numChannels);
-  }
+  stream->inputStart = remainingSamples > 0 ? stream->inputStart + position : 0;
   /* If we play 3/4ths of the samples, then the expected play time of the
      remaining samples is 1/4th of the original expected play time. */
   stream->inputPlayTime =
@@ -580,8 +627,8 @@ static int copyInputToOutput(sonicStream stream, int numSamples) {
   if (!enlargeOutputBufferIfNeeded(stream, numSamples)) {
     return 0;
   }
-  memcpy(stream->outputBuffer + stream->numOutputSamples * stream->numChannels,
-         stream->inputBuffer, numSamples * sizeof(short) * stream->numChannels);
+  memcpy(outputEnd(stream), inputSamples(stream),
+         numSamples * sizeof(short) * stream->numChannels);
   stream->numOutputSamples += numSamples;
   removeInputSamples(stream, numSamples);
   return 1;
@@ -592,8 +639,8 @@ static int copyToOutput(sonicStream stream, short* samples, int numSamples) {
   if (!enlargeOutputBufferIfNeeded(stream, numSamples)) {
     return 0;
   }
-  memcpy(stream->outputBuffer + stream->numOutputSamples * stream->numChannels,
-         samples, numSamples * sizeof(short) * stream->numChannels);
+  memcpy(outputEnd(stream), samples,
+         numSamples * sizeof(short) * stream->numChannels);
   stream->numOutputSamples += numSamples;
   return 1;
 }
@@ -603,7 +650,6 @@ static int copyToOutput(sonicStream stream, short* samples, int numSamples) {
 int sonicReadFloatFromStream(sonicStream stream, float* samples,
                              int maxSamples) {
   int numSamples = stream->numOutputSamples;
-  int remainingSamples = 0;
   short* buffer;
   int count;
 
@@ -611,20 +657,14 @@ int sonicReadFloatFromStream(sonicStream stream, float* samples,
     return 0;
   }
   if (numSamples > maxSamples) {
-    remainingSamples = numSamples - maxSamples;
     numSamples = maxSamples;
   }
-  buffer = stream->outputBuffer;
+  buffer = outputSamples(stream);
   count = numSamples * stream->numChannels;
   while (count--) {
     *samples++ = (*buffer++) / 32767.0f;
   }
-  if (remainingSamples > 0) {
-    memmove(stream->outputBuffer,
-            stream->outputBuffer + numSamples * stream->numChannels,
-            remainingSamples * sizeof(short) * stream->numChannels);
-  }
-  stream->numOutputSamples = remainingSamples;
+  removeOutputSamples(stream, numSamples);
   return numSamples;
 }
 
@@ -633,23 +673,16 @@ int sonicReadFloatFromStream(sonicStream stream, float* samples,
 int sonicReadShortFromStream(sonicStream stream, short* samples,
                              int maxSamples) {
   int numSamples = stream->numOutputSamples;
-  int remainingSamples = 0;
 
   if (numSamples == 0) {
     return 0;
   }
   if (numSamples > maxSamples) {
-    remainingSamples = numSamples - maxSamples;
     numSamples = maxSamples;
   }
-  memcpy(samples, stream->outputBuffer,
+  memcpy(samples, outputSamples(stream),
          numSamples * sizeof(short) * stream->numChannels);
-  if (remainingSamples > 0) {
-    memmove(stream->outputBuffer,
-            stream->outputBuffer + numSamples * stream->numChannels,
-            remainingSamples * sizeof(short) * stream->numChannels);
-  }
-  stream->numOutputSamples = remainingSamples;
+  removeOutputSamples(stream, numSamples);
   return numSamples;
 }
 
@@ -658,7 +691,6 @@ int sonicReadShortFromStream(sonicStream stream, short* samples,
 int sonicReadUnsignedCharFromStream(sonicStream stream, unsigned char* samples,
                                     int maxSamples) {
   int numSamples = stream->numOutputSamples;
-  int remainingSamples = 0;
   short* buffer;
   int count;
 
@@ -666,20 +698,14 @@ int sonicReadUnsignedCharFromStream(sonicStream stream, unsigned char* samples,
     return 0;
   }
   if (numSamples > maxSamples) {
-    remainingSamples = numSamples - maxSamples;
     numSamples = maxSamples;
   }
-  buffer = stream->outputBuffer;
+  buffer = outputSamples(stream);
   count = numSamples * stream->numChannels;
   while (count--) {
     *samples++ = (char)((*buffer++) >> 8) + 128;
   }
-  if (remainingSamples > 0) {
-    memmove(stream->outputBuffer,
-            stream->outputBuffer + numSamples * stream->numChannels,
-            remainingSamples * sizeof(short) * stream->numChannels);
-  }
-  stream->numOutputSamples = remainingSamples;
+  removeOutputSamples(stream, numSamples);
   return numSamples;
 }
 
@@ -699,7 +725,7 @@ int sonicFlushStream(sonicStream stream) {
   if (!enlargeInputBufferIfNeeded(stream, remainingSamples + 2 * maxRequired)) {
     return 0;
   }
-  memset(stream->inputBuffer + remainingSamples * stream->numChannels, 0,
+  memset(inputSamples(stream) + remainingSamples * stream->numChannels, 0,
          2 * maxRequired * sizeof(short) * stream->numChannels);
   stream->numInputSamples += 2 * maxRequired;
   if (!sonicWriteShortToStream(stream, NULL, 0)) {
@@ -711,6 +737,8 @@ int sonicFlushStream(sonicStream stream) {
   }
   /* Empty input and pitch buffers */
   stream->numInputSamples = 0;
+  stream->inputStart = 0;
+  stream->pitchStart = 0;
   stream->inputPlayTime = 0.0f;
   stream->timeError = 0.0f;
   stream->numPitchSamples = 0;
@@ -747,22 +775,10 @@ static void downSampleInput(sonicStream stream, short* samples, int skip) {
 static int findPitchPeriodInRange(short* samples, int minPeriod, int maxPeriod,
                                   int* retMinDiff, int* retMaxDiff) {
   int period, bestPeriod = 0, worstPeriod = 255;
-  short* s;
-  short* p;
-  short sVal, pVal;
   unsigned long diff, minDiff = 1, maxDiff = 0;
-  int i;
 
   for (period = minPeriod; period <= maxPeriod; period++) {
-    diff = 0;
-    s = samples;
-    p = samples + period;
-    for (i = 0; i < period; i++) {
-      sVal = *s++;
-      pVal = *p++;
-      diff += sVal >= pVal ? (unsigned short)(sVal - pVal)
-                           : (unsigned short)(pVal - sVal);
-    }
+    diff = sonicSimdAbsDiffSum(samples, period);
     /* Note that the highest number of samples we add into diff will be less
        than 256, since we skip samples.  Thus, diff is a 24 bit number, and
        we can safely multiply by numSamples without overflow */
@@ -859,6 +875,9 @@ static int findPitchPeriod(sonicStream stream, short* samples,
    other one from zero up, and add them, storing the result at the output. */
 static void overlapAdd(int numSamples, int numChannels, short* out,
                        short* rampDown, short* rampUp) {
+#ifndef SONIC_USE_SIN
+  sonicSimdOverlapAdd(numSamples, numChannels, out, rampDown, rampUp);
+#else
   short* o;
   short* u;
   short* d;
@@ -869,17 +888,14 @@ static void overlapAdd(int numSamples, int numChannels, short* out,
     u = rampUp + i;
     d = rampDown + i;
     for (t = 0; t < numSamples; t++) {
-#ifdef SONIC_USE_SIN
       float ratio = sin(t * M_PI / (2 * numSamples));
       *o = *d * (1.0f - ratio) + *u * ratio;
-#else
-      *o = (*d * (numSamples - t) + *u * t) / numSamples;
-#endif
       o += numChannels;
       d += numChannels;
       u += numChannels;
     }
   }
+#endif
 }
 
 /* Just move the new samples in the output buffer to the pitch buffer */
@@ -888,17 +904,11 @@ static int moveNewSamplesToPitchBuffer(sonicStream stream,
   int numSamples = stream->numOutputSamples - originalNumOutputSamples;
   int numChannels = stream->numChannels;
 
-  if (stream->numPitchSamples + numSamples > stream->pitchBufferSize) {
-    int pitchBufferSize = stream->pitchBufferSize;
-    stream->pitchBufferSize += (pitchBufferSize >> 1) + numSamples;
-    stream->pitchBuffer = (short*)sonicRealloc(
-        stream->pitchBuffer,
-        pitchBufferSize,
-        stream->pitchBufferSize,
-        sizeof(short) * numChannels);
-  }
-  memcpy(stream->pitchBuffer + stream->numPitchSamples * numChannels,
-         stream->outputBuffer + originalNumOutputSamples * numChannels,
+  if (!enlargePitchBufferIfNeeded(stream, numSamples)) {
+    return 0;
+  }
+  memcpy(pitchSamples(stream) + stream->numPitchSamples * numChannels,
+         outputSamples(stream) + originalNumOutputSamples * numChannels,
          numSamples * sizeof(short) * numChannels);
   stream->numOutputSamples = originalNumOutputSamples;
   stream->numPitchSamples += numSamples;
@@ -907,18 +917,12 @@ static int moveNewSamplesToPitchBuffer(sonicStream stream,
 
 /* Remove processed samples from the pitch buffer. */
 static void removePitchSamples(sonicStream stream, int numSamples) {
-  int numChannels = stream->numChannels;
-  short* source = stream->pitchBuffer + numSamples * numChannels;
-
   if (numSamples == 0) {
     return;
   }
-  if (numSamples != stream->numPitchSamples) {
-    memmove(
-        stream->pitchBuffer, source,
-        (stream->numPitchSamples - numSamples) * sizeof(short) * numChannels);
-  }
   stream->numPitchSamples -= numSamples;
+  stream->pitchStart =
+      stream->numPitchSamples == 0 ? 0 : stream->pitchStart + numSamples;
 }
 
 /* Approximate the sinc function times a Hann window from the sinc table. */
@@ -999,8 +1003,8 @@ static int adjustRate(sonicStream stream, float rate,
       if (!enlargeOutputBufferIfNeeded(stream, 1)) {
         return 0;
       }
-      out = stream->outputBuffer + stream->numOutputSamples * numChannels;
-      in = stream->pitchBuffer + position * numChannels;
+      out = outputEnd(stream);
+      in = pitchSamples(stream) + position * numChannels;
       for (i = 0; i < numChannels; i++) {
         *out++ = interpolate(stream, in, oldSampleRate, newSampleRate);
         in++;
@@ -1034,9 +1038,8 @@ static int skipPitchPeriod(sonicStream stream, short* samples, float speed,
   if (!enlargeOutputBufferIfNeeded(stream, newSamples)) {
     return 0;
   }
-  overlapAdd(newSamples, numChannels,
-             stream->outputBuffer + stream->numOutputSamples * numChannels,
-             samples, samples + period * numChannels);
+  overlapAdd(newSamples, numChannels, outputEnd(stream), samples,
+             samples + period * numChannels);
   stream->numOutputSamples += newSamples;
   return newSamples;
 }
@@ -1056,10 +1059,9 @@ static int insertPitchPeriod(sonicStream stream, short* samples, float speed,
   if (!enlargeOutputBufferIfNeeded(stream, period + newSamples)) {
     return 0;
   }
-  out = stream->outputBuffer + stream->numOutputSamples * numChannels;
+  out = outputEnd(stream);
   memcpy(out, samples, period * sizeof(short) * numChannels);
-  out =
-      stream->outputBuffer + (stream->numOutputSamples + period) * numChannels;
+  out += period * numChannels;
   overlapAdd(newSamples, numChannels, out, samples + period * numChannels,
              samples);
   stream->numOutputSamples += period + newSamples;
@@ -1096,7 +1098,7 @@ static int changeSpeed(sonicStream stream, float speed) {
     return 1;
   }
   do {
-    samples = stream->inputBuffer + position * stream->numChannels;
+    samples = inputSamples(stream) + position * stream->numChannels;
     if ((speed > 1.0f && speed < 2.0f && stream->timeError < 0.0f) ||
         (speed < 1.0f && speed > 0.5f && stream->timeError > 0.0f)) {
       /* Deal with the case where PICOLA is still copying input samples to
@@ -1172,7 +1174,7 @@ static int processStreamInput(sonicStream stream) {
   if (stream->volume != 1.0f) {
     /* Adjust output volume. */
     scaleSamples(
-        stream->outputBuffer + originalNumOutputSamples * stream->numChannels,
+        outputSamples(stream) + originalNumOutputSamples * stream->numChannels,
         (stream->numOutputSamples - originalNumOutputSamples) *
             stream->numChannels,
         stream->volume);
@@ -1180,33 +1182,73 @@ static int processStreamInput(sonicStream stream) {
   return 1;
 }
 
+/* The most samples added to the input buffer before processing them.  At most
+   maxRequired samples are left in the input buffer after processing, so a chunk
+   always fits without growing the buffer. */
+static int inputChunkSize(sonicStream stream) {
+  return stream->inputBufferSize - stream->maxRequired;
+}
+
 /* Write floating point data to the input buffer and process it. */
 int sonicWriteFloatToStream(sonicStream stream, const float* samples,
                             int numSamples) {
-  if (!addFloatSamplesToInputBuffer(stream, samples, numSamples)) {
-    return 0;
-  }
-  return processStreamInput(stream);
+  int chunkSize = inputChunkSize(stream);
+  int chunk;
+
+  do {
+    chunk = numSamples < chunkSize ? numSamples : chunkSize;
+    if (!addFloatSamplesToInputBuffer(stream, samples, chunk) ||
+        !processStreamInput(stream)) {
+      return 0;
+    }
+    numSamples -= chunk;
+    if (numSamples > 0) {
+      samples += chunk * stream->numChannels;
+    }
+  } while (numSamples > 0);
+  return 1;
 }
 
 /* Simple wrapper around sonicWriteFloatToStream that does the short to float
    conversion for you. */
 int sonicWriteShortToStream(sonicStream stream, const short* samples,
                             int numSamples) {
-  if (!addShortSamplesToInputBuffer(stream, samples, numSamples)) {
-    return 0;
-  }
-  return processStreamInput(stream);
+  int chunkSize = inputChunkSize(stream);
+  int chunk;
+
+  do {
+    chunk = numSamples < chunkSize ? numSamples : chunkSize;
+    if (!addShortSamplesToInputBuffer(stream, samples, chunk) ||
+        !processStreamInput(stream)) {
+      return 0;
+    }
+    numSamples -= chunk;
+    if (numSamples > 0) {
+      samples += chunk * stream->numChannels;
+    }
+  } while (numSamples > 0);
+  return 1;
 }
 
 /* Simple wrapper around sonicWriteFloatToStream that does the unsigned char to
    float conversion for you. */
 int sonicWriteUnsignedCharToStream(sonicStream stream, const unsigned char* samples,
                                    int numSamples) {
-  if (!addUnsignedCharSamplesToInputBuffer(stream, samples, numSamples)) {
-    return 0;
-  }
-  return processStreamInput(stream);
+  int chunkSize = inputChunkSize(stream);
+  int chunk;
+
+  do {
+    chunk = numSamples < chunkSize ? numSamples : chunkSize;
+    if (!addUnsignedCharSamplesToInputBuffer(stream, samples, chunk) ||
+        !processStreamInput(stream)) {
+      return 0;
+    }
+    numSamples -= chunk;
+    if (numSamples > 0) {
+      samples += chunk * stream->numChannels;
+    }
+  } while (numSamples > 0);
+  return 1;
 }
 
 /* This is a non-stream oriented interface to just change the speed of a sound
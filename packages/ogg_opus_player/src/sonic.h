@@ -115,6 +115,13 @@ extern "C" {
 /* These are used to down-sample some inputs to improve speed */
 #define SONIC_AMDF_FREQ 4000
 
+/* The stream buffers hold this many times the samples needed for one pitch
+   search.  Input is processed in chunks that fit the input buffer, so it never
+   grows. */
+#ifndef SONIC_RING_BUFFER_FACTOR
+#define SONIC_RING_BUFFER_FACTOR 4
+#endif  /* SONIC_RING_BUFFER_FACTOR */
+
 struct sonicStreamStruct;
 typedef struct sonicStreamStruct* sonicStream;
 
@@ -0,0 +1,79 @@
+// Microbenchmark of the sonic stream: speed changes a voice like signal,
+// writing and reading it in chunks like the player does, and prints the
+// realtime factor of each configuration.
+//
+// Build with -DOGG_OPUS_PLAYER_BUILD_BENCHMARK=ON and run SonicBenchmark.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "sonic.h"
+#include "sonic_simd.h"
+
+namespace {
+
+const int kSampleRate = 48000;
+const double kSeconds = 30;
+
+std::vector<short> VoiceSamples(int channels) {
+  std::mt19937 random(42);
+  std::normal_distribution<double> noise(0, 300);
+  auto frames = int(kSampleRate * kSeconds);
+  std::vector<short> samples(frames * channels);
+  double phase = 0;
+  for (int i = 0; i < frames; ++i) {
+    auto t = double(i) / kSampleRate;
+    phase += 2 * M_PI * (140 + 60 * std::sin(2 * M_PI * 0.7 * t)) / kSampleRate;
+    auto value = 6000 * std::sin(phase) + 3000 * std::sin(2 * phase) + 1500 * std::sin(3 * phase);
+    value *= 0.6 + 0.4 * std::sin(2 * M_PI * 3 * t);
+    for (int c = 0; c < channels; ++c) {
+      samples[i * channels + c] = short(std::max(-32768.0, std::min(32767.0, value + noise(random))));
+    }
+  }
+  return samples;
+}
+
+// Returns the seconds it took to process `input`, the best of a few runs.
+double Run(const std::vector<short> &input, int channels, float speed, int chunk) {
+  std::vector<short> buffer(chunk * 4 * channels);
+  auto frames = int(input.size()) / channels;
+  double best = 1e9;
+  for (int round = 0; round < 3; ++round) {
+    auto start = std::chrono::steady_clock::now();
+    auto stream = sonicCreateStream(kSampleRate, channels);
+    sonicSetSpeed(stream, speed);
+    for (int offset = 0; offset < frames; offset += chunk) {
+      sonicWriteShortToStream(stream, input.data() + offset * channels, std::min(chunk, frames - offset));
+      while (sonicReadShortFromStream(stream, buffer.data(), chunk * 4) > 0) {
+      }
+    }
+    sonicFlushStream(stream);
+    while (sonicReadShortFromStream(stream, buffer.data(), chunk * 4) > 0) {
+    }
+    sonicDestroyStream(stream);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    best = std::min(best, elapsed.count());
+  }
+  return best;
+}
+
+}
+
+int main() {
+  printf("simd level: %d\n", int(sonicSimdGetLevel()));
+  printf("%-8s %-6s %-6s %12s\n", "channels", "speed", "chunk", "realtime");
+  for (int channels : {1, 2}) {
+    auto input = VoiceSamples(channels);
+    for (float speed : {0.5f, 1.0f, 1.5f, 2.0f, 3.0f}) {
+      for (int chunk : {480, 960, 4800, 48000}) {
+        auto seconds = Run(input, channels, speed, chunk);
+        printf("%-8d %-6.1f %-6d %11.0fx\n", channels, speed, chunk, kSeconds / seconds);
+      }
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,399 @@
+/* SIMD kernels for the hot loops of the Sonic library.  See sonic_simd.h. */
+
+#include "sonic_simd.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define SONIC_SIMD_X86 1
+#include <emmintrin.h>
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define SONIC_TARGET_AVX2
+#else
+#define SONIC_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#define SONIC_SIMD_ARM 1
+#include <arm_neon.h>
+#endif
+
+/* The vector overlap-add computes the weighted sums with 16 bit weights, so it
+   only handles crossfades up to this length. */
+#define SONIC_SIMD_MAX_OVERLAP 32767
+
+typedef unsigned long (*absDiffSumFunc)(const short* samples, int period);
+typedef void (*overlapAddFunc)(int numSamples, int numChannels, short* out,
+                               const short* rampDown, const short* rampUp);
+
+/* ---------------------------------------------------------------- scalar -- */
+
+/* Sum of |s[i] - p[i]| for i in [0, count). */
+static unsigned long absDiffSumRange(const short* s, const short* p,
+                                     int count) {
+  short sVal, pVal;
+  unsigned long diff = 0;
+  int i;
+
+  for (i = 0; i < count; i++) {
+    sVal = *s++;
+    pVal = *p++;
+    diff += sVal >= pVal ? (unsigned short)(sVal - pVal)
+                         : (unsigned short)(pVal - sVal);
+  }
+  return diff;
+}
+
+static unsigned long absDiffSumScalar(const short* samples, int period) {
+  return absDiffSumRange(samples, samples + period, period);
+}
+
+static void overlapAddScalar(int numSamples, int numChannels, short* out,
+                             const short* rampDown, const short* rampUp) {
+  short* o;
+  const short* u;
+  const short* d;
+  int i, t;
+
+  for (i = 0; i < numChannels; i++) {
+    o = out + i;
+    u = rampUp + i;
+    d = rampDown + i;
+    for (t = 0; t < numSamples; t++) {
+      *o = (*d * (numSamples - t) + *u * t) / numSamples;
+      o += numChannels;
+      d += numChannels;
+      u += numChannels;
+    }
+  }
+}
+
+/* Finish the interleaved samples [start, total) of overlapAdd, where frame t
+   starts at sample t * numChannels. */
+static void overlapAddTail(int start, int numSamples, int numChannels,
+                           short* out, const short* rampDown,
+                           const short* rampUp) {
+  int total = numSamples * numChannels;
+  int k;
+
+  for (k = start; k < total; k++) {
+    int t = k / numChannels;
+    out[k] = (rampDown[k] * (numSamples - t) + rampUp[k] * t) / numSamples;
+  }
+}
+
+/* The vector kernels step through the interleaved samples 4 at a time, which
+   keeps the frame index of each lane simple when numChannels divides 4. */
+static int canVectorizeOverlap(int numSamples, int numChannels) {
+  return numSamples <= SONIC_SIMD_MAX_OVERLAP && (4 % numChannels) == 0;
+}
+
+/* ------------------------------------------------------------------- x86 -- */
+
+#ifdef SONIC_SIMD_X86
+
+static unsigned int sumEpu32(__m128i v) {
+  v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+  v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+  return (unsigned int)_mm_cvtsi128_si32(v);
+}
+
+/* |a - b| of signed 16 bit lanes, as unsigned 16 bit lanes.  max - min wraps
+   into the right unsigned value, like the (unsigned short) casts of the scalar
+   code. */
+static __m128i absDiffEpi16(__m128i a, __m128i b) {
+  return _mm_sub_epi16(_mm_max_epi16(a, b), _mm_min_epi16(a, b));
+}
+
+static unsigned long absDiffSumSse2(const short* samples, int period) {
+  const short* s = samples;
+  const short* p = samples + period;
+  __m128i zero = _mm_setzero_si128();
+  __m128i acc = zero;
+  int i = 0;
+
+  for (; i + 8 <= period; i += 8) {
+    __m128i a = _mm_loadu_si128((const __m128i*)(s + i));
+    __m128i b = _mm_loadu_si128((const __m128i*)(p + i));
+    __m128i d = absDiffEpi16(a, b);
+    acc = _mm_add_epi32(acc, _mm_unpacklo_epi16(d, zero));
+    acc = _mm_add_epi32(acc, _mm_unpackhi_epi16(d, zero));
+  }
+  return sumEpu32(acc) + absDiffSumRange(s + i, p + i, period - i);
+}
+
+/* Weights of 4 interleaved samples starting at frame t, as the 16 bit pairs
+   (numSamples - t, t) expected by _mm_madd_epi16. */
+static __m128i overlapWeights(int numSamples, int numChannels, int k) {
+  int t0 = k / numChannels;
+  int t1 = (k + 1) / numChannels;
+  int t2 = (k + 2) / numChannels;
+  int t3 = (k + 3) / numChannels;
+  return _mm_setr_epi16((short)(numSamples - t0), (short)t0,
+                        (short)(numSamples - t1), (short)t1,
+                        (short)(numSamples - t2), (short)t2,
+                        (short)(numSamples - t3), (short)t3);
+}
+
+/* 4 frames ahead in weights, the frame index advances by 4 / numChannels. */
+static __m128i overlapWeightStep(int numChannels) {
+  short step = (short)(4 / numChannels);
+  return _mm_setr_epi16((short)-step, step, (short)-step, step,
+                        (short)-step, step, (short)-step, step);
+}
+
+static void overlapAddSse2(int numSamples, int numChannels, short* out,
+                           const short* rampDown, const short* rampUp) {
+  int total = numSamples * numChannels;
+  int k = 0;
+
+  if (!canVectorizeOverlap(numSamples, numChannels)) {
+    overlapAddScalar(numSamples, numChannels, out, rampDown, rampUp);
+    return;
+  }
+  __m128i weights = overlapWeights(numSamples, numChannels, 0);
+  __m128i step = overlapWeightStep(numChannels);
+  __m128d divisor = _mm_set1_pd((double)numSamples);
+  for (; k + 4 <= total; k += 4) {
+    __m128i d = _mm_loadl_epi64((const __m128i*)(rampDown + k));
+    __m128i u = _mm_loadl_epi64((const __m128i*)(rampUp + k));
+    /* d * (numSamples - t) + u * t, exact in 32 bits. */
+    __m128i sum = _mm_madd_epi16(_mm_unpacklo_epi16(d, u), weights);
+    /* Division in double precision is exact enough to truncate to the same
+       quotient as the integer division of the scalar code. */
+    __m128i lo = _mm_cvttpd_epi32(_mm_div_pd(_mm_cvtepi32_pd(sum), divisor));
+    __m128i hi = _mm_cvttpd_epi32(_mm_div_pd(
+        _mm_cvtepi32_pd(_mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2))),
+        divisor));
+    __m128i result = _mm_unpacklo_epi64(lo, hi);
+    _mm_storel_epi64((__m128i*)(out + k), _mm_packs_epi32(result, result));
+    weights = _mm_add_epi16(weights, step);
+  }
+  overlapAddTail(k, numSamples, numChannels, out, rampDown, rampUp);
+}
+
+SONIC_TARGET_AVX2
+static unsigned long absDiffSumAvx2(const short* samples, int period) {
+  const short* s = samples;
+  const short* p = samples + period;
+  __m256i zero = _mm256_setzero_si256();
+  __m256i acc = zero;
+  int i = 0;
+
+  for (; i + 16 <= period; i += 16) {
+    __m256i a = _mm256_loadu_si256((const __m256i*)(s + i));
+    __m256i b = _mm256_loadu_si256((const __m256i*)(p + i));
+    __m256i d = _mm256_sub_epi16(_mm256_max_epi16(a, b),
+                                 _mm256_min_epi16(a, b));
+    acc = _mm256_add_epi32(acc, _mm256_unpacklo_epi16(d, zero));
+    acc = _mm256_add_epi32(acc, _mm256_unpackhi_epi16(d, zero));
+  }
+  __m128i acc128 = _mm_add_epi32(_mm256_castsi256_si128(acc),
+                                 _mm256_extracti128_si256(acc, 1));
+  return sumEpu32(acc128) + absDiffSumRange(s + i, p + i, period - i);
+}
+
+SONIC_TARGET_AVX2
+static void overlapAddAvx2(int numSamples, int numChannels, short* out,
+                           const short* rampDown, const short* rampUp) {
+  int total = numSamples * numChannels;
+  int k = 0;
+
+  if (!canVectorizeOverlap(numSamples, numChannels)) {
+    overlapAddScalar(numSamples, numChannels, out, rampDown, rampUp);
+    return;
+  }
+  __m128i weights = overlapWeights(numSamples, numChannels, 0);
+  __m128i step = overlapWeightStep(numChannels);
+  __m256d divisor = _mm256_set1_pd((double)numSamples);
+  for (; k + 4 <= total; k += 4) {
+    __m128i d = _mm_loadl_epi64((const __m128i*)(rampDown + k));
+    __m128i u = _mm_loadl_epi64((const __m128i*)(rampUp + k));
+    __m128i sum = _mm_madd_epi16(_mm_unpacklo_epi16(d, u), weights);
+    __m128i result = _mm256_cvttpd_epi32(
+        _mm256_div_pd(_mm256_cvtepi32_pd(sum), divisor));
+    _mm_storel_epi64((__m128i*)(out + k), _mm_packs_epi32(result, result));
+    weights = _mm_add_epi16(weights, step);
+  }
+  overlapAddTail(k, numSamples, numChannels, out, rampDown, rampUp);
+}
+
+static int cpuSupportsAvx2(void) {
+#if defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 0);
+  if (info[0] < 7) {
+    return 0;
+  }
+  __cpuid(info, 1);
+  /* OSXSAVE and AVX, then the OS must save the ymm registers. */
+  if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 ||
+      (_xgetbv(0) & 6) != 6) {
+    return 0;
+  }
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 5)) != 0;
+#else
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif /* SONIC_SIMD_X86 */
+
+/* ------------------------------------------------------------------- ARM -- */
+
+#ifdef SONIC_SIMD_ARM
+
+static unsigned long absDiffSumNeon(const short* samples, int period) {
+  const short* s = samples;
+  const short* p = samples + period;
+  uint32x4_t acc = vdupq_n_u32(0);
+  int i = 0;
+
+  for (; i + 8 <= period; i += 8) {
+    int16x8_t a = vld1q_s16(s + i);
+    int16x8_t b = vld1q_s16(p + i);
+    /* vabdq wraps like the (unsigned short) casts of the scalar code. */
+    uint16x8_t d = vreinterpretq_u16_s16(vabdq_s16(a, b));
+    acc = vpadalq_u16(acc, d);
+  }
+  uint64x2_t pairs = vpaddlq_u32(acc);
+  unsigned long sum = (unsigned long)(vgetq_lane_u64(pairs, 0) +
+                                      vgetq_lane_u64(pairs, 1));
+  return sum + absDiffSumRange(s + i, p + i, period - i);
+}
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+
+static void overlapAddNeon(int numSamples, int numChannels, short* out,
+                           const short* rampDown, const short* rampUp) {
+  int total = numSamples * numChannels;
+  int k = 0;
+
+  if (!canVectorizeOverlap(numSamples, numChannels)) {
+    overlapAddScalar(numSamples, numChannels, out, rampDown, rampUp);
+    return;
+  }
+  int step = 4 / numChannels;
+  int32_t upInit[4] = {0 / numChannels, 1 / numChannels, 2 / numChannels,
+                       3 / numChannels};
+  int32x4_t upWeights = vld1q_s32(upInit);
+  int32x4_t downWeights = vsubq_s32(vdupq_n_s32(numSamples), upWeights);
+  int32x4_t upStep = vdupq_n_s32(step);
+  float64x2_t divisor = vdupq_n_f64((double)numSamples);
+  for (; k + 4 <= total; k += 4) {
+    int32x4_t d = vmovl_s16(vld1_s16(rampDown + k));
+    int32x4_t u = vmovl_s16(vld1_s16(rampUp + k));
+    int32x4_t sum = vmlaq_s32(vmulq_s32(d, downWeights), u, upWeights);
+    float64x2_t lo = vcvtq_f64_s64(vmovl_s32(vget_low_s32(sum)));
+    float64x2_t hi = vcvtq_f64_s64(vmovl_s32(vget_high_s32(sum)));
+    int32x2_t qlo = vmovn_s64(vcvtq_s64_f64(vdivq_f64(lo, divisor)));
+    int32x2_t qhi = vmovn_s64(vcvtq_s64_f64(vdivq_f64(hi, divisor)));
+    vst1_s16(out + k, vmovn_s32(vcombine_s32(qlo, qhi)));
+    upWeights = vaddq_s32(upWeights, upStep);
+    downWeights = vsubq_s32(downWeights, upStep);
+  }
+  overlapAddTail(k, numSamples, numChannels, out, rampDown, rampUp);
+}
+
+#else
+
+/* No vector double division on 32 bit ARM. */
+#define overlapAddNeon overlapAddScalar
+
+#endif
+
+#endif /* SONIC_SIMD_ARM */
+
+/* -------------------------------------------------------------- dispatch -- */
+
+static sonicSimdLevel bestLevel(void) {
+#if defined(SONIC_SIMD_X86)
+  return cpuSupportsAvx2() ? SONIC_SIMD_AVX2 : SONIC_SIMD_SSE2;
+#elif defined(SONIC_SIMD_ARM)
+  return SONIC_SIMD_NEON;
+#else
+  return SONIC_SIMD_SCALAR;
+#endif
+}
+
+static int levelSupported(sonicSimdLevel level) {
+  switch (level) {
+    case SONIC_SIMD_SCALAR:
+      return 1;
+#if defined(SONIC_SIMD_X86)
+    case SONIC_SIMD_SSE2:
+      return 1;
+    case SONIC_SIMD_AVX2:
+      return bestLevel() == SONIC_SIMD_AVX2;
+#elif defined(SONIC_SIMD_ARM)
+    case SONIC_SIMD_NEON:
+      return 1;
+#endif
+    default:
+      return 0;
+  }
+}
+
+static int initialized = 0;
+static sonicSimdLevel currentLevel = SONIC_SIMD_SCALAR;
+static absDiffSumFunc absDiffSumImpl = absDiffSumScalar;
+static overlapAddFunc overlapAddImpl = overlapAddScalar;
+
+static void useLevel(sonicSimdLevel level) {
+  switch (level) {
+#if defined(SONIC_SIMD_X86)
+    case SONIC_SIMD_SSE2:
+      absDiffSumImpl = absDiffSumSse2;
+      overlapAddImpl = overlapAddSse2;
+      break;
+    case SONIC_SIMD_AVX2:
+      absDiffSumImpl = absDiffSumAvx2;
+      overlapAddImpl = overlapAddAvx2;
+      break;
+#elif defined(SONIC_SIMD_ARM)
+    case SONIC_SIMD_NEON:
+      absDiffSumImpl = absDiffSumNeon;
+      overlapAddImpl = overlapAddNeon;
+      break;
+#endif
+    default:
+      level = SONIC_SIMD_SCALAR;
+      absDiffSumImpl = absDiffSumScalar;
+      overlapAddImpl = overlapAddScalar;
+      break;
+  }
+  currentLevel = level;
+  initialized = 1;
+}
+
+/* Every thread selects the same level, so racing here is harmless. */
+static void initIfNeeded(void) {
+  if (!initialized) {
+    useLevel(bestLevel());
+  }
+}
+
+sonicSimdLevel sonicSimdGetLevel(void) {
+  initIfNeeded();
+  return currentLevel;
+}
+
+sonicSimdLevel sonicSimdSetLevel(sonicSimdLevel level) {
+  while (!levelSupported(level)) {
+    level = (sonicSimdLevel)(level - 1);
+  }
+  useLevel(level);
+  return currentLevel;
+}
+
+unsigned long sonicSimdAbsDiffSum(const short* samples, int period) {
+  initIfNeeded();
+  return absDiffSumImpl(samples, period);
+}
+
+void sonicSimdOverlapAdd(int numSamples, int numChannels, short* out,
+                         const short* rampDown, const short* rampUp) {
+  initIfNeeded();
+  overlapAddImpl(numSamples, numChannels, out, rampDown, rampUp);
+}
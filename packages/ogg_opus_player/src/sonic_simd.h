@@ -0,0 +1,43 @@
+/* SIMD kernels for the hot loops of the Sonic library.
+
+   The pitch search (AMDF) and the overlap-add of sonic.c run through the
+   functions declared here.  The implementation is picked at runtime from what
+   the cpu supports, and every implementation produces exactly the same result
+   as the scalar code of the original library.
+*/
+
+#ifndef SONIC_SIMD_H_
+#define SONIC_SIMD_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+  SONIC_SIMD_SCALAR = 0,
+  SONIC_SIMD_SSE2,
+  SONIC_SIMD_AVX2,
+  SONIC_SIMD_NEON
+} sonicSimdLevel;
+
+/* The implementation in use. */
+sonicSimdLevel sonicSimdGetLevel(void);
+
+/* Use another implementation, mainly for tests and benchmarks.  Levels the cpu
+   does not support fall back to the best supported one below it.  Returns the
+   level now in use. */
+sonicSimdLevel sonicSimdSetLevel(sonicSimdLevel level);
+
+/* Sum of |samples[i] - samples[i + period]| for i in [0, period). */
+unsigned long sonicSimdAbsDiffSum(const short* samples, int period);
+
+/* Crossfade numSamples frames of rampDown into rampUp, see overlapAdd in
+   sonic.c. */
+void sonicSimdOverlapAdd(int numSamples, int numChannels, short* out,
+                         const short* rampDown, const short* rampUp);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SONIC_SIMD_H_ */
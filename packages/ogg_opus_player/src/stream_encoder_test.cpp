@@ -0,0 +1,115 @@
+#include "gtest/gtest.h"
+
+#include <cmath>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ogg/opusfile.h"
+
+#include "ogg_opus_stream_encoder.h"
+
+namespace {
+
+std::vector<int16_t> Sine(int sample_rate, double frequency, double seconds) {
+  std::vector<int16_t> samples(size_t(sample_rate * seconds));
+  for (size_t i = 0; i < samples.size(); ++i) {
+    samples[i] = int16_t(8000 * std::sin(2 * M_PI * frequency * double(i) / sample_rate));
+  }
+  return samples;
+}
+
+// Record `samples` in chunks of 40ms, like AudioRecord delivers them.
+void Record(void *encoder, const std::vector<int16_t> &samples) {
+  const int chunk = 640;
+  for (size_t offset = 0; offset < samples.size(); offset += chunk) {
+    auto frames = int32_t(std::min<size_t>(chunk, samples.size() - offset));
+    ASSERT_EQ(ogg_opus_stream_encoder_write(encoder, samples.data() + offset, frames), frames);
+  }
+}
+
+}
+
+TEST(StreamEncoder, RecordsConcurrently) {
+  const int kEncoders = 3;
+  std::vector<std::string> paths;
+  std::vector<void *> encoders;
+  for (int i = 0; i < kEncoders; ++i) {
+    paths.push_back(testing::TempDir() + "stream_encoder_" + std::to_string(i) + ".ogg");
+    int32_t error = 1;
+    encoders.push_back(ogg_opus_stream_encoder_create(paths[i].c_str(), 16000, 1, 16 * 1024, &error));
+    ASSERT_NE(encoders[i], nullptr);
+    EXPECT_EQ(error, 0);
+  }
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kEncoders; ++i) {
+    threads.emplace_back([&, i] { Record(encoders[i], Sine(16000, 200.0 * (i + 1), 2)); });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  for (int i = 0; i < kEncoders; ++i) {
+    EXPECT_EQ(ogg_opus_stream_encoder_finish(encoders[i]), 0);
+    uint8_t waveform[100 * 5 / 8 + 1];
+    EXPECT_EQ(ogg_opus_stream_encoder_waveform(encoders[i], 100, waveform), int32_t(sizeof(waveform)));
+    // a steady sine is 1/1.8 of the clipping level everywhere.
+    EXPECT_EQ(waveform[0] & 31, 31 * 10 / 18);
+    EXPECT_EQ(waveform[96 * 5 / 8] & 31, 31 * 10 / 18);
+    ogg_opus_stream_encoder_destroy(encoders[i]);
+
+    int error = 0;
+    auto *file = op_open_file(paths[i].c_str(), &error);
+    ASSERT_NE(file, nullptr);
+    EXPECT_EQ(op_pcm_total(file, -1), 2 * 48000);
+    op_free(file);
+    remove(paths[i].c_str());
+  }
+}
+
+TEST(StreamEncoder, RejectsWritesAfterFinish) {
+  auto path = testing::TempDir() + "stream_encoder_finish.ogg";
+  auto *encoder = ogg_opus_stream_encoder_create(path.c_str(), 16000, 1, 0, nullptr);
+  ASSERT_NE(encoder, nullptr);
+  uint8_t waveform[64];
+  EXPECT_EQ(ogg_opus_stream_encoder_waveform(encoder, 100, waveform), OGG_OPUS_STREAM_ENCODER_ERROR_FINISHED);
+
+  auto samples = Sine(16000, 440, 0.5);
+  Record(encoder, samples);
+  EXPECT_EQ(ogg_opus_stream_encoder_finish(encoder), 0);
+  EXPECT_EQ(ogg_opus_stream_encoder_write(encoder, samples.data(), 160), OGG_OPUS_STREAM_ENCODER_ERROR_FINISHED);
+  // finishing twice is harmless.
+  EXPECT_EQ(ogg_opus_stream_encoder_finish(encoder), 0);
+  ogg_opus_stream_encoder_destroy(encoder);
+  remove(path.c_str());
+}
+
+TEST(StreamEncoder, FailsToOpen) {
+  int32_t error = 0;
+  EXPECT_EQ(ogg_opus_stream_encoder_create("/nonexistent/dir/file.ogg", 16000, 1, 0, &error), nullptr);
+  EXPECT_EQ(error, OGG_OPUS_STREAM_ENCODER_ERROR_OPEN);
+  EXPECT_EQ(ogg_opus_stream_encoder_create("file.ogg", 16000, 0, 0, &error), nullptr);
+  EXPECT_EQ(error, OGG_OPUS_STREAM_ENCODER_ERROR_ARGUMENT);
+}
+
+TEST(StreamEncoder, QueuesWholeFramesWhenFull) {
+  auto path = testing::TempDir() + "stream_encoder_full.ogg";
+  auto *encoder = ogg_opus_stream_encoder_create(path.c_str(), 16000, 3, 0, nullptr);
+  ASSERT_NE(encoder, nullptr);
+
+  // far more than the 4 seconds queued, in one write which finds the ring
+  // empty. Its 2^18 samples are not a multiple of 3.
+  std::vector<int16_t> samples(size_t(16000) * 3 * 10);
+  EXPECT_EQ(ogg_opus_stream_encoder_write(encoder, samples.data(), 16000 * 10), (1 << 18) / 3);
+  EXPECT_EQ(ogg_opus_stream_encoder_finish(encoder), 0);
+  ogg_opus_stream_encoder_destroy(encoder);
+
+  int error = 0;
+  auto *file = op_open_file(path.c_str(), &error);
+  ASSERT_NE(file, nullptr);
+  EXPECT_EQ(op_channel_count(file, -1), 3);
+  EXPECT_EQ(op_pcm_total(file, -1), int64_t((1 << 18) / 3) * 3);
+  op_free(file);
+  remove(path.c_str());
+}
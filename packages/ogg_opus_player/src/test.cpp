@@ -0,0 +1,847 @@
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#if _WIN32
+#include <sys/utime.h>
+#else
+#include <utime.h>
+#endif
+
+#include "ogg/opusenc.h"
+#include "ogg/opusfile.h"
+
+#include "ogg_opus_analyzer.h"
+#include "ogg_opus_edit.h"
+#include "ogg_opus_render.h"
+#include "ogg_opus_loudness.h"
+#include "ogg_opus_loudness_meter.h"
+#include "ogg_opus_pcm_cache.h"
+#include "ogg_opus_probe.h"
+#include "ogg_opus_reader.h"
+#include "ogg_opus_resampler.h"
+#include "ogg_opus_vad.h"
+#include "ogg_opus_waveform.h"
+#include "ogg_opus_waveform_core.h"
+#include "sonic.h"
+#include "sonic_simd.h"
+
+namespace {
+
+std::vector<sonicSimdLevel> SupportedLevels() {
+  std::vector<sonicSimdLevel> levels;
+  for (auto level : {SONIC_SIMD_SSE2, SONIC_SIMD_AVX2, SONIC_SIMD_NEON}) {
+    if (sonicSimdSetLevel(level) == level) {
+      levels.push_back(level);
+    }
+  }
+  return levels;
+}
+
+std::vector<short> RandomSamples(size_t count, int seed) {
+  std::mt19937 random(seed);
+  std::uniform_int_distribution<int> distribution(-32768, 32767);
+  std::vector<short> samples(count);
+  for (auto &sample : samples) {
+    sample = short(distribution(random));
+  }
+  return samples;
+}
+
+// A voice like signal: a gliding pitch with a few harmonics and some noise.
+std::vector<short> VoiceSamples(int sample_rate, int channels, double seconds) {
+  std::mt19937 random(42);
+  std::normal_distribution<double> noise(0, 300);
+  auto frames = int(sample_rate * seconds);
+  std::vector<short> samples(frames * channels);
+  double phase = 0;
+  for (int i = 0; i < frames; ++i) {
+    auto t = double(i) / sample_rate;
+    auto pitch = 140 + 60 * std::sin(2 * M_PI * 0.7 * t);
+    phase += 2 * M_PI * pitch / sample_rate;
+    auto value = 6000 * std::sin(phase) + 3000 * std::sin(2 * phase) + 1500 * std::sin(3 * phase);
+    value *= 0.6 + 0.4 * std::sin(2 * M_PI * 3 * t);
+    for (int c = 0; c < channels; ++c) {
+      samples[i * channels + c] = short(std::max(-32768.0, std::min(32767.0, value + noise(random))));
+    }
+  }
+  return samples;
+}
+
+std::vector<short> ChangeSpeed(const std::vector<short> &input, int sample_rate, int channels, float speed) {
+  auto stream = sonicCreateStream(sample_rate, channels);
+  sonicSetSpeed(stream, speed);
+  std::vector<short> output;
+  std::vector<short> buffer(4096 * channels);
+  const int chunk = 960;
+  auto frames = int(input.size()) / channels;
+  for (int offset = 0; offset < frames; offset += chunk) {
+    sonicWriteShortToStream(stream, input.data() + offset * channels, std::min(chunk, frames - offset));
+    int read;
+    while ((read = sonicReadShortFromStream(stream, buffer.data(), 4096)) > 0) {
+      output.insert(output.end(), buffer.begin(), buffer.begin() + read * channels);
+    }
+  }
+  sonicFlushStream(stream);
+  int read;
+  while ((read = sonicReadShortFromStream(stream, buffer.data(), 4096)) > 0) {
+    output.insert(output.end(), buffer.begin(), buffer.begin() + read * channels);
+  }
+  sonicDestroyStream(stream);
+  return output;
+}
+
+}
+
+TEST(SonicSimd, AbsDiffSumMatchesScalar) {
+  auto samples = RandomSamples(2048, 1);
+  // extreme values exercise the unsigned wrap of the differences.
+  samples[3] = -32768;
+  samples[3 + 17] = 32767;
+  for (auto level : SupportedLevels()) {
+    for (int period = 1; period <= 1000; ++period) {
+      sonicSimdSetLevel(SONIC_SIMD_SCALAR);
+      auto expected = sonicSimdAbsDiffSum(samples.data(), period);
+      sonicSimdSetLevel(level);
+      EXPECT_EQ(sonicSimdAbsDiffSum(samples.data(), period), expected) << "level " << level << " period " << period;
+    }
+  }
+}
+
+TEST(SonicSimd, OverlapAddMatchesScalar) {
+  for (auto level : SupportedLevels()) {
+    for (int channels = 1; channels <= 4; ++channels) {
+      for (int num_samples : {1, 3, 7, 64, 333, 1500, 40000}) {
+        auto down = RandomSamples(num_samples * channels, num_samples);
+        auto up = RandomSamples(num_samples * channels, num_samples + 1);
+        std::vector<short> expected(num_samples * channels);
+        std::vector<short> actual(num_samples * channels);
+        sonicSimdSetLevel(SONIC_SIMD_SCALAR);
+        sonicSimdOverlapAdd(num_samples, channels, expected.data(), down.data(), up.data());
+        sonicSimdSetLevel(level);
+        sonicSimdOverlapAdd(num_samples, channels, actual.data(), down.data(), up.data());
+        EXPECT_EQ(actual, expected) << "level " << level << " channels " << channels << " samples " << num_samples;
+      }
+    }
+  }
+}
+
+// The output of a whole stream is bit identical to the scalar golden output.
+TEST(SonicSimd, StreamOutputMatchesScalar) {
+  for (int channels : {1, 2}) {
+    auto input = VoiceSamples(48000, channels, 3);
+    for (float speed : {0.5f, 0.75f, 1.5f, 2.0f, 3.0f}) {
+      sonicSimdSetLevel(SONIC_SIMD_SCALAR);
+      auto golden = ChangeSpeed(input, 48000, channels, speed);
+      ASSERT_FALSE(golden.empty());
+      for (auto level : SupportedLevels()) {
+        sonicSimdSetLevel(level);
+        EXPECT_EQ(ChangeSpeed(input, 48000, channels, speed), golden)
+                  << "level " << level << " channels " << channels << " speed " << speed;
+      }
+    }
+  }
+}
+
+std::vector<short> Sine(int sample_rate, int channels, double seconds, double frequency, double amplitude) {
+  auto frames = int(sample_rate * seconds);
+  std::vector<short> samples(frames * channels);
+  for (int i = 0; i < frames; ++i) {
+    auto value = short(std::lround(amplitude * 32767 * std::sin(2 * M_PI * frequency * i / sample_rate)));
+    for (int c = 0; c < channels; ++c) {
+      samples[i * channels + c] = value;
+    }
+  }
+  return samples;
+}
+
+// BS.1770: a 1kHz sine at 0dBFS in one channel reads -3.01 LKFS.
+TEST(LoudnessMeter, SineMatchesReference) {
+  for (int sample_rate : {16000, 44100, 48000}) {
+    for (int channels : {1, 2}) {
+      LoudnessMeter meter(sample_rate, channels);
+      auto samples = Sine(sample_rate, channels, 5, 1000, 0.1);
+      // feed in uneven chunks, like the recorder does.
+      for (size_t offset = 0; offset < samples.size() / channels; offset += 1234) {
+        auto frames = std::min<size_t>(1234, samples.size() / channels - offset);
+        meter.Process(samples.data() + offset * channels, int(frames));
+      }
+      auto expected = -23.01 + 10 * std::log10(double(channels));
+      EXPECT_NEAR(meter.IntegratedLoudness(), expected, 0.05)
+                << "sample rate " << sample_rate << " channels " << channels;
+    }
+  }
+}
+
+TEST(LoudnessMeter, GatesSilence) {
+  LoudnessMeter meter(16000, 1);
+  std::vector<short> silence(16000 * 3);
+  meter.Process(silence.data(), int(silence.size()));
+  EXPECT_TRUE(std::isinf(meter.IntegratedLoudness()));
+
+  // the silence between two loud parts is gated, only the blocks partly
+  // overlapping the tone lower the loudness a little.
+  auto tone = Sine(16000, 1, 2, 1000, 0.1);
+  meter.Process(tone.data(), int(tone.size()));
+  meter.Process(silence.data(), int(silence.size()));
+  meter.Process(tone.data(), int(tone.size()));
+  EXPECT_NEAR(meter.IntegratedLoudness(), -23.01, 0.5);
+}
+
+TEST(LoudnessMeter, OutputGain) {
+  // -33 LUFS to -23 LUFS is +10dB, in Q7.8.
+  EXPECT_EQ(LoudnessToOutputGain(-33, 0.1, -23), 2560);
+  // limited so the peak stays at -1dBFS.
+  EXPECT_EQ(LoudnessToOutputGain(-33, 0.5, -23), int(std::lround((-1 - 20 * std::log10(0.5)) * 256)));
+  EXPECT_EQ(LoudnessToOutputGain(-HUGE_VAL, 0, -23), 0);
+}
+
+// Classify `samples` frame by frame, returns the decision of every frame.
+std::vector<bool> DetectVoice(VoiceActivityDetector &vad, const std::vector<short> &samples) {
+  std::vector<bool> decisions;
+  for (size_t offset = 0; offset + vad.FrameSize() <= samples.size(); offset += vad.FrameSize()) {
+    decisions.push_back(vad.Process(samples.data() + offset));
+  }
+  return decisions;
+}
+
+std::vector<short> Noise(size_t count, double amplitude, int seed) {
+  std::mt19937 random(seed);
+  std::normal_distribution<double> distribution(0, amplitude * 32767);
+  std::vector<short> samples(count);
+  for (auto &sample : samples) {
+    sample = short(std::max(-32768.0, std::min(32767.0, distribution(random))));
+  }
+  return samples;
+}
+
+TEST(VoiceActivityDetector, DetectsSpeechOverNoise) {
+  for (double noise_level : {0.0, 0.001, 0.01}) {
+    VoiceActivityDetector vad(16000);
+    auto background = Noise(16000 * 2, noise_level, 1);
+    auto voice = VoiceSamples(16000, 1, 1);
+    auto noise = Noise(voice.size(), noise_level, 2);
+    for (size_t i = 0; i < voice.size(); ++i) {
+      voice[i] = short(std::max(-32768, std::min(32767, voice[i] + noise[i])));
+    }
+
+    auto silent = DetectVoice(vad, background);
+    EXPECT_EQ(std::count(silent.begin(), silent.end(), true), 0) << "noise " << noise_level;
+    auto speech = DetectVoice(vad, voice);
+    EXPECT_EQ(std::count(speech.begin(), speech.end(), false), 0) << "noise " << noise_level;
+    // held for 300ms after the speech, then silence again.
+    auto after = DetectVoice(vad, background);
+    EXPECT_TRUE(after[0]);
+    EXPECT_TRUE(after[14]);
+    EXPECT_FALSE(after[15]);
+    EXPECT_EQ(std::count(after.begin() + 15, after.end(), true), 0) << "noise " << noise_level;
+  }
+}
+
+TEST(Waveform, MaxAbsMatchesScalar) {
+  auto samples = RandomSamples(4096, 5);
+  samples[1000] = -32768;
+  for (int offset : {0, 1, 3}) {
+    for (int count : {0, 1, 7, 15, 16, 17, 100, 999, 3000}) {
+      EXPECT_EQ(waveform_max_abs(samples.data() + offset, count),
+                waveform_max_abs_scalar(samples.data() + offset, count)) << offset << " " << count;
+    }
+  }
+  EXPECT_EQ(waveform_max_abs(samples.data() + 990, 20), 32767);
+}
+
+TEST(Waveform, BuilderIsIndependentOfChunks) {
+  auto samples = RandomSamples(10050, 6);
+  std::vector<uint16_t> expected;
+  for (size_t offset = 0; offset < samples.size(); offset += 100) {
+    auto count = std::min<size_t>(100, samples.size() - offset);
+    expected.push_back(waveform_max_abs_scalar(samples.data() + offset, int32_t(count)));
+  }
+
+  for (int chunk : {1, 7, 100, 960, 10050}) {
+    WaveformBuilder builder;
+    waveform_builder_init(&builder, 100);
+    std::vector<uint16_t> peaks(samples.size() / 100 + 1);
+    int32_t written = 0;
+    for (size_t offset = 0; offset < samples.size(); offset += chunk) {
+      auto count = std::min<size_t>(chunk, samples.size() - offset);
+      written += waveform_builder_add(&builder, samples.data() + offset, int32_t(count), peaks.data() + written);
+    }
+    written += waveform_builder_flush(&builder, peaks.data() + written);
+    peaks.resize(written);
+    EXPECT_EQ(peaks, expected) << "chunk " << chunk;
+  }
+}
+
+TEST(Waveform, PackMatchesAndroid) {
+  // the normalization and the 4 byte set_bits of getWaveform2 in audio.c.
+  auto pack = [](const std::vector<uint16_t> &peaks) {
+    int64_t sum = 0;
+    for (auto peak : peaks) {
+      sum += peak;
+    }
+    auto peak = uint16_t(float(sum) * 1.8f / float(peaks.size()));
+    peak = std::max<uint16_t>(peak, 2500);
+    std::vector<uint8_t> bytes(peaks.size() * 5 / 8 + 1 + 4, 0);
+    for (size_t i = 0; i < peaks.size(); ++i) {
+      int32_t value = std::min(31, std::min(peaks[i], peak) * 31 / peak);
+      uint32_t word;
+      memcpy(&word, bytes.data() + i * 5 / 8, 4);
+      word |= uint32_t(value) << (i * 5 % 8);
+      memcpy(bytes.data() + i * 5 / 8, &word, 4);
+    }
+    bytes.resize(bytes.size() - 4);
+    return bytes;
+  };
+
+  std::mt19937 random(7);
+  for (int buckets : {1, 8, 100, 333}) {
+    for (int loudness : {1000, 32767}) {
+      std::uniform_int_distribution<int> distribution(0, loudness);
+      std::vector<uint16_t> peaks(buckets);
+      for (auto &peak : peaks) {
+        peak = uint16_t(distribution(random));
+      }
+      std::vector<uint8_t> packed(waveform_packed_size(buckets));
+      waveform_pack(peaks.data(), buckets, packed.data());
+      EXPECT_EQ(packed, pack(peaks)) << buckets << " " << loudness;
+    }
+  }
+}
+
+TEST(Waveform, Resample) {
+  std::vector<uint16_t> peaks = {1, 5, 2, 8, 3, 4};
+  std::vector<uint16_t> out(3);
+  waveform_resample(peaks.data(), int32_t(peaks.size()), out.data(), 3);
+  EXPECT_EQ(out, (std::vector<uint16_t>{5, 8, 4}));
+  out.resize(12);
+  waveform_resample(peaks.data(), int32_t(peaks.size()), out.data(), 12);
+  EXPECT_EQ(out, (std::vector<uint16_t>{1, 1, 5, 5, 2, 2, 8, 8, 3, 3, 4, 4}));
+  waveform_resample(peaks.data(), 0, out.data(), 12);
+  EXPECT_EQ(out, std::vector<uint16_t>(12, 0));
+}
+
+namespace {
+
+std::shared_ptr<const DecodedPcm> MakePcm(size_t samples) {
+  auto pcm = std::make_shared<DecodedPcm>();
+  pcm->channels = 1;
+  pcm->bitrate = 16000;
+  pcm->samples.resize(samples);
+  return pcm;
+}
+
+}
+
+TEST(PcmCache, EvictsLeastRecentlyUsed) {
+  PcmCache cache(3000);
+  cache.Insert("a", 1, 10, MakePcm(500));
+  cache.Insert("b", 1, 10, MakePcm(500));
+  cache.Insert("c", 1, 10, MakePcm(500));
+  EXPECT_EQ(cache.UsedBytes(), 3000u);
+  ASSERT_NE(cache.Lookup("a", 1, 10), nullptr);
+
+  // b is the oldest now.
+  cache.Insert("d", 1, 10, MakePcm(500));
+  EXPECT_EQ(cache.Lookup("b", 1, 10), nullptr);
+  EXPECT_NE(cache.Lookup("a", 1, 10), nullptr);
+  EXPECT_NE(cache.Lookup("c", 1, 10), nullptr);
+  EXPECT_NE(cache.Lookup("d", 1, 10), nullptr);
+  EXPECT_EQ(cache.UsedBytes(), 3000u);
+
+  // larger than the whole budget.
+  cache.Insert("e", 1, 10, MakePcm(2000));
+  EXPECT_EQ(cache.Lookup("e", 1, 10), nullptr);
+  EXPECT_EQ(cache.UsedBytes(), 3000u);
+
+  cache.SetBudget(1000);
+  EXPECT_EQ(cache.UsedBytes(), 1000u);
+  EXPECT_NE(cache.Lookup("d", 1, 10), nullptr);
+  cache.SetBudget(0);
+  EXPECT_EQ(cache.UsedBytes(), 0u);
+  EXPECT_EQ(cache.Lookup("d", 1, 10), nullptr);
+}
+
+TEST(PcmCache, DropsChangedFiles) {
+  PcmCache cache(3000);
+  auto pcm = MakePcm(100);
+  cache.Insert("a", 1, 10, pcm);
+  EXPECT_EQ(cache.Lookup("a", 1, 10), pcm);
+  EXPECT_EQ(cache.Lookup("a", 2, 10), nullptr);
+  EXPECT_EQ(cache.UsedBytes(), 0u);
+  cache.Insert("a", 2, 10, pcm);
+  EXPECT_EQ(cache.Lookup("a", 2, 11), nullptr);
+  // replacing an entry does not count it twice.
+  cache.Insert("a", 2, 11, pcm);
+  cache.Insert("a", 2, 11, pcm);
+  EXPECT_EQ(cache.UsedBytes(), 200u);
+  // a file rewritten within one tick of the file system clock.
+  cache.Remove("a");
+  EXPECT_EQ(cache.Lookup("a", 2, 11), nullptr);
+  EXPECT_EQ(cache.UsedBytes(), 0u);
+}
+
+namespace {
+
+std::string TempPath(const char *name) {
+  return testing::TempDir() + name;
+}
+
+// Encode `seconds` of VoiceSamples to an ogg opus file at `path`.
+void WriteOpusFile(const std::string &path, int channels, double seconds) {
+  auto samples = VoiceSamples(48000, channels, seconds);
+  auto *comments = ope_comments_create();
+  int error = 0;
+  auto *encoder = ope_encoder_create_file(path.c_str(), comments, 48000, channels, 0, &error);
+  ASSERT_NE(encoder, nullptr) << ope_strerror(error);
+  EXPECT_EQ(ope_encoder_write(encoder, samples.data(), int(samples.size()) / channels), OPE_OK);
+  EXPECT_EQ(ope_encoder_drain(encoder), OPE_OK);
+  ope_encoder_destroy(encoder);
+  ope_comments_destroy(comments);
+}
+
+// The decoded 48kHz pcm of the file at `path`, interleaved.
+std::vector<opus_int16> DecodeOpusFile(const std::string &path, int *channels = nullptr) {
+  int error = 0;
+  auto *file = op_open_file(path.c_str(), &error);
+  EXPECT_NE(file, nullptr) << path;
+  std::vector<opus_int16> pcm;
+  if (!file) {
+    return pcm;
+  }
+  auto count = op_channel_count(file, -1);
+  if (channels) {
+    *channels = count;
+  }
+  std::vector<opus_int16> buffer(5760 * count);
+  int read;
+  while ((read = op_read(file, buffer.data(), int(buffer.size()), nullptr)) > 0) {
+    pcm.insert(pcm.end(), buffer.begin(), buffer.begin() + read * count);
+  }
+  op_free(file);
+  return pcm;
+}
+
+int64_t PcmTotal(const std::string &path) {
+  int error = 0;
+  auto *file = op_open_file(path.c_str(), &error);
+  EXPECT_NE(file, nullptr) << path;
+  if (!file) {
+    return -1;
+  }
+  auto total = op_pcm_total(file, -1);
+  op_free(file);
+  return total;
+}
+
+// Largest difference between `length` frames of `a` from `a_offset` and of
+// `b` from `b_offset`.
+int MaxDifference(const std::vector<opus_int16> &a, size_t a_offset,
+                  const std::vector<opus_int16> &b, size_t b_offset, size_t length) {
+  int difference = 0;
+  for (size_t i = 0; i < length; ++i) {
+    difference = std::max(difference, std::abs(a[a_offset + i] - b[b_offset + i]));
+  }
+  return difference;
+}
+
+// Frames of the 16 bit wav file at `path`.
+int64_t WavFrames(const std::string &path, int channels) {
+  auto *file = fopen(path.c_str(), "rb");
+  EXPECT_NE(file, nullptr) << path;
+  if (!file) {
+    return -1;
+  }
+  uint8_t header[44];
+  auto read = fread(header, 1, sizeof(header), file);
+  fclose(file);
+  EXPECT_EQ(read, sizeof(header));
+  uint32_t data_bytes = header[40] | header[41] << 8 | header[42] << 16 | uint32_t(header[43]) << 24;
+  return data_bytes / (2 * channels);
+}
+
+}
+
+TEST(Waveform, BatchMatchesDecodedFile) {
+  // long enough to be split into two segments decoded in parallel.
+  auto path = TempPath("waveform_batch.opus");
+  WriteOpusFile(path, 2, 31);
+  int channels = 0;
+  auto decoded = DecodeOpusFile(path, &channels);
+  auto total = int64_t(decoded.size()) / channels;
+
+  const int buckets = 100;
+  std::vector<uint16_t> peaks(buckets);
+  for (int i = 0; i < buckets; ++i) {
+    auto start = total * i / buckets;
+    auto end = total * (i + 1) / buckets;
+    peaks[i] = waveform_max_abs_scalar(decoded.data() + start * channels, int32_t((end - start) * channels));
+  }
+  auto packed_size = ogg_opus_waveform_packed_size(buckets);
+  std::vector<uint8_t> expected(packed_size * 2, 0);
+  waveform_pack(peaks.data(), buckets, expected.data());
+
+  // the waveform of a file which can not be read is all zeros.
+  auto missing = TempPath("waveform_missing.opus");
+  const char *paths[] = {path.c_str(), missing.c_str()};
+  std::vector<uint8_t> out(packed_size * 2, 0xff);
+  EXPECT_EQ(ogg_opus_waveform_batch(paths, 2, buckets, out.data()), 1);
+  EXPECT_EQ(out, expected);
+}
+
+TEST(OggOpusEdit, TrimIsSampleAccurate) {
+  auto input = TempPath("trim_input.opus");
+  WriteOpusFile(input, 1, 3);
+  auto original = DecodeOpusFile(input);
+  ASSERT_EQ(int64_t(original.size()), PcmTotal(input));
+
+  const int64_t start = 30000, end = 90000;
+  auto output = TempPath("trim_output.opus");
+  ASSERT_EQ(ogg_opus_trim(input.c_str(), output.c_str(), start, end), 0);
+  EXPECT_EQ(PcmTotal(output), end - start);
+
+  // the packets are copied, the decoder converged within the pre-roll.
+  auto trimmed = DecodeOpusFile(output);
+  ASSERT_EQ(int64_t(trimmed.size()), end - start);
+  EXPECT_LT(MaxDifference(trimmed, 0, original, start, 960), 200);
+  EXPECT_LT(MaxDifference(trimmed, trimmed.size() - 960, original, end - 960, 960), 200);
+
+  // to the end of the file.
+  ASSERT_EQ(ogg_opus_trim(input.c_str(), output.c_str(), start, -1), 0);
+  EXPECT_EQ(PcmTotal(output), int64_t(original.size()) - start);
+
+  EXPECT_EQ(ogg_opus_trim(input.c_str(), output.c_str(), end, start), OGG_OPUS_EDIT_ERROR_ARGUMENT);
+}
+
+TEST(OggOpusEdit, ConcatJoinsFiles) {
+  auto first = TempPath("concat_first.opus");
+  auto second = TempPath("concat_second.opus");
+  WriteOpusFile(first, 2, 2);
+  WriteOpusFile(second, 2, 1.5);
+  auto first_total = PcmTotal(first);
+  auto second_total = PcmTotal(second);
+
+  auto output = TempPath("concat_output.opus");
+  const char *paths[] = {first.c_str(), second.c_str()};
+  ASSERT_EQ(ogg_opus_concat(paths, 2, output.c_str()), 0);
+
+  // the joint keeps the padding of the first file and the pre-skip of the
+  // second, at most 20ms.
+  auto total = PcmTotal(output);
+  EXPECT_GE(total, first_total + second_total);
+  EXPECT_LE(total, first_total + second_total + 960);
+
+  int channels = 0;
+  auto joined = DecodeOpusFile(output, &channels);
+  auto original = DecodeOpusFile(first);
+  EXPECT_EQ(channels, 2);
+  EXPECT_EQ(MaxDifference(joined, 0, original, 0, original.size()), 0);
+}
+
+TEST(OggOpusEdit, ConcatRejectsDifferentChannels) {
+  auto mono = TempPath("concat_mono.opus");
+  auto stereo = TempPath("concat_stereo.opus");
+  WriteOpusFile(mono, 1, 0.5);
+  WriteOpusFile(stereo, 2, 0.5);
+
+  auto output = TempPath("concat_mismatch.opus");
+  const char *paths[] = {mono.c_str(), stereo.c_str()};
+  EXPECT_EQ(ogg_opus_concat(paths, 2, output.c_str()), OGG_OPUS_EDIT_ERROR_MISMATCH);
+}
+
+TEST(OggOpusRender, PipelinedMatchesSequential) {
+  auto input = TempPath("render_input.opus");
+  WriteOpusFile(input, 2, 3);
+  auto input_frames = PcmTotal(input);
+
+  auto sequential = TempPath("render_sequential.wav");
+  auto pipelined = TempPath("render_pipelined.wav");
+  ASSERT_EQ(ogg_opus_render(input.c_str(), sequential.c_str(), 1.5, 1.0, OGG_OPUS_RENDER_FORMAT_WAV), 0);
+  ASSERT_EQ(ogg_opus_render(input.c_str(), pipelined.c_str(), 1.5, 1.0,
+                            OGG_OPUS_RENDER_FORMAT_WAV | OGG_OPUS_RENDER_PIPELINED), 0);
+
+  auto sequential_frames = WavFrames(sequential, 2);
+  auto pipelined_frames = WavFrames(pipelined, 2);
+  EXPECT_NEAR(double(sequential_frames), input_frames / 1.5, input_frames / 100.0);
+  // the threads change when chunks are processed, not what is rendered.
+  EXPECT_EQ(pipelined_frames, sequential_frames);
+}
+
+TEST(OggOpusProbe, MatchesOpusfile) {
+  auto input = TempPath("probe_input.opus");
+  WriteOpusFile(input, 2, 2);
+  // a larger pre-skip.
+  auto trimmed = TempPath("probe_trimmed.opus");
+  ASSERT_EQ(ogg_opus_trim(input.c_str(), trimmed.c_str(), 10000, 70000), 0);
+
+  for (auto &path : {input, trimmed}) {
+    OggOpusProbeInfo info;
+    ASSERT_EQ(ogg_opus_probe(path.c_str(), &info), 0) << path;
+    EXPECT_EQ(info.duration, PcmTotal(path)) << path;
+    EXPECT_EQ(info.channels, 2);
+    EXPECT_EQ(info.input_sample_rate, 48000);
+    EXPECT_EQ(info.output_gain, 0);
+    EXPECT_GT(info.bitrate, 0);
+    EXPECT_NE(strstr(info.tags, "libopus"), nullptr) << info.tags;
+  }
+
+  OggOpusProbeInfo info;
+  EXPECT_LT(ogg_opus_probe(TempPath("probe_missing.opus").c_str(), &info), 0);
+}
+
+namespace {
+
+void SetModificationTime(const std::string &path, time_t time) {
+#if _WIN32
+  struct _utimbuf times{time, time};
+  ASSERT_EQ(_utime(path.c_str(), &times), 0);
+#else
+  struct utimbuf times{time, time};
+  ASSERT_EQ(utime(path.c_str(), &times), 0);
+#endif
+}
+
+}
+
+TEST(OggOpusProbe, BatchCachesByStat) {
+  auto path = TempPath("probe_cached.opus");
+  auto cache_path = TempPath("probe_cache.bin");
+  remove(cache_path.c_str());
+  WriteOpusFile(path, 1, 1);
+  SetModificationTime(path, 1000000000);
+  auto duration = PcmTotal(path);
+
+  const char *paths[] = {path.c_str()};
+  OggOpusProbeInfo info;
+  int32_t result;
+  ASSERT_EQ(ogg_opus_probe_batch(paths, 1, cache_path.c_str(), &info, &result), 1);
+  EXPECT_EQ(info.duration, duration);
+
+  // same size and modification time, served from the cache without reading
+  // the file.
+  auto *file = fopen(path.c_str(), "r+b");
+  ASSERT_NE(file, nullptr);
+  fwrite("garbage!", 1, 8, file);
+  fclose(file);
+  SetModificationTime(path, 1000000000);
+  info = {};
+  ASSERT_EQ(ogg_opus_probe_batch(paths, 1, cache_path.c_str(), &info, &result), 1);
+  EXPECT_EQ(info.duration, duration);
+
+  // another modification time probes the file again.
+  SetModificationTime(path, 1000000001);
+  EXPECT_EQ(ogg_opus_probe_batch(paths, 1, cache_path.c_str(), &info, &result), 0);
+  EXPECT_LT(result, 0);
+}
+
+TEST(OggOpusLoudness, WritesOutputGain) {
+  auto path = TempPath("loudness_gain.opus");
+  WriteOpusFile(path, 1, 1);
+  ASSERT_EQ(WriteOutputGain(path.c_str(), -1234), 0);
+
+  // the checksum of the page is updated, opusfile reads the new gain.
+  int error = 0;
+  auto *file = op_open_file(path.c_str(), &error);
+  ASSERT_NE(file, nullptr) << error;
+  EXPECT_EQ(op_head(file, -1)->output_gain, -1234);
+  op_free(file);
+
+  // only the first page, with the OpusHead.
+  unsigned char page[64] = "OggS";
+  EXPECT_FALSE(SetPageOutputGain(page, sizeof(page), 0));
+}
+
+TEST(OggOpusReader, CachesFileReadToEnd) {
+  auto path = TempPath("reader_cached.opus");
+  WriteOpusFile(path, 1, 1);
+  auto decoded = DecodeOpusFile(path);
+
+  std::vector<opus_int16> first;
+  {
+    OggOpusReader reader(path.c_str());
+    ASSERT_TRUE(reader.IsOpen());
+    EXPECT_FALSE(reader.IsCached());
+    std::vector<opus_int16> buffer(960);
+    int read;
+    while ((read = reader.ReadPcmData(buffer.data(), 960)) > 0) {
+      first.insert(first.end(), buffer.begin(), buffer.begin() + read);
+    }
+  }
+  EXPECT_EQ(first, decoded);
+
+  // inserted when the first reader was destroyed, off the audio thread.
+  OggOpusReader reader(path.c_str());
+  ASSERT_TRUE(reader.IsCached());
+  std::vector<opus_int16> second(decoded.size() + 960);
+  EXPECT_EQ(reader.ReadPcmData(second.data(), int(second.size())), int(decoded.size()));
+  second.resize(decoded.size());
+  EXPECT_EQ(second, decoded);
+}
+
+namespace {
+
+// Resample one second of a sine from 48kHz in chunks of 500 frames, like the
+// player.
+std::vector<int16_t> ResampleSine(int in_channels, int out_rate, int out_channels, double frequency = 1000) {
+  auto *resampler = ogg_opus_resampler_create(48000, in_channels, out_rate, out_channels);
+  EXPECT_NE(resampler, nullptr);
+  std::vector<int16_t> in(500 * in_channels);
+  std::vector<int16_t> out;
+  std::vector<int16_t> chunk(ogg_opus_resampler_max_output(resampler, 500) * out_channels);
+  for (int offset = 0; offset < 48000; offset += 500) {
+    for (int i = 0; i < 500; ++i) {
+      for (int c = 0; c < in_channels; ++c) {
+        in[i * in_channels + c] = int16_t(8000 * std::sin(2 * M_PI * frequency * (offset + i) / 48000.0));
+      }
+    }
+    auto frames = ogg_opus_resampler_process(resampler, in.data(), 500, chunk.data());
+    EXPECT_LE(frames, ogg_opus_resampler_max_output(resampler, 500));
+    out.insert(out.end(), chunk.begin(), chunk.begin() + frames * out_channels);
+  }
+  ogg_opus_resampler_destroy(resampler);
+  return out;
+}
+
+// Expects one second of a 1kHz sine of amplitude 8000 in the first channel.
+void ExpectSine(const std::vector<int16_t> &samples, int rate, int channels) {
+  auto frames = int(samples.size()) / channels;
+  // a few frames are held back by the filter.
+  EXPECT_LE(frames, rate);
+  EXPECT_GE(frames, rate - 300);
+  int crossings = 0;
+  double square_sum = 0;
+  // skip the start of the filter.
+  for (int i = rate / 10; i < frames; ++i) {
+    auto previous = samples[(i - 1) * channels];
+    auto current = samples[i * channels];
+    crossings += (previous < 0) != (current < 0);
+    square_sum += double(current) * current;
+  }
+  auto seconds = double(frames - rate / 10) / rate;
+  EXPECT_NEAR(crossings / seconds, 2000, 4);
+  EXPECT_NEAR(std::sqrt(square_sum / (frames - rate / 10)), 8000 / std::sqrt(2.0), 80);
+}
+
+}
+
+TEST(Resampler, DotProductMatchesScalar) {
+  std::mt19937 random(3);
+  std::uniform_real_distribution<float> distribution(-1, 1);
+  for (int count : {0, 3, 8, 64, 131}) {
+    std::vector<float> a(count), b(count);
+    for (int i = 0; i < count; ++i) {
+      a[i] = distribution(random);
+      b[i] = distribution(random) * 32768;
+    }
+    EXPECT_NEAR(ogg_opus_dot_product(a.data(), b.data(), count),
+                ogg_opus_dot_product_scalar(a.data(), b.data(), count), 0.05) << count;
+  }
+}
+
+TEST(Resampler, ConvertsRate) {
+  ExpectSine(ResampleSine(1, 44100, 1), 44100, 1);
+  ExpectSine(ResampleSine(1, 16000, 1), 16000, 1);
+  ExpectSine(ResampleSine(1, 96000, 1), 96000, 1);
+
+  // above the new nyquist frequency, filtered instead of aliased.
+  auto aliased = ResampleSine(1, 16000, 1, 12000);
+  for (size_t i = 1000; i < aliased.size(); ++i) {
+    ASSERT_LE(std::abs(aliased[i]), 16) << i;
+  }
+}
+
+TEST(Resampler, ConvertsRateAndChannels) {
+  auto stereo = ResampleSine(1, 44100, 2);
+  ExpectSine(stereo, 44100, 2);
+  for (size_t i = 0; i < stereo.size(); i += 2) {
+    ASSERT_EQ(stereo[i], stereo[i + 1]);
+  }
+  ExpectSine(ResampleSine(2, 44100, 1), 44100, 1);
+  // same rate, only mixed.
+  auto mono = ResampleSine(2, 48000, 1);
+  ASSERT_EQ(mono.size(), 48000u);
+  EXPECT_EQ(mono[12], int16_t(8000 * std::sin(2 * M_PI * 1000 * 12 / 48000.0)));
+}
+
+TEST(Resampler, MixesChannels) {
+  const int16_t stereo[] = {100, 300, -32768, -32768};
+  int16_t mono[2];
+  ogg_opus_mix_channels(stereo, 2, mono, 1, 2);
+  EXPECT_EQ(mono[0], 200);
+  EXPECT_EQ(mono[1], -32768);
+
+  int16_t surround[6];
+  ogg_opus_mix_channels(mono, 1, surround, 3, 2);
+  EXPECT_EQ(std::vector<int16_t>(surround, surround + 6), (std::vector<int16_t>{200, 200, 0, -32768, -32768, 0}));
+
+  int16_t back[4];
+  ogg_opus_mix_channels(surround, 3, back, 2, 2);
+  EXPECT_EQ(std::vector<int16_t>(back, back + 4), (std::vector<int16_t>{200, 200, -32768, -32768}));
+}
+
+TEST(PlaybackAnalyzer, Levels) {
+  PlaybackAnalyzer analyzer(48000, 2, 0);
+  EXPECT_EQ(analyzer.Bands(), 0);
+  auto samples = Sine(48000, 2, 0.1, 1000, 0.5);
+  analyzer.Process(samples.data(), int(samples.size() / 2));
+  EXPECT_EQ(analyzer.PendingFrames(), 4800);
+  float levels[2];
+  analyzer.Take(levels);
+  EXPECT_NEAR(levels[0], 0.5 / std::sqrt(2.0), 0.01);
+  EXPECT_NEAR(levels[1], 0.5, 0.01);
+  EXPECT_EQ(analyzer.PendingFrames(), 0);
+
+  std::vector<short> silence(960 * 2);
+  analyzer.Process(silence.data(), 960);
+  analyzer.Take(levels);
+  EXPECT_EQ(levels[0], 0);
+  EXPECT_EQ(levels[1], 0);
+}
+
+TEST(PlaybackAnalyzer, SpectrumFindsTone) {
+  for (int sample_rate : {16000, 48000}) {
+    for (double frequency : {250.0, 1000.0, 4000.0}) {
+      PlaybackAnalyzer analyzer(sample_rate, 1, 16);
+      auto samples = Sine(sample_rate, 1, 0.2, frequency, 0.5);
+      analyzer.Process(samples.data(), int(samples.size()));
+      float levels[2 + 16];
+      analyzer.Take(levels);
+      auto loudest = std::max_element(levels + 2, levels + 18) - (levels + 2);
+      // the band of the tone reads its amplitude, the hann window leaks a
+      // little into the neighbours only.
+      EXPECT_NEAR(levels[2 + loudest], 0.5, 0.1) << sample_rate << " " << frequency;
+      for (int band = 0; band < 16; ++band) {
+        if (std::abs(band - loudest) > 1) {
+          EXPECT_LT(levels[2 + band], 0.01) << sample_rate << " " << frequency << " band " << band;
+        }
+      }
+      if (frequency * 2 >= sample_rate / 2) {
+        continue;
+      }
+      // higher tones land in higher bands.
+      PlaybackAnalyzer higher(sample_rate, 1, 16);
+      auto octave = Sine(sample_rate, 1, 0.2, frequency * 2, 0.5);
+      higher.Process(octave.data(), int(octave.size()));
+      higher.Take(levels);
+      EXPECT_GT(std::max_element(levels + 2, levels + 18) - (levels + 2), loudest);
+    }
+  }
+}
+
+TEST(PlaybackAnalyzer, KeepsSpectrumBetweenTransforms) {
+  PlaybackAnalyzer analyzer(48000, 1, 8);
+  auto samples = Sine(48000, 1, 0.05, 1000, 0.5);
+  analyzer.Process(samples.data(), int(samples.size()));
+  float first[2 + 8];
+  analyzer.Take(first);
+  // fewer frames than a hop, no new transform.
+  analyzer.Process(samples.data(), 100);
+  float second[2 + 8];
+  analyzer.Take(second);
+  EXPECT_EQ(std::vector<float>(first + 2, first + 10), std::vector<float>(second + 2, second + 10));
+}
@@ -0,0 +1,98 @@
+// Microbenchmark of the waveform core: the max-abs reduction alone, and the
+// incremental builder fed in chunks like the recorder does, and prints the
+// realtime factor of each configuration.
+//
+// Build with -DOGG_OPUS_PLAYER_BUILD_BENCHMARK=ON and run WaveformBenchmark.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "ogg_opus_waveform_core.h"
+
+namespace {
+
+const int kSampleRate = 16000;
+const double kSeconds = 600;
+
+std::vector<int16_t> VoiceSamples() {
+  std::mt19937 random(42);
+  std::normal_distribution<double> noise(0, 300);
+  auto frames = int(kSampleRate * kSeconds);
+  std::vector<int16_t> samples(frames);
+  double phase = 0;
+  for (int i = 0; i < frames; ++i) {
+    auto t = double(i) / kSampleRate;
+    phase += 2 * M_PI * (140 + 60 * std::sin(2 * M_PI * 0.7 * t)) / kSampleRate;
+    auto value = 6000 * std::sin(phase) + 3000 * std::sin(2 * phase) + 1500 * std::sin(3 * phase);
+    value *= 0.6 + 0.4 * std::sin(2 * M_PI * 3 * t);
+    samples[i] = int16_t(std::max(-32768.0, std::min(32767.0, value + noise(random))));
+  }
+  return samples;
+}
+
+// Returns the best seconds of a few runs of `body`.
+template<typename Body>
+double Measure(Body body) {
+  double best = 1e9;
+  for (int round = 0; round < 5; ++round) {
+    auto start = std::chrono::steady_clock::now();
+    body();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    best = std::min(best, elapsed.count());
+  }
+  return best;
+}
+
+// Max-abs of every `bucket` samples, keeps the result alive in `sink`.
+double RunMaxAbs(const std::vector<int16_t> &input, int bucket, bool scalar, uint32_t &sink) {
+  return Measure([&] {
+    auto count = int32_t(input.size());
+    for (int32_t offset = 0; offset < count; offset += bucket) {
+      auto length = std::min(bucket, count - offset);
+      sink += scalar ? waveform_max_abs_scalar(input.data() + offset, length)
+                     : waveform_max_abs(input.data() + offset, length);
+    }
+  });
+}
+
+double RunBuilder(const std::vector<int16_t> &input, int chunk, uint32_t &sink) {
+  std::vector<uint16_t> peaks(input.size() / 100 + 1);
+  return Measure([&] {
+    WaveformBuilder builder;
+    waveform_builder_init(&builder, 100);
+    auto count = int32_t(input.size());
+    int32_t written = 0;
+    for (int32_t offset = 0; offset < count; offset += chunk) {
+      written += waveform_builder_add(&builder, input.data() + offset, std::min(chunk, count - offset),
+                                      peaks.data() + written);
+    }
+    uint8_t packed[64];
+    uint16_t buckets[100];
+    waveform_resample(peaks.data(), written, buckets, 100);
+    waveform_pack(buckets, 100, packed);
+    sink += packed[0];
+  });
+}
+
+}
+
+int main() {
+  auto input = VoiceSamples();
+  uint32_t sink = 0;
+  printf("%-10s %-8s %12s %12s\n", "max-abs", "bucket", "scalar", "simd");
+  for (int bucket : {100, 960, 16000}) {
+    auto scalar = RunMaxAbs(input, bucket, true, sink);
+    auto simd = RunMaxAbs(input, bucket, false, sink);
+    printf("%-10s %-8d %11.0fx %11.0fx\n", "", bucket, kSeconds / scalar, kSeconds / simd);
+  }
+  printf("%-10s %-8s %12s\n", "builder", "chunk", "realtime");
+  for (int chunk : {160, 1920, 16000}) {
+    auto seconds = RunBuilder(input, chunk, sink);
+    printf("%-10s %-8d %11.0fx\n", "", chunk, kSeconds / seconds);
+  }
+  return sink == 0 ? 1 : 0;
+}